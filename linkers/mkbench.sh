@@ -0,0 +1,154 @@
+#! /usr/bin/env bash
+#
+# Benchmark resolving a large application against a large set of libraries.
+#
+# The libraries are generated to look like a BSP's newlib and RTEMS archives.
+# Each library's members call members in the same library and in the library
+# before it. The application's objects call members across all the libraries
+# so most of the archive members are pulled into the link.
+#
+# Each rtems-ld given is run on the same files and the median wall time of
+# the runs is reported. Give a linker built before and after a change to
+# compare them. The output is a script so the time is the loading of the
+# symbols and the resolving, not the writing of a RAP image.
+#
+#  LIBS     The number of libraries, default 16.
+#  MEMBERS  The number of members in each library, default 500.
+#  FUNCS    The number of functions in each member, default 4.
+#  APPS     The number of application objects, default 200.
+#  CALLS    The number of calls in each application object, default 20.
+#  RUNS     The number of times each rtems-ld is run, default 11.
+#  CFLAGS   The C compiler flags, default -O2.
+#
+
+if [ $# -lt 2 ]; then
+  echo "error: bad arguments: ./mkbench.sh <path to C compiler> <path to rtems-ld> [rtems-ld ...]"
+  exit 2
+fi
+
+cc=$1
+shift
+
+if [ ! -f ${cc} ]; then
+  cc=$(command -v ${cc})
+  if [ -z "${cc}" ]; then
+    echo "error: not a file: $1"
+    exit 3
+  fi
+fi
+
+for ld in "$@"; do
+  if [ ! -x ${ld} ]; then
+    echo "error: not an executable: ${ld}"
+    exit 3
+  fi
+done
+
+libs=${LIBS:-16}
+members=${MEMBERS:-500}
+funcs=${FUNCS:-4}
+apps=${APPS:-200}
+calls=${CALLS:-20}
+runs=${RUNS:-11}
+cflags=${CFLAGS:--O2}
+
+dir=rld-bench-${libs}-${members}-${funcs}-${apps}-${calls}
+
+if [ ! -f ${dir}/done ]; then
+  echo "Generating ${libs} libraries of ${members} members and ${apps} objects in ${dir}"
+  rm -rf ${dir}
+  mkdir -p ${dir}
+  for ((l = 0; l < libs; l++)); do
+    (
+      mkdir -p ${dir}/lib${l}
+      cd ${dir}/lib${l}
+      for ((m = 0; m < members; m++)); do
+        {
+          if [ ${l} -gt 0 ]; then
+            echo "extern int lib$((l - 1))_m$(((m * 7 + 3) % members))_f0 (int);"
+          fi
+          echo "extern int lib${l}_m$(((m * 13 + 5) % members))_f1 (int);"
+          for ((f = 0; f < funcs; f++)); do
+            echo "int lib${l}_m${m}_f${f} (int a)"
+            echo "{"
+            if [ ${f} -eq 0 ]; then
+              echo "  if (a > 1)"
+              echo "    a = lib${l}_m$(((m * 13 + 5) % members))_f1 (a - 1);"
+              if [ ${l} -gt 0 ]; then
+                echo "  if (a > 2)"
+                echo "    a = lib$((l - 1))_m$(((m * 7 + 3) % members))_f0 (a - 2);"
+              fi
+            fi
+            echo "  return a + ${f};"
+            echo "}"
+          done
+        } > m${m}.c
+      done
+      ${cc} ${cflags} -c m*.c && ar rcs ../libbench${l}.a m*.o
+      rm -f m*.c m*.o
+    ) &
+  done
+  wait
+  rmdir ${dir}/lib*
+  (
+    mkdir -p ${dir}/app
+    cd ${dir}/app
+    for ((a = 0; a < apps; a++)); do
+      {
+        for ((c = 0; c < calls; c++)); do
+          l=$(((a * 31 + c * 17) % libs))
+          m=$(((a * 97 + c * 41) % members))
+          echo "extern int lib${l}_m${m}_f0 (int);"
+        done
+        if [ ${a} -eq 0 ]; then
+          echo "int rtems_main (int a)"
+        else
+          echo "int app${a} (int a)"
+        fi
+        echo "{"
+        for ((c = 0; c < calls; c++)); do
+          l=$(((a * 31 + c * 17) % libs))
+          m=$(((a * 97 + c * 41) % members))
+          echo "  a += lib${l}_m${m}_f0 (a);"
+        done
+        if [ ${a} -gt 0 ]; then
+          echo "  return a;"
+        else
+          for ((o = 1; o < apps; o++)); do
+            echo "  { extern int app${o} (int); a += app${o} (a); }"
+          done
+          echo "  return a;"
+        fi
+        echo "}"
+      } > app${a}.c
+    done
+    ${cc} ${cflags} -c app*.c
+  )
+  touch ${dir}/done
+fi
+
+objs=$(ls ${dir}/app/app*.o)
+libargs="-L ${dir}"
+for ((l = libs - 1; l >= 0; l--)); do
+  libargs="${libargs} -l bench${l}"
+done
+
+TIMEFORMAT=%3R
+
+for ld in "$@"; do
+  times=""
+  for ((r = 0; r < runs; r++)); do
+    t=$( { time ${ld} -n -C ${cc} -e rtems_main -O script \
+                      -o ${dir}/bench.script ${objs} ${libargs} \
+                      > /dev/null 2>&1; } 2>&1 )
+    if [ $? -ne 0 ]; then
+      echo "error: link failed: ${ld}"
+      exit 4
+    fi
+    times="${times} ${t}"
+  done
+  median=$(echo ${times} | tr ' ' '\n' | sort -n | sed -n "$(((runs + 1) / 2))p")
+  echo "${ld}: median ${median}s of ${runs}: objects $(sort -u ${dir}/bench.script | grep -c '^o:')"
+done
+
+exit 0
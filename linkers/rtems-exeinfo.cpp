@@ -30,8 +30,13 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <map>
+#include <sstream>
+#include <vector>
 
 #include <cxxabi.h>
 #include <signal.h>
@@ -106,6 +111,35 @@ namespace rld
      */
     typedef std::list < section > sections;
 
+    /**
+     * An input section from a linker map. The unit is the object file or
+     * archive member the linker placed in the output section.
+     */
+    struct input_section
+    {
+      std::string output;   //< The output section's name.
+      uint64_t    address;  //< The input section's address.
+      uint64_t    size;     //< The input section's size.
+      std::string unit;     //< The object file or archive member.
+    };
+
+    /**
+     * Container of input sections. Sorted by address when loaded.
+     */
+    typedef std::vector < input_section > input_sections;
+
+    /**
+     * The symbols in a section. The index is flat and sorted by address.
+     */
+    typedef std::vector < const symbols::symbol* > symbol_index;
+
+    /**
+     * The size of each symbol and unit in the sections, keyed by the section
+     * and symbol or unit names separated by tabs so the output is sorted and
+     * does not depend on the addresses the linker used.
+     */
+    typedef std::map < std::string, uint64_t > size_totals;
+
     /**
      * The kernel image.
      */
@@ -145,8 +179,255 @@ namespace rld
        * Output init/fini worker.
        */
       void output_init_fini (const char* label, const char** names);
+
+      /*
+       * Output the size profile of the allocated sections. The linker map
+       * provides the input sections, it can be empty.
+       */
+      void output_sizes (std::ostream& out, const input_sections& inputs);
     };
 
+    /**
+     * The binding's order when symbols share an address. The first symbol
+     * at an address owns the bytes.
+     */
+    static int
+    binding_order (const symbols::symbol* sym)
+    {
+      switch (sym->binding ())
+      {
+        case STB_GLOBAL:
+          return 0;
+        case STB_WEAK:
+          return 1;
+        default:
+          break;
+      }
+      return 2;
+    }
+
+    /**
+     * Order the symbols by address, binding, name and symbol table index.
+     */
+    static bool
+    symbol_order (const symbols::symbol* lhs, const symbols::symbol* rhs)
+    {
+      if (lhs->value () != rhs->value ())
+        return lhs->value () < rhs->value ();
+      int lbo = binding_order (lhs);
+      int rbo = binding_order (rhs);
+      if (lbo != rbo)
+        return lbo < rbo;
+      if (lhs->name () != rhs->name ())
+        return lhs->name () < rhs->name ();
+      return lhs->index () < rhs->index ();
+    }
+
+    /**
+     * Order the input sections by address.
+     */
+    static bool
+    input_order (const input_section& lhs, const input_section& rhs)
+    {
+      return lhs.address < rhs.address;
+    }
+
+    static bool
+    input_address_order (uint64_t address, const input_section& input)
+    {
+      return address < input.address;
+    }
+
+    /**
+     * Parse a hex number from a linker map.
+     */
+    static bool
+    map_hex (const std::string& field, uint64_t& value)
+    {
+      if (!rld::starts_with (field, "0x") || (field.size () == 2))
+        return false;
+      char* end;
+      value = ::strtoull (field.c_str () + 2, &end, 16);
+      return *end == '\0';
+    }
+
+    /**
+     * The unit name without the directories so profiles from different build
+     * trees can be compared.
+     */
+    static std::string
+    map_unit (const std::string& name)
+    {
+      std::string::size_type paren = name.find ('(');
+      if ((paren != std::string::npos) && (paren != 0))
+        return rld::path::basename (name.substr (0, paren)) + name.substr (paren);
+      return rld::path::basename (name);
+    }
+
+    /**
+     * Load the input sections from a GNU ld map file, ie the '-Map' option.
+     * The executable does not record the archive members it was linked from
+     * so the linker map is the only record of them.
+     */
+    void
+    load_link_map (const std::string& name, input_sections& inputs)
+    {
+      std::ifstream in (name.c_str ());
+
+      if (!in.is_open ())
+        throw rld::error ("open: " + name, "exeinfo:link-map");
+
+      std::string output;
+      std::string pending;
+      bool        in_map = false;
+      std::string line;
+
+      while (std::getline (in, line))
+      {
+        if (!in_map)
+        {
+          in_map = rld::starts_with (line, "Linker script and memory map");
+          continue;
+        }
+
+        rld::strings       fields;
+        std::istringstream iss (line);
+        std::string        field;
+        while (iss >> field)
+          fields.push_back (field);
+
+        if (fields.empty ())
+        {
+          pending.clear ();
+          continue;
+        }
+
+        /*
+         * Output sections start in the first column and input sections in the
+         * second. A long input section name is on a line by itself and the
+         * address, size and unit are on the next line.
+         */
+        size_t first = 0;
+        if (line[0] != ' ')
+        {
+          if (fields[0][0] == '.')
+            output = fields[0];
+          pending.clear ();
+          continue;
+        }
+        else if (line[1] != ' ')
+        {
+          pending.clear ();
+          if ((fields[0][0] != '.') && (fields[0] != "COMMON"))
+            continue;
+          if (fields.size () == 1)
+          {
+            pending = fields[0];
+            continue;
+          }
+          first = 1;
+        }
+        else if (pending.empty ())
+          continue;
+
+        pending.clear ();
+
+        input_section input;
+        if ((fields.size () < first + 3) ||
+            !map_hex (fields[first], input.address) ||
+            !map_hex (fields[first + 1], input.size) ||
+            (input.size == 0))
+          continue;
+
+        std::string unit = fields[first + 2];
+        for (size_t f = first + 3; f < fields.size (); ++f)
+          unit += ' ' + fields[f];
+
+        input.output = output;
+        input.unit = map_unit (unit);
+        inputs.push_back (input);
+      }
+
+      std::stable_sort (inputs.begin (), inputs.end (), input_order);
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "link-map: " << name
+                  << ": input sections: " << inputs.size () << std::endl;
+    }
+
+    /**
+     * Add the bytes in a range to a symbol or label. The bytes are split
+     * between the units of the input sections the range covers.
+     */
+    static void
+    add_size (size_totals&          syms,
+              size_totals&          units,
+              const std::string&    sec_name,
+              const std::string&    label,
+              uint64_t              start,
+              uint64_t              end,
+              const input_sections& inputs)
+    {
+      while (start < end)
+      {
+        input_sections::const_iterator ii =
+          std::upper_bound (inputs.begin (), inputs.end (), start,
+                            input_address_order);
+        std::string unit = "-";
+        uint64_t    stop = end;
+        if ((ii != inputs.begin ()) &&
+            (((ii - 1)->address + (ii - 1)->size) > start))
+        {
+          unit = (ii - 1)->unit;
+          stop = std::min (end, (ii - 1)->address + (ii - 1)->size);
+        }
+        else if (ii != inputs.end ())
+        {
+          stop = std::min (end, ii->address);
+        }
+        syms[sec_name + '\t' + label + '\t' + unit] += stop - start;
+        units[sec_name + '\t' + unit] += stop - start;
+        start = stop;
+      }
+    }
+
+    /**
+     * Add the bytes of a gap between sized symbols to the labels in the gap.
+     * Bytes before the first label are fill.
+     */
+    static void
+    add_gap (size_totals&          syms,
+             size_totals&          units,
+             const std::string&    sec_name,
+             uint64_t              start,
+             uint64_t              end,
+             const symbol_index&   labels,
+             size_t&               label,
+             const input_sections& inputs)
+    {
+      while ((label < labels.size ()) && (labels[label]->value () < start))
+        ++label;
+      std::string name = "*fill*";
+      while (start < end)
+      {
+        uint64_t stop = end;
+        if ((label < labels.size ()) && (labels[label]->value () < end))
+        {
+          if (labels[label]->value () == start)
+          {
+            name = labels[label]->name ();
+            while ((label < labels.size ()) &&
+                   (labels[label]->value () == start))
+              ++label;
+            continue;
+          }
+          stop = labels[label]->value ();
+        }
+        add_size (syms, units, sec_name, name, start, stop, inputs);
+        start = stop;
+      }
+    }
+
     section::section (const files::section& sec)
       : sec (sec),
         data (sec.size)
@@ -244,9 +525,6 @@ namespace rld
        * Load the symbols and sections.
        */
       exe.load_symbols (symbols, true);
-      symbols.globals (addresses);
-      symbols.weaks (addresses);
-      symbols.locals (addresses);
       exe.get_sections (secs);
     }
 
@@ -323,6 +601,16 @@ namespace rld
       std::for_each (secs.begin (), secs.end (),
                      section_loader (*this, ifsecs, names));
 
+      /*
+       * The address table is only needed here so only build it here.
+       */
+      if (addresses.empty ())
+      {
+        symbols.globals (addresses);
+        symbols.weaks (addresses);
+        symbols.locals (addresses);
+      }
+
       std::cout << label << " sections: " << ifsecs.size () << std::endl;
 
       for (sections::iterator ii = ifsecs.begin ();
@@ -368,6 +656,130 @@ namespace rld
 
       std::cout << std::endl;
     }
+
+    void
+    image::output_sizes (std::ostream& out, const input_sections& inputs)
+    {
+      /*
+       * Index the symbols by section. Sized symbols own the bytes they cover
+       * and labels, ie symbols without a size, own the bytes up to the next
+       * symbol. Mapping symbols, eg ARM's '$a', are not labels. The TLS
+       * symbols are not loaded so the TLS sections are only split by unit.
+       */
+      std::map < int, symbol_index > sized;
+      std::map < int, symbol_index > labels;
+
+      rld::symbols::pointers syms;
+      exe.elf ().get_symbols (syms, false, true, true, true);
+
+      for (rld::symbols::pointers::const_iterator si = syms.begin ();
+           si != syms.end ();
+           ++si)
+      {
+        const symbols::symbol& sym = *(*si);
+        if ((sym.section_index () == SHN_UNDEF) ||
+            (sym.section_index () >= SHN_LORESERVE))
+          continue;
+        if (sym.esym ().st_size != 0)
+          sized[sym.section_index ()].push_back (&sym);
+        else if (!rld::starts_with (sym.name (), "$") &&
+                 !rld::starts_with (sym.name (), ".L"))
+          labels[sym.section_index ()].push_back (&sym);
+      }
+
+      size_totals sym_sizes;
+      size_totals unit_sizes;
+      size_totals sec_sizes;
+      uint64_t    text = 0;
+      uint64_t    data = 0;
+      uint64_t    bss = 0;
+
+      for (files::sections::const_iterator si = secs.begin ();
+           si != secs.end ();
+           ++si)
+      {
+        const files::section& sec = *si;
+
+        if (((sec.flags & SHF_ALLOC) == 0) || (sec.size == 0))
+          continue;
+
+        if (sec.type == SHT_NOBITS)
+          bss += sec.size;
+        else if ((sec.flags & SHF_WRITE) != 0)
+          data += sec.size;
+        else
+          text += sec.size;
+
+        sec_sizes[sec.name] += sec.size;
+
+        input_sections sec_inputs;
+        for (input_sections::const_iterator ii = inputs.begin ();
+             ii != inputs.end ();
+             ++ii)
+          if (ii->output == sec.name)
+            sec_inputs.push_back (*ii);
+
+        symbol_index sec_sized;
+        symbol_index sec_labels;
+        if ((sec.flags & SHF_TLS) == 0)
+        {
+          sec_sized.swap (sized[sec.index]);
+          sec_labels.swap (labels[sec.index]);
+        }
+        std::sort (sec_sized.begin (), sec_sized.end (), symbol_order);
+        std::sort (sec_labels.begin (), sec_labels.end (), symbol_order);
+
+        const uint64_t end = sec.address + sec.size;
+        uint64_t       cursor = sec.address;
+        size_t         label = 0;
+
+        for (symbol_index::const_iterator ssi = sec_sized.begin ();
+             ssi != sec_sized.end ();
+             ++ssi)
+        {
+          const symbols::symbol& sym = *(*ssi);
+          const uint64_t         start = sym.value ();
+          const uint64_t         stop =
+            std::min (end, start + sym.esym ().st_size);
+          if ((start >= end) || (stop <= cursor))
+            continue;
+          if (start > cursor)
+            add_gap (sym_sizes, unit_sizes, sec.name,
+                     cursor, start, sec_labels, label, sec_inputs);
+          add_size (sym_sizes, unit_sizes, sec.name, sym.name (),
+                    std::max (cursor, start), stop, sec_inputs);
+          cursor = stop;
+        }
+
+        add_gap (sym_sizes, unit_sizes, sec.name,
+                 cursor, end, sec_labels, label, sec_inputs);
+      }
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "sizes: sections: " << sec_sizes.size ()
+                  << " symbols: " << sym_sizes.size ()
+                  << " units: " << unit_sizes.size () << std::endl;
+
+      out << "# rtems-exeinfo size profile 1" << std::endl
+          << "total\ttext\t" << text << std::endl
+          << "total\tdata\t" << data << std::endl
+          << "total\tbss\t" << bss << std::endl;
+
+      for (size_totals::const_iterator sti = sec_sizes.begin ();
+           sti != sec_sizes.end ();
+           ++sti)
+        out << "section\t" << sti->first << '\t' << sti->second << std::endl;
+
+      for (size_totals::const_iterator sti = unit_sizes.begin ();
+           sti != unit_sizes.end ();
+           ++sti)
+        out << "unit\t" << sti->first << '\t' << sti->second << std::endl;
+
+      for (size_totals::const_iterator sti = sym_sizes.begin ();
+           sti != sym_sizes.end ();
+           ++sti)
+        out << "symbol\t" << sti->first << '\t' << sti->second << std::endl;
+    }
   }
 }
 
@@ -384,6 +796,9 @@ static struct option rld_opts[] = {
   { "sections",    no_argument,            NULL,           'S' },
   { "init",        no_argument,            NULL,           'I' },
   { "fini",        no_argument,            NULL,           'F' },
+  { "jobs",        required_argument,      NULL,           'j' },
+  { "sizes",       required_argument,      NULL,           'Z' },
+  { "link-map",    required_argument,      NULL,           'L' },
   { NULL,          0,                      NULL,            0 }
 };
 
@@ -400,7 +815,13 @@ usage (int exit_code)
             << " -a        : all output excluding the map (also --all)" << std::endl
             << " -S        : show all section (also --sections)" << std::endl
             << " -I        : show init section tables (also --init)" << std::endl
-            << " -F        : show fini section tables (also --fini)" << std::endl;
+            << " -F        : show fini section tables (also --fini)" << std::endl
+            << " -j jobs   : number of threads demangling the map's C++" << std::endl
+            << "             symbols (also --jobs)" << std::endl
+            << " -Z file   : write the size profile of the allocated sections to" << std::endl
+            << "             the file (also --sizes)" << std::endl
+            << " -L map    : attribute the size profile to the object files and" << std::endl
+            << "             archive members in the linker's map (also --link-map)" << std::endl;
   ::exit (exit_code);
 }
 
@@ -453,12 +874,15 @@ main (int argc, char* argv[])
     bool        sections = false;
     bool        init = false;
     bool        fini = false;
+    int         jobs = 1;
+    std::string sizes;
+    std::string link_map;
 
     rld::set_cmdline (argc, argv);
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hvVMaSIF", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hvVMaSIFj:Z:L:", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -495,6 +919,20 @@ main (int argc, char* argv[])
           sections = true;
           break;
 
+        case 'j':
+          jobs = ::strtoul (optarg, 0, 0);
+          if (jobs < 1)
+            throw rld::error ("invalid number of jobs", "options");
+          break;
+
+        case 'Z':
+          sizes = optarg;
+          break;
+
+        case 'L':
+          link_map = optarg;
+          break;
+
         case '?':
           usage (3);
           break;
@@ -559,11 +997,28 @@ main (int argc, char* argv[])
     if (fini)
       exe.output_fini ();
 
+    /*
+     * Size profile ?
+     */
+    if (!sizes.empty ())
+    {
+      rld::exeinfo::input_sections inputs;
+      if (!link_map.empty ())
+        rld::exeinfo::load_link_map (link_map, inputs);
+      std::ofstream out (sizes.c_str ());
+      if (!out.is_open ())
+        throw rld::error ("open: " + sizes, "options");
+      exe.output_sizes (out, inputs);
+    }
+
     /*
      * Map ?
      */
     if (map)
+    {
+      rld::symbols::demangle (exe.symbols, jobs);
       rld::symbols::output (std::cout, exe.symbols);
+    }
   }
   catch (rld::error re)
   {
@@ -38,6 +38,7 @@
 
 #include <rld.h>
 #include <rld-cc.h>
+#include <rld-compression.h>
 #include <rld-rap.h>
 #include <rld-outputter.h>
 #include <rld-process.h>
@@ -72,10 +73,17 @@ static struct option rld_opts[] = {
   { "cflags",      required_argument,      NULL,           'c' },
   { "rap-strip",   no_argument,            NULL,           'S' },
   { "rpath",       required_argument,      NULL,           'R' },
+  { "compression", required_argument,      NULL,           'Z' },
+  { "block-size",  required_argument,      NULL,           'k' },
+  { "compact-relocs", no_argument,         NULL,           'K' },
+  { "stats",       no_argument,            NULL,           'T' },
+  { "symbol-index", required_argument,     NULL,           'X' },
+  { "incremental", no_argument,            NULL,           'I' },
   { "runtime-lib", required_argument,      NULL,           'P' },
   { "one-file",    no_argument,            NULL,           's' },
   { "rtems",       required_argument,      NULL,           'r' },
   { "rtems-bsp",   required_argument,      NULL,           'B' },
+  { "jobs",        required_argument,      NULL,           'j' },
   { NULL,          0,                      NULL,            0 }
 };
 
@@ -117,11 +125,29 @@ usage (int exit_code)
             << " -c cflags : C compiler flags (also --cflags)" << std::endl
             << " -S        : do not include file details (also --rap-strip)" << std::endl
             << " -R        : include file paths (also --rpath)" << std::endl
+            << " -Z codec  : compress the RAP image with codec, lz77 (default)," << std::endl
+            << "             lz77-2, lz4 or none (also --compression)" << std::endl
+            << " -k size   : size of the compressed blocks, the target loader" << std::endl
+            << "             needs buffers of this size (also --block-size)" << std::endl
+            << " -K        : write compact relocation records, the target loader" << std::endl
+            << "             needs to support RAP version 3 (also --compact-relocs)" << std::endl
+            << " -I        : keep an index of the object files with the RAP" << std::endl
+            << "             output and only load the relocation records of" << std::endl
+            << "             the changed object files" << std::endl
+            << "             (also --incremental)" << std::endl
+            << " -X path   : keep an index of the symbols of each archive in" << std::endl
+            << "             path and only read the object files selected" << std::endl
+            << "             (also --symbol-index)" << std::endl
             << " -P        : place objects from archives (also --runtime-lib)" << std::endl
             << " -s        : Include archive elf object files (also --one-file)" << std::endl
             << " -Wl,opts  : link compatible flags, ignored" << std::endl
             << " -r path   : RTEMS path (also --rtems)" << std::endl
             << " -B bsp    : RTEMS arch/bsp (also --rtems-bsp)" << std::endl
+            << " -j jobs   : number of threads loading object files, limited" << std::endl
+            << "             by the open file limit, and compressing the RAP" << std::endl
+            << "             image (also --jobs)" << std::endl
+            << " -T        : report the counts and time of each phase of the" << std::endl
+            << "             link (also --stats)" << std::endl
             << "Output Formats:" << std::endl
             << " rap     - RTEMS application (LZ77, single image)" << std::endl
             << " elf     - ELF application (script, ELF files)" << std::endl
@@ -197,6 +223,9 @@ main (int argc, char* argv[])
     bool                 map = false;
     bool                 warnings = false;
     bool                 one_file = false;
+    bool                 show_stats = false;
+    int                  jobs = 1;
+    rld::resolver::stats phases;
 
     rld::set_cmdline (argc, argv);
 
@@ -204,7 +233,7 @@ main (int argc, char* argv[])
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hvwVMnsSb:E:o:O:L:l:c:e:d:u:C:W:R:P:r:B:", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hvwVMnsSITb:E:o:O:L:l:c:e:d:u:C:W:R:P:r:B:j:Z:k:KX:", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -310,6 +339,34 @@ main (int argc, char* argv[])
           rld::rap::rpath += '\0';
           break;
 
+        case 'Z':
+          if (std::string (optarg) != "none")
+            rld::compress::get_codec (optarg);
+          rld::rap::compression = optarg;
+          break;
+
+        case 'K':
+          rld::rap::compact_relocs = true;
+          break;
+
+        case 'k':
+          rld::rap::block_size = ::strtoul (optarg, 0, 0);
+          if (rld::rap::block_size < 1)
+            throw rld::error ("invalid block size", "options");
+          break;
+
+        case 'I':
+          rld::rap::incremental = true;
+          break;
+
+        case 'X':
+          rld::files::set_symbol_index (optarg);
+          break;
+
+        case 'T':
+          show_stats = true;
+          break;
+
         case 'W':
           /* ignore linker compatiable flags */
           break;
@@ -322,6 +379,12 @@ main (int argc, char* argv[])
           rtems_arch_bsp = optarg;
           break;
 
+        case 'j':
+          jobs = ::strtoul (optarg, 0, 0);
+          if (jobs < 1)
+            throw rld::error ("invalid number of jobs", "options");
+          break;
+
         case '?':
           usage (3);
           break;
@@ -403,6 +466,9 @@ main (int argc, char* argv[])
     /*
      * Add the object files to the cache.
      */
+    cache.set_jobs (jobs);
+    base.set_jobs (jobs);
+    rld::rap::jobs = jobs;
     cache.add (objects);
 
     /*
@@ -470,7 +536,11 @@ main (int argc, char* argv[])
       /*
        * Load the symbol table.
        */
+      phases.push_back (rld::resolver::phase_stats ("symbols"));
       cache.load_symbols (symbols);
+      phases.back ().objects = cache.get_objects ().size ();
+      phases.back ().symbols = symbols.size ();
+      phases.back ().stop ();
 
       /*
        * Map ?
@@ -490,11 +560,14 @@ main (int argc, char* argv[])
          */
         rld::files::object_list dependents;
         rld::resolver::resolve (dependents, cache,
-                                base_symbols, symbols, undefined);
+                                base_symbols, symbols, undefined, &phases);
 
         /**
          * Output the file.
          */
+        phases.push_back (rld::resolver::phase_stats ("output"));
+        phases.back ().dependents = dependents.size ();
+
         if (output_type == "script")
           rld::outputter::script (output, entry, exit, dependents, cache);
         else if (output_type == "archive")
@@ -530,6 +603,8 @@ main (int argc, char* argv[])
         else
           throw rld::error ("invalid output type", "output");
 
+        phases.back ().stop ();
+
         /**
          * Check for warnings.
          */
@@ -546,6 +621,9 @@ main (int argc, char* argv[])
     }
 
     cache.archives_end ();
+
+    if (show_stats)
+      rld::resolver::output (std::cout, phases);
   }
   catch (rld::error re)
   {
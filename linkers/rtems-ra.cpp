@@ -38,6 +38,7 @@
 
 #include <rld.h>
 #include <rld-cc.h>
+#include <rld-compression.h>
 #include <rld-rap.h>
 #include <rld-outputter.h>
 #include <rld-process.h>
@@ -67,6 +68,11 @@ static struct option rld_opts[] = {
   { "mcpu",        required_argument,      NULL,           'c' },
   { "rap-strip",   no_argument,            NULL,           'S' },
   { "rpath",       required_argument,      NULL,           'R' },
+  { "compression", required_argument,      NULL,           'Z' },
+  { "block-size",  required_argument,      NULL,           'k' },
+  { "compact-relocs", no_argument,         NULL,           'K' },
+  { "stats",       no_argument,            NULL,           'T' },
+  { "symbol-index", required_argument,     NULL,           'X' },
   { "add-rap",     required_argument,      NULL,           'A' },
   { "replace-rap", required_argument,      NULL,           'r' },
   { "delete-rap",  required_argument,      NULL,           'd' },
@@ -103,9 +109,20 @@ usage (int exit_code)
             << " -c cflags : C compiler flags (also --cflags)" << std::endl
             << " -S        : do not include file details (also --rap-strip)" << std::endl
             << " -R        : include file paths (also --rpath)" << std::endl
+            << " -Z codec  : compress the RAP image with codec, lz77 (default)," << std::endl
+            << "             lz77-2, lz4 or none (also --compression)" << std::endl
+            << " -k size   : size of the compressed blocks, the target loader" << std::endl
+            << "             needs buffers of this size (also --block-size)" << std::endl
+            << " -K        : write compact relocation records, the target loader" << std::endl
+            << "             needs to support RAP version 3 (also --compact-relocs)" << std::endl
+            << " -X path   : keep an index of the symbols of each archive in" << std::endl
+            << "             path and only read the object files selected" << std::endl
+            << "             (also --symbol-index)" << std::endl
             << " -A        : Add rap files (also --Add-rap)" << std::endl
             << " -r        : replace rap files (also --replace-rap)" << std::endl
             << " -d        : delete rap files (also --delete-rap)" << std::endl
+            << " -T        : report the counts and time of each phase of" << std::endl
+            << "             converting the libraries (also --stats)" << std::endl
             << " -Wl,opts  : link compatible flags, ignored" << std::endl
             << "Output Formats:" << std::endl
             << " ra      - RTEMS archive container of rap files" << std::endl;
@@ -169,14 +186,16 @@ main (int argc, char* argv[])
     std::string             output = "a.ra";
     bool                    standard_libs = true;
     bool                    convert = true;
+    bool                    show_stats = false;
     rld::files::object_list dependents;
+    rld::resolver::stats    phases;
 
     libpaths.push_back (".");
     dependents.clear ();
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hVvnSa:p:L:l:o:C:E:c:R:W:A:r:d:", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hVvnSTa:p:L:l:o:C:E:c:R:W:A:r:d:Z:k:KX:", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -266,6 +285,30 @@ main (int argc, char* argv[])
           rld::rap::rpath += '\0';
           break;
 
+        case 'Z':
+          if (std::string (optarg) != "none")
+            rld::compress::get_codec (optarg);
+          rld::rap::compression = optarg;
+          break;
+
+        case 'K':
+          rld::rap::compact_relocs = true;
+          break;
+
+        case 'X':
+          rld::files::set_symbol_index (optarg);
+          break;
+
+        case 'T':
+          show_stats = true;
+          break;
+
+        case 'k':
+          rld::rap::block_size = ::strtoul (optarg, 0, 0);
+          if (rld::rap::block_size < 1)
+            throw rld::error ("invalid block size", "options");
+          break;
+
         case 'W':
           /* ignore linker compatiable flags */
           break;
@@ -341,11 +384,17 @@ main (int argc, char* argv[])
          */
         cache->add_libraries (library);
 
+        phases.push_back (rld::resolver::phase_stats ("symbols"));
         cache->load_symbols (symbols);
+        phases.back ().objects = cache->get_objects ().size ();
+        phases.back ().symbols = symbols.size ();
+        phases.back ().stop ();
 
         try
         {
 
+          phases.push_back (rld::resolver::phase_stats ("rap"));
+
           rld::files::objects& objs = cache->get_objects ();
           rld::path::paths     raobjects;
 
@@ -380,6 +429,9 @@ main (int argc, char* argv[])
                                          true);
           }
 
+          phases.back ().objects = objs.size ();
+          phases.back ().stop ();
+
           dependents.clear ();
           for (rld::path::paths::iterator ni = raobjects.begin (); ni != raobjects.end (); ++ni)
           {
@@ -409,8 +461,11 @@ main (int argc, char* argv[])
 
           raname = output_path + raname;
 
+          phases.push_back (rld::resolver::phase_stats ("archive"));
           rld::outputter::archivera (raname, dependents, cachera,
                                      ra_exist, ra_rap);
+          phases.back ().objects = dependents.size ();
+          phases.back ().stop ();
           std::cout << "Generated: " << raname << std::endl;
 
 
@@ -585,6 +640,9 @@ main (int argc, char* argv[])
         delete cache;
       }
     }
+
+    if (show_stats)
+      rld::resolver::output (std::cout, phases);
   }
   catch (rld::error re)
   {
@@ -27,6 +27,7 @@
 #endif
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <vector>
@@ -118,7 +119,7 @@ namespace rap
     ~section ();
 
     void load_data (rld::compress::compressor& comp);
-    void load_relocs (rld::compress::compressor& comp);
+    void load_relocs (rld::compress::compressor& comp, bool compact);
   };
 
   /**
@@ -176,6 +177,8 @@ namespace rap
     std::string rhdr_compression;
     uint32_t    rhdr_checksum;
 
+    const rld::compress::codec* coder;
+
     off_t       machine_rap_off;
     uint32_t    machinetype;
     uint32_t    datatype;
@@ -234,6 +237,11 @@ namespace rap
      */
     void expand ();
 
+    /**
+     * Decompress the image into memory.
+     */
+    void decompress (std::vector < uint8_t >& data);
+
     /**
      * Load details.
      */
@@ -329,9 +337,10 @@ namespace rap
   }
 
   void
-  section::load_relocs (rld::compress::compressor& comp)
+  section::load_relocs (rld::compress::compressor& comp, bool compact)
   {
     uint32_t header;
+    uint32_t offset = 0;
     comp >> header;
 
     rela = header & RAP_RELOC_RELA ? true : false;
@@ -345,11 +354,29 @@ namespace rap
 
         reloc.rap_off = comp.offset ();
 
-        comp >> reloc.info
-             >> reloc.offset;
+        if (compact)
+        {
+          uint32_t code = rld::compress::read_varint (comp);
+
+          reloc.info = ((code & 3) << 30) |
+            (((code >> 10) & 0x3fffff) << 8) |
+            ((code >> 2) & 0xff);
 
-        if (((reloc.info & RAP_RELOC_STRING) == 0) || rela)
-          comp >> reloc.addend;
+          offset += rld::compress::zigzag_decode (rld::compress::read_varint (comp));
+          reloc.offset = offset;
+
+          if (((reloc.info & RAP_RELOC_STRING) == 0) || rela)
+            reloc.addend =
+              rld::compress::zigzag_decode (rld::compress::read_varint (comp));
+        }
+        else
+        {
+          comp >> reloc.info
+               >> reloc.offset;
+
+          if (((reloc.info & RAP_RELOC_STRING) == 0) || rela)
+            comp >> reloc.addend;
+        }
 
         if ((reloc.info & RAP_RELOC_STRING) != 0)
         {
@@ -375,6 +402,7 @@ namespace rap
       rhdr_length (0),
       rhdr_version (0),
       rhdr_checksum (0),
+      coder (0),
       machine_rap_off (0),
       machinetype (0),
       datatype (0),
@@ -452,24 +480,22 @@ namespace rap
 
     sptr = eptr + 1;
 
-    if ((sptr[0] == 'N') &&
-        (sptr[1] == 'O') &&
-        (sptr[2] == 'N') &&
-        (sptr[3] == 'E'))
-    {
-      rhdr_compression = "NONE";
-      eptr = sptr + 4;
-    }
-    else if ((sptr[0] == 'L') &&
-             (sptr[1] == 'Z') &&
-             (sptr[2] == '7') &&
-             (sptr[3] == '7'))
+    rhdr_compression = std::string (sptr, 4);
+    eptr = sptr + 4;
+
+    if (rhdr_compression == "NONE")
+      coder = 0;
+    else
     {
-      rhdr_compression = "LZ77";
-      eptr = sptr + 4;
+      try
+      {
+        coder = &rld::compress::get_codec_by_label (rhdr_compression);
+      }
+      catch (rld::error re)
+      {
+        throw rld::error ("Cannot parse RAP header", "open: " + name);
+      }
     }
-    else
-      throw rld::error ("Cannot parse RAP header", "open: " + name);
 
     if (*eptr != ',')
       throw rld::error ("Cannot parse RAP header", "open: " + name);
@@ -544,7 +570,8 @@ namespace rap
   {
     image.seek (rhdr_len);
 
-    rld::compress::compressor comp (image, rap_comp_buffer, false);
+    rld::compress::compressor comp (image, rap_comp_buffer, false,
+                                    coder != 0, coder);
 
     /*
      * uint32_t: machinetype
@@ -632,7 +659,27 @@ namespace rap
      */
     relocs_rap_off = comp.offset ();
     for (int s = 0; s < rld::rap::rap_secs; ++s)
-      secs[s].load_relocs (comp);
+      secs[s].load_relocs (comp, rhdr_version >= RAP_VERSION_COMPACT);
+
+    /*
+     * Name the relocation records that reference the string table.
+     */
+    for (int s = 0; s < rld::rap::rap_secs; ++s)
+    {
+      for (relocations::iterator ri = secs[s].relocs.begin ();
+           ri != secs[s].relocs.end ();
+           ++ri)
+      {
+        relocation& reloc = *ri;
+        if (((reloc.info & RAP_RELOC_STRING) != 0) &&
+            ((reloc.info & RAP_RELOC_STRING_EMBED) != 0))
+        {
+          uint32_t offset = (reloc.info & ~(3 << 30)) >> 8;
+          if (offset < strtab_size)
+            reloc.symname = (const char*) strtab + offset;
+        }
+      }
+    }
   }
 
   void
@@ -645,7 +692,8 @@ namespace rap
 
     image.seek (rhdr_len);
 
-    rld::compress::compressor comp (image, rap_comp_buffer, false);
+    rld::compress::compressor comp (image, rap_comp_buffer, false,
+                                    coder != 0, coder);
     rld::files::image         out (name);
 
     out.open (true);
@@ -658,6 +706,26 @@ namespace rap
     out.close ();
   }
 
+  void
+  file::decompress (std::vector < uint8_t >& data)
+  {
+    image.seek (rhdr_len);
+
+    rld::compress::compressor comp (image, rap_comp_buffer, false,
+                                    coder != 0, coder);
+
+    data.clear ();
+    while (true)
+    {
+      size_t  offset = data.size ();
+      data.resize (offset + rap_comp_buffer);
+      size_t  amount = comp.read (&data[offset], rap_comp_buffer);
+      data.resize (offset + amount);
+      if (amount != rap_comp_buffer)
+        break;
+    }
+  }
+
   const std::string
   file::name () const
   {
@@ -1064,6 +1132,185 @@ rap_expander (rld::path::paths& raps, bool warnings)
   }
 }
 
+/**
+ * The result of compressing an image with a codec.
+ */
+struct codec_result
+{
+  size_t size;       //< The size of the compressed image.
+  size_t blocks;     //< The number of blocks.
+  double compress;   //< The compress rate in MB/s.
+  double decompress; //< The decompress rate in MB/s.
+};
+
+/**
+ * A timer to measure the rate of an operation. The operation is repeated
+ * until enough time has passed to give a stable rate.
+ */
+class rate_timer
+{
+public:
+  rate_timer ()
+    : passes (0),
+      start (clock::now ()),
+      elapsed (0) {
+  }
+
+  bool running () {
+    elapsed = std::chrono::duration < double > (clock::now () - start).count ();
+    if ((elapsed >= 0.25) && (passes >= 3))
+      return false;
+    ++passes;
+    return true;
+  }
+
+  double rate (size_t size) const {
+    return (size * passes) / (elapsed * 1024 * 1024);
+  }
+
+private:
+  typedef std::chrono::steady_clock clock;
+
+  size_t            passes;
+  clock::time_point start;
+  double            elapsed;
+};
+
+static codec_result
+rap_benchmark_codec (const rld::compress::codec&    coder,
+                     size_t                         block_size,
+                     const std::vector < uint8_t >& data)
+{
+  codec_result             result;
+  size_t                   bound = coder.bound (block_size);
+  std::vector < uint8_t >  compressed;
+  std::vector < size_t >   sizes;
+  std::vector < uint8_t >  block (block_size);
+
+  result.blocks = (data.size () + block_size - 1) / block_size;
+
+  compressed.resize (result.blocks * bound);
+  sizes.resize (result.blocks);
+
+  rate_timer compress_timer;
+  while (compress_timer.running ())
+  {
+    for (size_t b = 0; b < result.blocks; ++b)
+    {
+      size_t offset = b * block_size;
+      size_t length = std::min (block_size, data.size () - offset);
+      sizes[b] = coder.compress (&data[offset], length, &compressed[b * bound]);
+    }
+  }
+  result.compress = compress_timer.rate (data.size ());
+
+  result.size = 0;
+  for (size_t b = 0; b < result.blocks; ++b)
+  {
+    size_t offset = b * block_size;
+    size_t length = std::min (block_size, data.size () - offset);
+    if ((coder.decompress (&compressed[b * bound], sizes[b],
+                           &block[0], block_size) != length) ||
+        (::memcmp (&block[0], &data[offset], length) != 0))
+      throw rld::error ("Decompressed block does not match",
+                        "benchmark: " + std::string (coder.name ()));
+    result.size += coder.header_size () + sizes[b];
+  }
+
+  rate_timer decompress_timer;
+  while (decompress_timer.running ())
+  {
+    for (size_t b = 0; b < result.blocks; ++b)
+      coder.decompress (&compressed[b * bound], sizes[b],
+                        &block[0], block_size);
+  }
+  result.decompress = decompress_timer.rate (data.size ());
+
+  return result;
+}
+
+/**
+ * Compress the image of each RAP file with each codec and a range of block
+ * sizes. The decompress rate is the host's and is a guide to the relative
+ * cost on a target. The buffers are the memory a target loader needs to
+ * hold a block and its compressed data.
+ */
+void
+rap_benchmark (rld::path::paths& raps, bool warnings)
+{
+  static const size_t block_sizes[] =
+  {
+    2 * 1024, 8 * 1024, 32 * 1024, 60 * 1024, 256 * 1024, 1024 * 1024, 0
+  };
+
+  rld::compress::codecs codecs;
+  rld::compress::get_codecs (codecs);
+
+  std::cout << "Benchmark .... " << std::endl;
+
+  for (rld::path::paths::iterator pi = raps.begin();
+       pi != raps.end();
+       ++pi)
+  {
+    rap::file               r (*pi, warnings);
+    std::vector < uint8_t > data;
+
+    r.decompress (data);
+
+    std::cout << ' ' << r.name () << ": image: " << data.size ()
+              << " file: " << r.rhdr_length
+              << " (" << r.rhdr_compression << ')' << std::endl
+              << "  codec    block      size  ratio  compress  decompress"
+              << "  blocks   buffers" << std::endl
+              << "                                       MB/s        MB/s"
+              << std::endl
+              << "  none         - " << std::setw (9) << r.rhdr_len + data.size ()
+              << " 100.0%" << std::endl;
+
+    if (data.empty ())
+      continue;
+
+    for (rld::compress::codecs::iterator ci = codecs.begin ();
+         ci != codecs.end ();
+         ++ci)
+    {
+      const rld::compress::codec& coder = *(*ci);
+
+      for (int b = 0; block_sizes[b] != 0; ++b)
+      {
+        size_t block_size = block_sizes[b];
+
+        if (block_size > coder.max_block_size ())
+          break;
+
+        /*
+         * Blocks larger than the image give the same result.
+         */
+        if ((b > 0) && (block_sizes[b - 1] >= data.size ()))
+          break;
+
+        codec_result result = rap_benchmark_codec (coder, block_size, data);
+
+        result.size += r.rhdr_len;
+
+        std::cout << "  " << std::left << std::setw (6) << coder.name ()
+                  << std::right
+                  << std::setw (8) << block_size
+                  << std::setw (10) << result.size
+                  << std::fixed << std::setprecision (1)
+                  << std::setw (6) << (result.size * 100.0) / data.size () << '%'
+                  << std::setw (10) << result.compress
+                  << std::setw (12) << result.decompress
+                  << std::setprecision (6)
+                  << std::setw (8) << result.blocks
+                  << std::setw (10) << block_size + coder.bound (block_size)
+                  << std::endl;
+        std::cout.unsetf (std::ios::floatfield);
+      }
+    }
+  }
+}
+
 /**
  * RTEMS RAP options.
  */
@@ -1081,6 +1328,7 @@ static struct option rld_opts[] = {
   { "relocs",      no_argument,            NULL,           'r' },
   { "overlay",     no_argument,            NULL,           'o' },
   { "expand",      no_argument,            NULL,           'x' },
+  { "benchmark",   no_argument,            NULL,           'b' },
   { NULL,          0,                      NULL,            0 }
 };
 
@@ -1103,6 +1351,7 @@ usage (int exit_code)
             << " -r        : show relocations (also --relocs)" << std::endl
             << " -o        : linkage overlay (also --overlay)" << std::endl
             << " -x        : expand (also --expand)" << std::endl
+            << " -b        : benchmark the compression codecs (also --benchmark)" << std::endl
             << " -f        : show file details" << std::endl;
   ::exit (exit_code);
 }
@@ -1162,10 +1411,11 @@ main (int argc, char* argv[])
     bool             show_details = false;
     bool             overlay = false;
     bool             expand = false;
+    bool             benchmark = false;
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hvVnaHmlsSroxf", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hvVnaHmlsSroxbf", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -1235,6 +1485,10 @@ main (int argc, char* argv[])
           expand = true;
           break;
 
+        case 'b':
+          benchmark = true;
+          break;
+
         case 'f':
           show_details = true;
           break;
@@ -1279,6 +1533,9 @@ main (int argc, char* argv[])
 
     if (expand)
       rap_expander (raps, warnings);
+
+    if (benchmark)
+      rap_benchmark (raps, warnings);
   }
   catch (rld::error re)
   {
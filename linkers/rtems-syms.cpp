@@ -26,9 +26,11 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <vector>
 
 #include <cxxabi.h>
 #include <signal.h>
@@ -40,6 +42,8 @@
 
 #include <rld.h>
 #include <rld-cc.h>
+#include <rld-elf.h>
+#include <rld-files.h>
 #include <rld-outputter.h>
 #include <rld-process.h>
 #include <rld-symbols.h>
@@ -64,6 +68,14 @@ static const char* c_header[] =
   "",
   "void rtems_rtl_base_sym_global_add (const unsigned char* , unsigned int );",
   "",
+  0
+};
+
+/**
+ * The symbol table's assembler.
+ */
+static const char* c_table_header[] =
+{
   "asm(\".section \\\".rodata\\\"\");",
   "",
   "asm(\"  .align   4\");",
@@ -85,6 +97,11 @@ static const char* c_trailer[] =
   "asm(\"  .type    rtems__rtl_base_globals, #object\");",
   "asm(\"  .size    rtems__rtl_base_globals, . - rtems__rtl_base_globals\");",
 #endif
+  0
+};
+
+static const char* c_size_trailer[] =
+{
   "",
   "/*",
   " * Symbol table size.",
@@ -110,6 +127,115 @@ static const char* c_rtl_call_body[] =
   0
 };
 
+/**
+ * The hash index of the symbol table.
+ *
+ * The index follows the 0xdeadbeef terminator of the table at the next 32bit
+ * aligned offset from the start of the table. A loader that stops at the
+ * terminator does not see it. All words are in the target's byte order:
+ *
+ *   magic             0x52544c48 ("RTLH")
+ *   version           1
+ *   count             The number of symbols.
+ *   buckets           The number of buckets, a power of 2.
+ *   bucket[buckets+1] The index of the first entry of each bucket. The
+ *                     entries of bucket b are bucket[b] to bucket[b+1] - 1.
+ *   entry[count]      A hash and the offset from the start of the table of
+ *                     the symbol's name. The symbol's value follows the name.
+ *
+ * The hash is the loader's symbol name hash, h = h * 33 + c starting at 5381,
+ * and a symbol is in bucket hash & (buckets - 1). The entries of a bucket are
+ * sorted by hash.
+ */
+static const uint32_t index_magic = 0x52544c48;
+static const uint32_t index_version = 1;
+
+/**
+ * The symbol name hash.
+ */
+static uint32_t
+symbol_hash (const std::string& name)
+{
+  uint32_t hash = 5381;
+  for (std::string::const_iterator ci = name.begin (); ci != name.end (); ++ci)
+    hash = (hash * 33) + (uint8_t) *ci;
+  return hash;
+}
+
+/**
+ * An entry in the hash index.
+ */
+struct index_entry
+{
+  uint32_t hash;   //< The hash of the name.
+  uint32_t name;   //< The offset of the name in the table.
+  uint32_t bucket; //< The bucket.
+
+  bool operator< (const index_entry& rhs) const {
+    if (bucket != rhs.bucket)
+      return bucket < rhs.bucket;
+    return hash < rhs.hash;
+  }
+};
+
+/**
+ * Build the words of the hash index of the global symbols. The table holds
+ * the globals in order, each name followed by a 32bit value.
+ */
+static void
+build_index (const rld::symbols::symtab& globals,
+             std::vector < uint32_t >&   index)
+{
+  std::vector < index_entry > entries;
+  uint32_t                    offset = 0;
+
+  entries.reserve (globals.size ());
+
+  for (rld::symbols::symtab::const_iterator si = globals.begin ();
+       si != globals.end ();
+       ++si)
+  {
+    const std::string& name = (*si).first;
+    index_entry        entry = { symbol_hash (name), offset, 0 };
+    entries.push_back (entry);
+    offset += name.size () + 1 + sizeof (uint32_t);
+  }
+
+  uint32_t buckets = 1;
+  while (buckets < entries.size ())
+    buckets <<= 1;
+
+  for (std::vector < index_entry >::iterator ei = entries.begin ();
+       ei != entries.end ();
+       ++ei)
+    (*ei).bucket = (*ei).hash & (buckets - 1);
+
+  std::stable_sort (entries.begin (), entries.end ());
+
+  index.clear ();
+  index.reserve (4 + buckets + 1 + (entries.size () * 2));
+  index.push_back (index_magic);
+  index.push_back (index_version);
+  index.push_back (entries.size ());
+  index.push_back (buckets);
+
+  size_t e = 0;
+  for (uint32_t b = 0; b <= buckets; ++b)
+  {
+    while ((e < entries.size ()) && (entries[e].bucket < b))
+      ++e;
+    index.push_back (e);
+  }
+
+  for (std::vector < index_entry >::const_iterator ei = entries.begin ();
+       ei != entries.end ();
+       ++ei)
+  {
+    index.push_back ((*ei).hash);
+    index.push_back ((*ei).name);
+  }
+}
+
 /**
  * Paint the data to the temporary file.
  */
@@ -149,9 +275,11 @@ c_embedded_trailer (rld::process::tempfile& c)
 static void
 generate_c (rld::process::tempfile& c,
               rld::symbols::table&  symbols,
-              bool                  embed)
+              bool                  embed,
+              bool                  hash)
 {
   temporary_file_paint (c, c_header);
+  temporary_file_paint (c, c_table_header);
 
   for (rld::symbols::symtab::const_iterator si = symbols.globals ().begin ();
        si != symbols.globals ().end ();
@@ -175,6 +303,23 @@ generate_c (rld::process::tempfile& c,
 
   temporary_file_paint (c, c_trailer);
 
+  if (hash)
+  {
+    std::vector < uint32_t > index;
+    build_index (symbols.globals (), index);
+    c.write_line ("asm(\"  .balign  4\");");
+    for (std::vector < uint32_t >::const_iterator ii = index.begin ();
+         ii != index.end ();
+         ++ii)
+    {
+      std::stringstream oss;
+      oss << std::hex << std::setfill ('0') << std::setw (8) << *ii;
+      c.write_line ("asm(\"  .long 0x" + oss.str () + "\");");
+    }
+  }
+
+  temporary_file_paint (c, c_size_trailer);
+
   if (embed)
     c_embedded_trailer (c);
   else
@@ -185,14 +330,15 @@ static void
 generate_symmap (rld::process::tempfile& c,
                  const std::string&      output,
                  rld::symbols::table&    symbols,
-                 bool                    embed)
+                 bool                    embed,
+                 bool                    hash)
 {
   c.open (true);
 
   if (rld::verbose ())
     std::cout << "symbol C file: " << c.name () << std::endl;
 
-  generate_c (c, symbols, embed);
+  generate_c (c, symbols, embed, hash);
 
   if (rld::verbose ())
     std::cout << "symbol O file: " << output << std::endl;
@@ -226,6 +372,383 @@ generate_symmap (rld::process::tempfile& c,
   }
 }
 
+/**
+ * The relocation that places a symbol's address in a 32bit word at any
+ * alignment for the machines an embedded symbol table can be written directly
+ * for.
+ */
+struct machine_reloc
+{
+  unsigned int machinetype; //< The ELF machine type.
+  uint32_t     type;        //< The relocation type.
+  bool         rela;        //< The machine uses RELA records.
+};
+
+static const machine_reloc machine_relocs[] =
+{
+  { EM_386,      R_386_32,      false },
+  { EM_ARM,      2,             false }, /* R_ARM_ABS32 */
+  { EM_MIPS,     R_MIPS_32,     false },
+  { EM_68K,      1,             true  }, /* R_68K_32 */
+  { EM_COLDFIRE, 1,             true  }, /* R_68K_32 */
+  { EM_PPC,      R_PPC_UADDR32, true  },
+  { EM_SH,       1,             true  }, /* R_SH_DIR32 */
+  { EM_SPARC,    R_SPARC_UA32,  true  },
+  { EM_NONE,     0,             false }
+};
+
+/**
+ * Append a 32bit word to the symbol table in the target's byte order.
+ */
+static void
+table_append_word (std::vector < uint8_t >& table, uint32_t word, bool msb)
+{
+  for (int b = 0; b < 4; ++b)
+  {
+    int shift = msb ? (3 - b) * 8 : b * 8;
+    table.push_back ((word >> shift) & 0xff);
+  }
+}
+
+/**
+ * Write the symbol table object with the ELF writer. The .rodata section is
+ * the table the assembler in the C file creates. The table and its size are
+ * hidden global symbols so the compiled constructor or embedded call can
+ * reference them. In embedded mode the table's values are relocation records
+ * against the kernel's symbols.
+ */
+static void
+write_symmap_object (const std::string&   name,
+                     rld::symbols::table& symbols,
+                     bool                 embed,
+                     bool                 hash)
+{
+  const machine_reloc* reloc = 0;
+
+  if (embed)
+  {
+    for (reloc = &machine_relocs[0]; reloc->machinetype != EM_NONE; ++reloc)
+      if (reloc->machinetype == rld::elf::object_machine_type ())
+        break;
+    if (reloc->machinetype == EM_NONE)
+      throw rld::error ("no embedded relocation for " +
+                        rld::elf::machine_type () + "; use the C compiler",
+                        "direct symbol table");
+  }
+
+  const rld::symbols::symtab& globals = symbols.globals ();
+  bool                        msb =
+    rld::elf::object_datatype () == ELFDATA2MSB;
+  std::vector < uint8_t >     table;
+  std::vector < uint32_t >    offsets;
+  std::string                 strtab (1, '\0');
+  std::vector < uint32_t >    names;
+
+  offsets.reserve (globals.size ());
+  names.reserve (globals.size ());
+
+  for (rld::symbols::symtab::const_iterator si = globals.begin ();
+       si != globals.end ();
+       ++si)
+  {
+    const rld::symbols::symbol& sym = *((*si).second);
+    const std::string&          sname = sym.name ();
+
+    table.insert (table.end (), sname.begin (), sname.end ());
+    table.push_back (0);
+    offsets.push_back (table.size ());
+    table_append_word (table, embed ? 0 : sym.value (), msb);
+
+    if (embed)
+    {
+      names.push_back (strtab.size ());
+      strtab += sname;
+      strtab += '\0';
+    }
+  }
+
+  table.push_back (0);
+  table.push_back (0xde);
+  table.push_back (0xad);
+  table.push_back (0xbe);
+  table.push_back (0xef);
+  while ((table.size () % 4) != 0)
+    table.push_back (0);
+
+  if (hash)
+  {
+    std::vector < uint32_t > index;
+    build_index (globals, index);
+    for (std::vector < uint32_t >::const_iterator ii = index.begin ();
+         ii != index.end ();
+         ++ii)
+      table_append_word (table, *ii, msb);
+  }
+
+  uint32_t table_size = table.size ();
+  table_append_word (table, table_size, msb);
+
+  uint32_t globals_name = strtab.size ();
+  strtab += "rtems__rtl_base_globals";
+  strtab += '\0';
+  uint32_t globals_size_name = strtab.size ();
+  strtab += "rtems__rtl_base_globals_size";
+  strtab += '\0';
+
+  rld::files::object obj (name);
+
+  obj.open (true);
+  obj.begin ();
+
+  rld::elf::file& elf = obj.elf ();
+
+  elf.set_header (ET_REL,
+                  rld::elf::object_class (),
+                  rld::elf::object_machine_type (),
+                  rld::elf::object_datatype (),
+                  rld::elf::object_flags ());
+
+  /*
+   * The sections in the order they are created.
+   */
+  const int rodata_index = 1;
+  const int symtab_index = 2;
+  const int strtab_index = 3;
+  const int gnustack_index = 4;
+  const int reloc_index = 5;
+
+  rld::elf::elf_type reloc_type =
+    reloc && reloc->rela ? ELF_T_RELA : ELF_T_REL;
+  int                word_align =
+    rld::elf::object_class () == ELFCLASS64 ? 8 : 4;
+  size_t             sym_size =
+    ::gelf_fsize (elf.get_elf (), ELF_T_SYM, 1, EV_CURRENT);
+  size_t             reloc_size =
+    ::gelf_fsize (elf.get_elf (), reloc_type, 1, EV_CURRENT);
+  size_t             syms = 3 + (embed ? globals.size () : 0);
+
+  std::vector < uint8_t > symtab (syms * sym_size);
+  std::vector < uint8_t > relocs (embed ? offsets.size () * reloc_size : 0);
+
+  rld::elf::section rodata (elf,
+                            rodata_index,
+                            ".rodata",
+                            SHT_PROGBITS,
+                            4,
+                            SHF_ALLOC,
+                            0,
+                            0,
+                            table.size ());
+  rodata.add_data (ELF_T_BYTE, 4, table.size (), &table[0]);
+  elf.add (rodata);
+
+  rld::elf::section symsec (elf,
+                            symtab_index,
+                            ".symtab",
+                            SHT_SYMTAB,
+                            word_align,
+                            0,
+                            0,
+                            0,
+                            symtab.size (),
+                            strtab_index,
+                            1,
+                            sym_size);
+  symsec.add_data (ELF_T_SYM, word_align, symtab.size (), &symtab[0]);
+  elf.add (symsec);
+
+  rld::elf::section strsec (elf,
+                            strtab_index,
+                            ".strtab",
+                            SHT_STRTAB,
+                            1,
+                            0,
+                            0,
+                            0,
+                            strtab.size ());
+  strsec.add_data (ELF_T_BYTE, 1, strtab.size (), (void*) strtab.c_str ());
+  elf.add (strsec);
+
+  /*
+   * A compiler that marks its objects as not needing an executable stack
+   * expects all the objects in a link to be marked.
+   */
+  rld::elf::section gnustack (elf,
+                              gnustack_index,
+                              ".note.GNU-stack",
+                              SHT_PROGBITS,
+                              1,
+                              0,
+                              0,
+                              0,
+                              0);
+  elf.add (gnustack);
+
+  /*
+   * The symbols after the null symbol are all global. The two table symbols
+   * are followed by the kernel's symbols if embedded.
+   */
+  rld::elf::elf_sym esym;
+
+  ::memset (&esym, 0, sizeof (esym));
+  if (!::gelf_update_sym (symsec.data (), 0, &esym))
+    throw rld::error (::elf_errmsg (-1), "gelf_update_sym");
+
+  esym.st_name = globals_name;
+  esym.st_value = 0;
+  esym.st_size = table_size;
+  esym.st_info = GELF_ST_INFO (STB_GLOBAL, STT_OBJECT);
+  esym.st_other = STV_HIDDEN;
+  esym.st_shndx = rodata_index;
+  if (!::gelf_update_sym (symsec.data (), 1, &esym))
+    throw rld::error (::elf_errmsg (-1), "gelf_update_sym");
+
+  esym.st_name = globals_size_name;
+  esym.st_value = table_size;
+  esym.st_size = 4;
+  if (!::gelf_update_sym (symsec.data (), 2, &esym))
+    throw rld::error (::elf_errmsg (-1), "gelf_update_sym");
+
+  if (embed)
+  {
+    std::string rname = reloc->rela ? ".rela.rodata" : ".rel.rodata";
+
+    rld::elf::section relsec (elf,
+                              reloc_index,
+                              rname,
+                              reloc->rela ? SHT_RELA : SHT_REL,
+                              word_align,
+                              SHF_INFO_LINK,
+                              0,
+                              0,
+                              relocs.size (),
+                              symtab_index,
+                              rodata_index,
+                              reloc_size);
+    relsec.add_data (reloc_type, word_align, relocs.size (), &relocs[0]);
+    elf.add (relsec);
+
+    for (size_t s = 0; s < offsets.size (); ++s)
+    {
+      ::memset (&esym, 0, sizeof (esym));
+      esym.st_name = names[s];
+      esym.st_info = GELF_ST_INFO (STB_GLOBAL, STT_NOTYPE);
+      esym.st_shndx = SHN_UNDEF;
+      if (!::gelf_update_sym (symsec.data (), 3 + s, &esym))
+        throw rld::error (::elf_errmsg (-1), "gelf_update_sym");
+
+      rld::elf::elf_xword info = GELF_R_INFO (3 + s, reloc->type);
+
+      if (reloc->rela)
+      {
+        rld::elf::elf_rela rela;
+        rela.r_offset = offsets[s];
+        rela.r_info = info;
+        rela.r_addend = 0;
+        if (!::gelf_update_rela (relsec.data (), s, &rela))
+          throw rld::error (::elf_errmsg (-1), "gelf_update_rela");
+      }
+      else
+      {
+        rld::elf::elf_rel rel;
+        rel.r_offset = offsets[s];
+        rel.r_info = info;
+        if (!::gelf_update_rel (relsec.data (), s, &rel))
+          throw rld::error (::elf_errmsg (-1), "gelf_update_rel");
+      }
+    }
+  }
+
+  elf.write ();
+
+  obj.end ();
+  obj.close ();
+}
+
+/**
+ * Write the symbol table object directly and compile the constructor or
+ * embedded call, which is the same for every kernel so it can be cached. A
+ * partial link combines them into the output object file.
+ */
+static void
+generate_symmap_direct (rld::process::tempfile& c,
+                        const std::string&      output,
+                        rld::symbols::table&    symbols,
+                        bool                    embed,
+                        bool                    hash)
+{
+  rld::process::tempfile table (".o");
+  rld::process::tempfile stub (".o");
+
+  if (rld::verbose ())
+    std::cout << "symbol table O file: " << table.name () << std::endl;
+
+  write_symmap_object (table.name (), symbols, embed, hash);
+
+  c.open (true);
+
+  if (rld::verbose ())
+    std::cout << "symbol C file: " << c.name () << std::endl;
+
+  temporary_file_paint (c, c_header);
+
+  if (embed)
+    c_embedded_trailer (c);
+  else
+    c_constructor_trailer (c);
+
+  rld::process::arg_container args;
+
+  rld::cc::make_cc_command (args);
+  rld::cc::append_flags (rld::cc::ft_cflags, args);
+
+  args.push_back ("-O2");
+
+  rld::process::tempfile out;
+  rld::process::tempfile err;
+  rld::process::status   status;
+
+  status = rld::cc::compile_object (args,
+                                    c.name (),
+                                    stub.name (),
+                                    out.name (),
+                                    err.name ());
+
+  if ((status.type != rld::process::status::normal) ||
+      (status.code != 0))
+  {
+    err.output (rld::cc::get_cc (), std::cout);
+    throw rld::error ("Compiler error", "compiling wrapper");
+  }
+
+  if (rld::verbose ())
+    std::cout << "symbol O file: " << output << std::endl;
+
+  args.clear ();
+
+  rld::cc::make_cc_command (args);
+  rld::cc::append_flags (rld::cc::ft_cflags, args);
+
+  args.push_back ("-r");
+  args.push_back ("-nostdlib");
+  args.push_back ("-o");
+  args.push_back (output);
+  args.push_back (table.name ());
+  args.push_back (stub.name ());
+
+  status = rld::process::execute (rld::cc::get_cc (),
+                                  args,
+                                  out.name (),
+                                  err.name ());
+
+  if ((status.type != rld::process::status::normal) ||
+      (status.code != 0))
+  {
+    err.output (rld::cc::get_cc (), std::cout);
+    throw rld::error ("Linker error", "linking symbol table");
+  }
+}
+
 /**
  * RTEMS Symbols options.
  */
@@ -242,6 +765,10 @@ static struct option rld_opts[] = {
   { "cc",          required_argument,      NULL,           'C' },
   { "exec-prefix", required_argument,      NULL,           'E' },
   { "cflags",      required_argument,      NULL,           'c' },
+  { "jobs",        required_argument,      NULL,           'j' },
+  { "direct",      no_argument,            NULL,           'D' },
+  { "cache",       required_argument,      NULL,           'A' },
+  { "hash",        no_argument,            NULL,           'H' },
   { NULL,          0,                      NULL,            0 }
 };
 
@@ -262,7 +789,14 @@ usage (int exit_code)
             << " -m file   : output a map file (also --map)" << std::endl
             << " -C file   : execute file as the target C compiler (also --cc)" << std::endl
             << " -E prefix : the RTEMS tool prefix (also --exec-prefix)" << std::endl
-            << " -c cflags : C compiler flags (also --cflags)" << std::endl;
+            << " -c cflags : C compiler flags (also --cflags)" << std::endl
+            << " -j jobs   : number of threads demangling the map's C++" << std::endl
+            << "             symbols (also --jobs)" << std::endl
+            << " -D        : write the symbol table directly, only compile the" << std::endl
+            << "             constructor or embedded call (also --direct)" << std::endl
+            << " -A path   : cache the compiled constructor or embedded call" << std::endl
+            << "             in path (also --cache)" << std::endl
+            << " -H        : add a hash index to the symbol table (also --hash)" << std::endl;
   ::exit (exit_code);
 }
 
@@ -317,12 +851,15 @@ main (int argc, char* argv[])
     std::string         cc;
     std::string         symc;
     bool                embed = false;
+    bool                direct = false;
+    bool                hash = false;
+    int                 jobs = 1;
 
     rld::set_cmdline (argc, argv);
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hvVwkef:S:o:m:E:c:C:", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hvVwkef:S:o:m:E:c:C:j:DA:H", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -378,6 +915,24 @@ main (int argc, char* argv[])
           symc = optarg;
           break;
 
+        case 'j':
+          jobs = ::strtoul (optarg, 0, 0);
+          if (jobs < 1)
+            throw rld::error ("invalid number of jobs", "options");
+          break;
+
+        case 'D':
+          direct = true;
+          break;
+
+        case 'A':
+          rld::cc::set_object_cache (optarg);
+          break;
+
+        case 'H':
+          hash = true;
+          break;
+
         case '?':
           usage (3);
           break;
@@ -449,6 +1004,7 @@ main (int argc, char* argv[])
         mout << "RTEMS Kernel Symbols Map" << std::endl
              << " kernel: " << kernel_name << std::endl
              << std::endl;
+        rld::symbols::demangle (symbols, jobs);
         rld::symbols::output (mout, symbols);
         mout.close ();
       }
@@ -469,7 +1025,10 @@ main (int argc, char* argv[])
         /*
          * Generate and compile the symbol map.
          */
-        generate_symmap (c, output, symbols, embed);
+        if (direct)
+          generate_symmap_direct (c, output, symbols, embed, hash);
+        else
+          generate_symmap (c, output, symbols, embed, hash);
       }
 
       kernel.close ();
@@ -28,16 +28,22 @@
 
 #include <algorithm>
 #include <cctype>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <iomanip>
 #include <locale>
+#include <map>
 #include <sstream>
+#include <vector>
 
 #include <cxxabi.h>
+#include <errno.h>
 #include <signal.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <unistd.h>
 
 #include <getopt.h>
@@ -45,6 +51,8 @@
 #include <rld.h>
 #include <rld-cc.h>
 #include <rld-config.h>
+#include <rld-files.h>
+#include <rld-path.h>
 #include <rld-process.h>
 #include <rld-rtems.h>
 #include <rld-size-of.h>
@@ -390,6 +398,16 @@ namespace rld
        */
       void append_user_types_to (rld::size_of::types& rtypes);
 
+      /**
+       * Get the signature of a trace.
+       */
+      const signature& get_signature (const std::string& trace) const;
+
+      /**
+       * Get the size of a type found by generate_sizeof.
+       */
+      size_t get_type_size (const std::string& name) const;
+
 
     private:
 
@@ -405,6 +423,211 @@ namespace rld
 
     };
 
+    /**
+     * A latency histogram. There is a bucket for each power of 2 nanoseconds.
+     */
+    struct histogram
+    {
+      uint64_t count;        /**< The number of latencies. */
+      uint64_t min;          /**< The smallest latency. */
+      uint64_t max;          /**< The largest latency. */
+      uint64_t total;        /**< The sum of the latencies. */
+      uint64_t buckets[64];  /**< The count in each bucket. */
+
+      histogram ();
+
+      /**
+       * Add a latency in nanoseconds.
+       */
+      void add (uint64_t latency);
+
+      /**
+       * Output the histogram.
+       */
+      void output (std::ostream& out) const;
+    };
+
+    /**
+     * A record decoded from a trace buffer. The data points into the dump.
+     */
+    struct buffer_record
+    {
+      uint32_t       cpu;       /**< The CPU's buffer holding the record. */
+      uint32_t       index;     /**< The function's index. */
+      bool           exit;      /**< The function exit record. */
+      bool           irq;       /**< Recorded in an interrupt. */
+      uint32_t       thread;    /**< The executing thread's id. */
+      uint32_t       status;    /**< The executing thread's priorities. */
+      uint32_t       state;     /**< The executing thread's state. */
+      uint64_t       time;      /**< The time in nanoseconds. */
+      const uint8_t* data;      /**< The arguments or return value. */
+      size_t         data_size; /**< The size of the data. */
+    };
+
+    /**
+     * A container of buffer records.
+     */
+    typedef std::vector < buffer_record > buffer_records;
+
+    /**
+     * The layout of a traced function's records in the trace buffer.
+     */
+    struct buffer_function
+    {
+      std::string            name;       /**< The function's name. */
+      signature              sig;        /**< The function's signature. */
+      std::vector < size_t > args;       /**< The size of each argument. */
+      size_t                 entry_size; /**< The size of the arguments. */
+      size_t                 ret_size;   /**< The size of the return value. */
+      uint64_t               entries;    /**< The number of entry records. */
+      uint64_t               exits;      /**< The number of exit records. */
+      histogram              latency;    /**< The entry to exit latency. */
+
+      buffer_function (const std::string& name,
+                       const signature&   sig);
+    };
+
+    /**
+     * A container of buffer functions in trace index order.
+     */
+    typedef std::vector < buffer_function > buffer_functions;
+
+    /**
+     * Trace buffer decoder. A raw dump of the trace buffer generator's
+     * __rtld_tbg_buffer is decoded using the tracer's signatures and the
+     * target's type sizes. The records are streamed to the output as text or
+     * as a Common Trace Format (CTF) trace and the latency of each function
+     * is collected. A dump of the per-CPU generator's buffers holds a buffer
+     * for each CPU and the records are merged by time.
+     */
+    class buffer_decoder
+    {
+    public:
+      /**
+       * The output formats.
+       */
+      enum format
+      {
+        format_text, /**< A line of text per record. */
+        format_ctf   /**< A CTF trace directory. */
+      };
+
+      /**
+       * Construct the decoder for the traces of a tracer.
+       */
+      buffer_decoder (const tracer& tracer_, bool big_endian, size_t cpus = 1);
+
+      /**
+       * Decode a dump writing the records to the output.
+       */
+      void decode (const std::string& dump,
+                   format             fmt,
+                   const std::string& output);
+
+      /**
+       * Output the latency histograms.
+       */
+      void output_latencies (std::ostream& out) const;
+
+      /**
+       * Map a format's name to the format.
+       */
+      static format get_format (const std::string& name);
+
+    private:
+
+      /**
+       * Decode the records in the dump's data.
+       */
+      void decode_records (const uint8_t* buffer,
+                           size_t         size,
+                           format         fmt,
+                           std::ostream&  out);
+
+      /**
+       * Read the record at the offset moving the offset to the next record.
+       * Returns false if there are no more records.
+       */
+      bool read_record (const uint8_t* buffer,
+                        size_t         size,
+                        size_t&        offset,
+                        buffer_record& rec) const;
+
+      /**
+       * Process a record in time order.
+       */
+      void process_record (const buffer_record& rec,
+                           format               fmt,
+                           std::ostream&        out);
+
+      /**
+       * Match an exit record to its entry returning the latency or -1 if
+       * there is no entry.
+       */
+      int64_t match (const buffer_record& rec);
+
+      /**
+       * Read a target word.
+       */
+      uint32_t get32 (const uint8_t* p) const;
+
+      /**
+       * Read a target value of up to 8 bytes.
+       */
+      uint64_t get_value (const uint8_t* p, size_t size) const;
+
+      /**
+       * Write a record as a line of text.
+       */
+      void write_text (std::ostream&        out,
+                       const buffer_record& rec,
+                       int64_t              latency);
+
+      /**
+       * Write the CTF metadata file.
+       */
+      void write_ctf_metadata (const std::string& path);
+
+      /**
+       * Write a record as a CTF event to the packet, flushing a full packet.
+       */
+      void write_ctf (std::ostream& out, const buffer_record& rec);
+
+      /**
+       * Flush the CTF packet to the stream.
+       */
+      void flush_ctf (std::ostream& out);
+
+      /**
+       * Put a value into the CTF packet in the target's byte order.
+       */
+      void put (uint64_t value, size_t size);
+
+      /**
+       * A call in progress on a thread.
+       */
+      typedef std::pair < uint32_t, uint64_t > call;
+
+      /**
+       * The calls in progress on a thread.
+       */
+      typedef std::vector < call > calls;
+
+      /**
+       * The calls in progress on each thread.
+       */
+      typedef std::map < uint32_t, calls > thread_calls;
+
+      buffer_functions        functions;  /**< The traced functions. */
+      bool                    big_endian; /**< The buffer is big endian. */
+      size_t                  cpus;       /**< The number of CPU buffers. */
+      thread_calls            threads;    /**< The calls on each thread. */
+      uint64_t                records;    /**< The number of records. */
+      uint64_t                unmatched;  /**< Exits without an entry. */
+      std::vector < uint8_t > packet;     /**< The CTF packet being filled. */
+      std::string             line;       /**< The text line being formatted. */
+    };
+
     /**
      * Trace Linker.
      */
@@ -437,6 +660,15 @@ namespace rld
       void link (rld::process::tempfile& o,
                  const std::string&      ld_cmds);
 
+      /**
+       * Decode a trace buffer dump.
+       */
+      void decode (const std::string& dump,
+                   const std::string& format,
+                   const std::string& output,
+                   bool               big_endian,
+                   size_t             cpus);
+
       /**
        * Dump the linker.
        */
@@ -1887,6 +2119,722 @@ namespace rld
       }
     }
 
+    const signature&
+    tracer::get_signature (const std::string& trace) const
+    {
+      for (functions::const_iterator fi = functions_.begin ();
+           fi != functions_.end ();
+           ++fi)
+      {
+        const function&            funcs = *fi;
+        signatures::const_iterator si = funcs.signatures_.find (trace);
+        if (si != funcs.signatures_.end ())
+          return (*si).second;
+      }
+      throw rld::error ("not found", "trace function: " + trace);
+    }
+
+    size_t
+    tracer::get_type_size (const std::string& name) const
+    {
+      for (types::const_iterator ti = types_.begin ();
+           ti != types_.end ();
+           ++ti)
+      {
+        std::string l = rld::find_replace ((*ti).name, "array ", "");
+        l = rld::find_replace (l, "enumeration ", "");
+        if (l == name)
+          return (*ti).size;
+      }
+      throw rld::error ("no size", "type: " + name);
+    }
+
+    histogram::histogram ()
+      : count (0),
+        min (0),
+        max (0),
+        total (0)
+    {
+      for (int b = 0; b < 64; ++b)
+        buckets[b] = 0;
+    }
+
+    void
+    histogram::add (uint64_t latency)
+    {
+      if ((count == 0) || (latency < min))
+        min = latency;
+      if (latency > max)
+        max = latency;
+      ++count;
+      total += latency;
+      int bucket = 0;
+      while ((bucket < 63) && ((latency >> (bucket + 1)) != 0))
+        ++bucket;
+      ++buckets[bucket];
+    }
+
+    void
+    histogram::output (std::ostream& out) const
+    {
+      if (count == 0)
+        return;
+
+      out << "  min: " << min << " ns  max: " << max
+          << " ns  mean: " << total / count << " ns" << std::endl;
+
+      uint64_t most = 0;
+      for (int b = 0; b < 64; ++b)
+        if (buckets[b] > most)
+          most = buckets[b];
+
+      for (int b = 0; b < 64; ++b)
+      {
+        if (buckets[b] != 0)
+        {
+          uint64_t low = b == 0 ? 0 : 1ULL << b;
+          out << "  " << std::setw (12) << low
+              << " - " << std::setw (12) << (2ULL << b) - 1 << " ns: "
+              << std::setw (10) << buckets[b] << ' '
+              << std::string ((size_t) ((buckets[b] * 40 + most - 1) / most), '#')
+              << std::endl;
+        }
+      }
+    }
+
+    buffer_function::buffer_function (const std::string& name,
+                                      const signature&   sig)
+      : name (name),
+        sig (sig),
+        entry_size (0),
+        ret_size (0),
+        entries (0),
+        exits (0)
+    {
+    }
+
+    /*
+     * The header of a record is the function index, the size, the exit and
+     * interrupt flags, the executing thread's id, status and state and then a
+     * 64bit timestamp. This is RTLD_TBG_REC_OVERHEAD in rtld-trace-buffer.ini.
+     */
+    static const size_t   tbg_rec_overhead = 6 * sizeof (uint32_t);
+    static const uint32_t tbg_index_mask = 0xffff;
+    static const uint32_t tbg_size_mask = 0x3fff;
+    static const uint32_t tbg_exit = 1 << 30;
+    static const uint32_t tbg_in_irq = 1U << 31;
+
+    /*
+     * Order records by time.
+     */
+    static bool
+    record_time_order (const buffer_record& lhs, const buffer_record& rhs)
+    {
+      return lhs.time < rhs.time;
+    }
+
+    /*
+     * CTF packets are flushed when this size is reached.
+     */
+    static const size_t   ctf_packet_size = 1024 * 1024;
+    static const uint32_t ctf_magic = 0xc1fc1fc1;
+    static const size_t   ctf_packet_header = 4 + 4 + 8 + 8;
+
+    buffer_decoder::buffer_decoder (const tracer& tracer_,
+                                    bool          big_endian,
+                                    size_t        cpus)
+      : big_endian (big_endian),
+        cpus (cpus),
+        records (0),
+        unmatched (0)
+    {
+      const rld::strings& traces = tracer_.get_traces ();
+      for (rld::strings::const_iterator ti = traces.begin ();
+           ti != traces.end ();
+           ++ti)
+      {
+        const signature& sig = tracer_.get_signature (*ti);
+        buffer_function  func (*ti, sig);
+        if (sig.has_args ())
+        {
+          for (size_t a = 0; a < sig.args.size (); ++a)
+          {
+            size_t size = tracer_.get_type_size (sig.args[a]);
+            func.args.push_back (size);
+            func.entry_size += size;
+          }
+        }
+        if (sig.has_ret ())
+          func.ret_size = tracer_.get_type_size (sig.ret);
+        if (rld::verbose () >= RLD_VERBOSE_DETAILS)
+          std::cout << "decode: " << std::setw (4) << functions.size ()
+                    << ' ' << func.name << ": entry: " << func.entry_size
+                    << " ret: " << func.ret_size << std::endl;
+        functions.push_back (func);
+      }
+    }
+
+    buffer_decoder::format
+    buffer_decoder::get_format (const std::string& name)
+    {
+      if (name == "text")
+        return format_text;
+      if (name == "ctf")
+        return format_ctf;
+      throw rld::error ("invalid format", "decode: " + name);
+    }
+
+    void
+    buffer_decoder::decode (const std::string& dump,
+                            format             fmt,
+                            const std::string& output)
+    {
+      rld::files::image img (dump, false);
+
+      img.open ();
+
+      try
+      {
+        const uint8_t*          buffer = img.mapped ();
+        size_t                  size = img.mapped_size ();
+        std::vector < uint8_t > data;
+
+        if (!buffer)
+        {
+          size = img.size ();
+          data.resize (size);
+          if (size && (img.read (&data[0], size) != (ssize_t) size))
+            throw rld::error ("short read", "decode: " + dump);
+          buffer = size ? &data[0] : 0;
+        }
+
+        if (rld::verbose ())
+          std::cout << "decode: " << dump << ": " << size << " bytes, "
+                    << (big_endian ? "big" : "little") << " endian" << std::endl;
+
+        if (fmt == format_ctf)
+        {
+          if (output.empty ())
+            throw rld::error ("no output directory", "decode: ctf");
+          if (!rld::path::check_directory (output))
+          {
+#ifdef _WIN32
+            if (::mkdir (output.c_str ()) < 0)
+#else
+            if (::mkdir (output.c_str (), 0777) < 0)
+#endif
+              throw rld::error (::strerror (errno), "mkdir: " + output);
+          }
+
+          std::string path;
+
+          rld::path::path_join (output, "metadata", path);
+          write_ctf_metadata (path);
+
+          rld::path::path_join (output, "stream", path);
+          std::ofstream out (path.c_str (),
+                             std::ios_base::out |
+                             std::ios_base::binary |
+                             std::ios_base::trunc);
+          if (!out.is_open ())
+            throw rld::error ("cannot open", "decode: " + path);
+          decode_records (buffer, size, fmt, out);
+          flush_ctf (out);
+          if (!out)
+            throw rld::error ("write failed", "decode: " + path);
+        }
+        else if (output.empty ())
+        {
+          decode_records (buffer, size, fmt, std::cout);
+        }
+        else
+        {
+          std::ofstream out (output.c_str (),
+                             std::ios_base::out | std::ios_base::trunc);
+          if (!out.is_open ())
+            throw rld::error ("cannot open", "decode: " + output);
+          decode_records (buffer, size, fmt, out);
+          if (!out)
+            throw rld::error ("write failed", "decode: " + output);
+        }
+      }
+      catch (...)
+      {
+        img.close ();
+        throw;
+      }
+
+      img.close ();
+    }
+
+    void
+    buffer_decoder::decode_records (const uint8_t* buffer,
+                                    size_t         size,
+                                    format         fmt,
+                                    std::ostream&  out)
+    {
+      buffer_record rec;
+      size_t        offset = 0;
+
+      if (cpus == 1)
+      {
+        rec.cpu = 0;
+        while (read_record (buffer, size, offset, rec))
+          process_record (rec, fmt, out);
+      }
+      else
+      {
+        /*
+         * Each CPU's buffer is in time order, near enough, so the records
+         * are merged by time. A stable sort keeps the order of the records
+         * with the same time.
+         */
+        size_t cpu_size = size / cpus;
+
+        if ((cpu_size * cpus) != size)
+          throw rld::error ("size is not a multiple of the CPUs",
+                            "decode: cpus " + rld::to_string (cpus));
+
+        buffer_records recs;
+
+        for (size_t cpu = 0; cpu < cpus; ++cpu)
+        {
+          rec.cpu = cpu;
+          offset = 0;
+          while (read_record (buffer + cpu * cpu_size, cpu_size, offset, rec))
+            recs.push_back (rec);
+        }
+
+        std::stable_sort (recs.begin (), recs.end (), record_time_order);
+
+        for (buffer_records::const_iterator ri = recs.begin ();
+             ri != recs.end ();
+             ++ri)
+          process_record (*ri, fmt, out);
+      }
+
+      if (rld::verbose ())
+        std::cout << "decode: records: " << records << std::endl;
+    }
+
+    bool
+    buffer_decoder::read_record (const uint8_t* buffer,
+                                 size_t         size,
+                                 size_t&        offset,
+                                 buffer_record& rec) const
+    {
+      if ((size - offset) < sizeof (uint32_t))
+        return false;
+
+      const uint8_t* p = buffer + offset;
+      uint32_t       header = get32 (p);
+
+      /*
+       * The unused part of the buffer is zero.
+       */
+      if (header == 0)
+        return false;
+
+      size_t rec_size = (header >> 16) & tbg_size_mask;
+
+      if ((rec_size < tbg_rec_overhead) || (rec_size > (size - offset)))
+        throw rld::error ("invalid record size",
+                          "decode: cpu " + rld::to_string (rec.cpu) +
+                          " offset " + rld::to_string (offset));
+
+      rec.index = header & tbg_index_mask;
+      rec.exit = (header & tbg_exit) != 0;
+      rec.irq = (header & tbg_in_irq) != 0;
+
+      if (rec.index >= functions.size ())
+        throw rld::error ("invalid function index",
+                          "decode: cpu " + rld::to_string (rec.cpu) +
+                          " offset " + rld::to_string (offset));
+
+      rec.thread = get32 (p + 4);
+      rec.status = get32 (p + 8);
+      rec.state = get32 (p + 12);
+      rec.time = ((uint64_t) get32 (p + 16) << 32) | get32 (p + 20);
+      rec.data = p + tbg_rec_overhead;
+      rec.data_size = rec_size - tbg_rec_overhead;
+
+      offset += ((rec_size - 1) / sizeof (uint32_t) + 1) * sizeof (uint32_t);
+
+      return true;
+    }
+
+    void
+    buffer_decoder::process_record (const buffer_record& rec,
+                                    format               fmt,
+                                    std::ostream&        out)
+    {
+      buffer_function& func = functions[rec.index];
+      int64_t          latency = -1;
+
+      if (rec.exit)
+      {
+        ++func.exits;
+        latency = match (rec);
+        if (latency >= 0)
+          func.latency.add (latency);
+      }
+      else
+      {
+        ++func.entries;
+        threads[rec.thread].push_back (call (rec.index, rec.time));
+      }
+
+      if (fmt == format_ctf)
+        write_ctf (out, rec);
+      else
+        write_text (out, rec, latency);
+
+      ++records;
+    }
+
+    int64_t
+    buffer_decoder::match (const buffer_record& rec)
+    {
+      /*
+       * Search the thread's calls from the most recent. Calls above the match
+       * did not record an exit so they are dropped.
+       */
+      thread_calls::iterator tci = threads.find (rec.thread);
+      if (tci != threads.end ())
+      {
+        calls& tcalls = (*tci).second;
+        for (size_t c = tcalls.size (); c > 0; --c)
+        {
+          if (tcalls[c - 1].first == rec.index)
+          {
+            uint64_t entry = tcalls[c - 1].second;
+            tcalls.resize (c - 1);
+            return rec.time > entry ? rec.time - entry : 0;
+          }
+        }
+      }
+      ++unmatched;
+      return -1;
+    }
+
+    uint32_t
+    buffer_decoder::get32 (const uint8_t* p) const
+    {
+      if (big_endian)
+        return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) |
+          ((uint32_t) p[2] << 8) | p[3];
+      return ((uint32_t) p[3] << 24) | ((uint32_t) p[2] << 16) |
+        ((uint32_t) p[1] << 8) | p[0];
+    }
+
+    uint64_t
+    buffer_decoder::get_value (const uint8_t* p, size_t size) const
+    {
+      uint64_t value = 0;
+      for (size_t b = 0; b < size; ++b)
+      {
+        if (big_endian)
+          value = (value << 8) | p[b];
+        else
+          value = (value << 8) | p[size - b - 1];
+      }
+      return value;
+    }
+
+    /*
+     * Output a value as hex if it is a size that fits in a register else the
+     * bytes in memory order.
+     */
+    static void
+    format_value (std::string&   line,
+                  const uint8_t* data,
+                  size_t         size,
+                  uint64_t       value,
+                  bool           is_value)
+    {
+      static const char* hex = "0123456789abcdef";
+      line += "0x";
+      if (is_value)
+      {
+        for (size_t n = size * 2; n > 0; --n)
+          line += hex[(value >> ((n - 1) * 4)) & 0xf];
+      }
+      else
+      {
+        for (size_t b = 0; b < size; ++b)
+        {
+          line += hex[data[b] >> 4];
+          line += hex[data[b] & 0xf];
+        }
+      }
+    }
+
+    static bool
+    is_register_size (size_t size)
+    {
+      return (size == 1) || (size == 2) || (size == 4) || (size == 8);
+    }
+
+    void
+    buffer_decoder::write_text (std::ostream&        out,
+                                const buffer_record& rec,
+                                int64_t              latency)
+    {
+      const buffer_function& func = functions[rec.index];
+      char                   header[64];
+
+      line.clear ();
+
+      if (cpus > 1)
+      {
+        ::snprintf (header, sizeof (header), "%3u ", rec.cpu);
+        line = header;
+      }
+
+      ::snprintf (header, sizeof (header), "%20llu %08x %c %c ",
+                  (unsigned long long) rec.time, rec.thread,
+                  rec.irq ? 'I' : ' ', rec.exit ? '<' : '>');
+
+      line += header;
+      line += func.name;
+
+      if (rec.exit)
+      {
+        if (rec.data_size != 0)
+        {
+          bool is_value = (rec.data_size == func.ret_size) &&
+            is_register_size (rec.data_size);
+          line += " = ";
+          format_value (line, rec.data, rec.data_size,
+                        is_value ? get_value (rec.data, rec.data_size) : 0,
+                        is_value);
+        }
+        if (latency >= 0)
+        {
+          line += " [";
+          line += rld::to_string (latency);
+          line += " ns]";
+        }
+      }
+      else
+      {
+        line += " (";
+        if (rec.data_size == func.entry_size)
+        {
+          const uint8_t* data = rec.data;
+          for (size_t a = 0; a < func.args.size (); ++a)
+          {
+            size_t size = func.args[a];
+            bool   is_value = is_register_size (size);
+            if (a != 0)
+              line += ", ";
+            format_value (line, data, size,
+                          is_value ? get_value (data, size) : 0,
+                          is_value);
+            data += size;
+          }
+        }
+        else if (rec.data_size != 0)
+        {
+          /*
+           * The record does not match the signature so show the bytes.
+           */
+          line += '?';
+          format_value (line, rec.data, rec.data_size, 0, false);
+        }
+        line += ')';
+      }
+
+      line += '\n';
+      out.write (line.data (), line.size ());
+    }
+
+    /*
+     * The CTF type of a value of the size.
+     */
+    static std::string
+    ctf_type (size_t size, const std::string& name)
+    {
+      std::stringstream sss;
+      if (is_register_size (size))
+        sss << "integer { size = " << size * 8
+            << "; align = 8; signed = false; base = 16; } " << name;
+      else
+        sss << "uint8_t " << name << '[' << size << ']';
+      return sss.str ();
+    }
+
+    void
+    buffer_decoder::write_ctf_metadata (const std::string& path)
+    {
+      std::ofstream out (path.c_str (), std::ios_base::out | std::ios_base::trunc);
+
+      if (!out.is_open ())
+        throw rld::error ("cannot open", "decode: " + path);
+
+      out << "/* CTF 1.8 */" << std::endl
+          << std::endl
+          << "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;" << std::endl
+          << "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;" << std::endl
+          << "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;" << std::endl
+          << std::endl
+          << "trace {" << std::endl
+          << "  major = 1;" << std::endl
+          << "  minor = 8;" << std::endl
+          << "  byte_order = " << (big_endian ? "be" : "le") << ';' << std::endl
+          << "  packet.header := struct {" << std::endl
+          << "    uint32_t magic;" << std::endl
+          << "    uint32_t stream_id;" << std::endl
+          << "  };" << std::endl
+          << "};" << std::endl
+          << std::endl
+          << "clock {" << std::endl
+          << "  name = uptime;" << std::endl
+          << "  freq = 1000000000;" << std::endl
+          << "};" << std::endl
+          << std::endl
+          << "typealias integer { size = 64; align = 8; signed = false;"
+          << " map = clock.uptime.value; } := uptime_t;" << std::endl
+          << std::endl
+          << "stream {" << std::endl
+          << "  id = 0;" << std::endl
+          << "  packet.context := struct {" << std::endl
+          << "    uint64_t content_size;" << std::endl
+          << "    uint64_t packet_size;" << std::endl
+          << "  };" << std::endl
+          << "  event.header := struct {" << std::endl
+          << "    uint32_t id;" << std::endl
+          << "    uptime_t timestamp;" << std::endl
+          << "  };" << std::endl
+          << "  event.context := struct {" << std::endl
+          << "    uint32_t cpu;" << std::endl
+          << "    uint32_t thread;" << std::endl
+          << "    uint32_t status;" << std::endl
+          << "    uint32_t state;" << std::endl
+          << "    uint8_t irq;" << std::endl
+          << "  };" << std::endl
+          << "};" << std::endl;
+
+      /*
+       * The entry event of function index N is 2N and the exit event 2N + 1.
+       */
+      for (size_t f = 0; f < functions.size (); ++f)
+      {
+        const buffer_function& func = functions[f];
+
+        out << std::endl
+            << "event {" << std::endl
+            << "  name = \"" << func.name << "_entry\";" << std::endl
+            << "  id = " << f * 2 << ';' << std::endl
+            << "  stream_id = 0;" << std::endl
+            << "  fields := struct {" << std::endl;
+        for (size_t a = 0; a < func.args.size (); ++a)
+          out << "    " << ctf_type (func.args[a], "a" + rld::to_string (a + 1))
+              << ';' << std::endl;
+        out << "  };" << std::endl
+            << "};" << std::endl
+            << std::endl
+            << "event {" << std::endl
+            << "  name = \"" << func.name << "_exit\";" << std::endl
+            << "  id = " << f * 2 + 1 << ';' << std::endl
+            << "  stream_id = 0;" << std::endl
+            << "  fields := struct {" << std::endl;
+        if (func.ret_size != 0)
+          out << "    " << ctf_type (func.ret_size, "ret") << ';' << std::endl;
+        out << "  };" << std::endl
+            << "};" << std::endl;
+      }
+
+      if (!out)
+        throw rld::error ("write failed", "decode: " + path);
+    }
+
+    void
+    buffer_decoder::write_ctf (std::ostream& out, const buffer_record& rec)
+    {
+      const buffer_function& func = functions[rec.index];
+      size_t                 expected = rec.exit ? func.ret_size : func.entry_size;
+
+      /*
+       * The events have a fixed layout so the data has to match the
+       * signature.
+       */
+      if (rec.data_size != expected)
+        throw rld::error ("record does not match the signature",
+                          "decode: " + func.name);
+
+      if (packet.empty ())
+        packet.resize (ctf_packet_header);
+
+      put (rec.index * 2 + (rec.exit ? 1 : 0), 4);
+      put (rec.time, 8);
+      put (rec.cpu, 4);
+      put (rec.thread, 4);
+      put (rec.status, 4);
+      put (rec.state, 4);
+      put (rec.irq ? 1 : 0, 1);
+      packet.insert (packet.end (), rec.data, rec.data + rec.data_size);
+
+      if (packet.size () >= ctf_packet_size)
+        flush_ctf (out);
+    }
+
+    void
+    buffer_decoder::flush_ctf (std::ostream& out)
+    {
+      if (packet.empty ())
+        return;
+
+      /*
+       * The header space at the start of the packet is filled in now the size
+       * of the events is known.
+       */
+      std::vector < uint8_t > events;
+      uint64_t                bits = (uint64_t) packet.size () * 8;
+
+      events.swap (packet);
+
+      put (ctf_magic, 4);
+      put (0, 4);
+      put (bits, 8);
+      put (bits, 8);
+
+      std::copy (packet.begin (), packet.end (), events.begin ());
+      out.write ((const char*) &events[0], events.size ());
+
+      packet.swap (events);
+      packet.clear ();
+    }
+
+    void
+    buffer_decoder::put (uint64_t value, size_t size)
+    {
+      for (size_t b = 0; b < size; ++b)
+      {
+        size_t shift = big_endian ? (size - b - 1) * 8 : b * 8;
+        packet.push_back ((uint8_t) (value >> shift));
+      }
+    }
+
+    void
+    buffer_decoder::output_latencies (std::ostream& out) const
+    {
+      out << "Latency: records: " << records
+          << " unmatched exits: " << unmatched << std::endl;
+      for (buffer_functions::const_iterator fi = functions.begin ();
+           fi != functions.end ();
+           ++fi)
+      {
+        const buffer_function& func = *fi;
+        if ((func.entries == 0) && (func.exits == 0))
+          continue;
+        out << " " << func.name << ": entries: " << func.entries
+            << " exits: " << func.exits
+            << " calls: " << func.latency.count << std::endl;
+        func.latency.output (out);
+      }
+    }
+
     linker::linker ()
     {
     }
@@ -1934,19 +2882,16 @@ namespace rld
 
       args.push_back ("-O2");
       args.push_back ("-g");
-      args.push_back ("-c");
-      args.push_back ("-o");
-      args.push_back (o.name ());
-      args.push_back (c.name ());
 
       rld::process::tempfile out;
       rld::process::tempfile err;
       rld::process::status   status;
 
-      status = rld::process::execute (rld::cc::get_cc (),
-                                      args,
-                                      out.name (),
-                                      err.name ());
+      status = rld::cc::compile_object (args,
+                                        c.name (),
+                                        o.name (),
+                                        out.name (),
+                                        err.name ());
 
       if ((status.type != rld::process::status::normal) ||
           (status.code != 0))
@@ -1994,6 +2939,29 @@ namespace rld
       err.output (rld::cc::get_ld (), std::cout);
     }
 
+    void
+    linker::decode (const std::string& dump,
+                    const std::string& format,
+                    const std::string& output,
+                    bool               big_endian,
+                    size_t             cpus)
+    {
+      buffer_decoder::format fmt = buffer_decoder::get_format (format);
+
+      tracer_.generate_sizeof ();
+
+      buffer_decoder decoder (tracer_, big_endian, cpus);
+
+      decoder.decode (dump, fmt, output);
+
+      /*
+       * Keep the latencies out of the records if they are on stdout.
+       */
+      if ((fmt == buffer_decoder::format_text) && output.empty ())
+        std::cout << std::endl;
+      decoder.output_latencies (std::cout);
+    }
+
     void
     linker::dump (std::ostream& out) const
     {
@@ -2030,6 +2998,12 @@ static struct option rld_opts[] = {
   { "config",      required_argument,      NULL,           'C' },
   { "path",        required_argument,      NULL,           'P' },
   { "wrapper",     required_argument,      NULL,           'W' },
+  { "decode",      required_argument,      NULL,           'D' },
+  { "format",      required_argument,      NULL,           'F' },
+  { "output",      required_argument,      NULL,           'o' },
+  { "big-endian",  no_argument,            NULL,           'b' },
+  { "cpus",        required_argument,      NULL,           'n' },
+  { "cache",       required_argument,      NULL,           'A' },
   { NULL,          0,                      NULL,            0 }
 };
 
@@ -2037,6 +3011,7 @@ void
 usage (int exit_code)
 {
   std::cout << "rtems-trace-ld [options] objects" << std::endl
+            << "rtems-trace-ld [options] -D dump" << std::endl
             << "Options and arguments:" << std::endl
             << " -h          : help (also --help)" << std::endl
             << " -V          : print linker version number and exit (also --version)" << std::endl
@@ -2051,8 +3026,14 @@ usage (int exit_code)
             << " -r path     : RTEMS path (also --rtems)" << std::endl
             << " -B bsp      : RTEMS arch/bsp (also --rtems-bsp)" << std::endl
             << " -W wrapper  : wrapper file name without ext (also --wrapper)" << std::endl
+            << " -A path     : cache compiled objects and type sizes in path (also --cache)" << std::endl
             << " -C ini      : user configuration INI file (also --config)" << std::endl
-            << " -P path     : user configuration file search path (also --path)" << std::endl;
+            << " -P path     : user configuration file search path (also --path)" << std::endl
+            << " -D dump     : decode a trace buffer dump (also --decode)" << std::endl
+            << " -F format   : decode output format, text or ctf (also --format)" << std::endl
+            << " -o output   : decode output file or CTF directory (also --output)" << std::endl
+            << " -b          : the trace buffer is big endian (also --big-endian)" << std::endl
+            << " -n cpus     : the number of CPU buffers in the dump (also --cpus)" << std::endl;
   ::exit (exit_code);
 }
 
@@ -2109,12 +3090,17 @@ main (int argc, char* argv[])
     std::string        wrapper;
     std::string        rtems_path;
     std::string        rtems_arch_bsp;
+    std::string        decode;
+    std::string        format = "text";
+    std::string        output;
+    bool               big_endian = false;
+    size_t             cpus = 1;
 
     rld::set_cmdline (argc, argv);
 
     while (true)
     {
-      int opt = ::getopt_long (argc, argv, "hvwkVc:l:E:f:C:P:r:B:W:", rld_opts, NULL);
+      int opt = ::getopt_long (argc, argv, "hvwkVc:l:E:f:C:P:r:B:W:D:F:o:bn:A:", rld_opts, NULL);
       if (opt < 0)
         break;
 
@@ -2179,6 +3165,33 @@ main (int argc, char* argv[])
           wrapper = optarg;
           break;
 
+        case 'A':
+          rld::cc::set_object_cache (optarg);
+          rld::size_of::set_database (optarg);
+          break;
+
+        case 'D':
+          decode = optarg;
+          break;
+
+        case 'F':
+          format = optarg;
+          break;
+
+        case 'o':
+          output = optarg;
+          break;
+
+        case 'b':
+          big_endian = true;
+          break;
+
+        case 'n':
+          cpus = ::strtoul (optarg, 0, 0);
+          if (cpus == 0)
+            throw rld::error ("invalid number of CPUs", "options: " + std::string (optarg));
+          break;
+
         case '?':
           usage (3);
           break;
@@ -2226,6 +3239,16 @@ main (int argc, char* argv[])
     if (!ld.empty ())
       rld::cc::set_ld (ld);
 
+    /*
+     * Decode a trace buffer dump rather than link.
+     */
+    if (!decode.empty ())
+    {
+      linker.load_config (configuration, trace, path);
+      linker.decode (decode, format, output, big_endian, cpus);
+      return 0;
+    }
+
     /*
      * Load the remaining command line arguments into the linker command line.
      */
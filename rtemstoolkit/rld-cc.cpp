@@ -14,9 +14,12 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
+#include <stdio.h>
 #include <string.h>
+#include <sys/stat.h>
 
 #include <fstream>
+#include <sstream>
 
 #include <rld.h>
 #include <rld-cc.h>
@@ -51,6 +54,8 @@ namespace rld
     static std::string programs_path;   //< The CC reported programs path.
     static std::string libraries_path;  //< The CC reported libraries path.
 
+    static std::string object_cache;    //< The object cache path.
+
     /**
      * The list of standard libraries.
      */
@@ -607,5 +612,206 @@ namespace rld
         libs.push_back (path);
       }
     }
+
+    void
+    set_object_cache (const std::string& path)
+    {
+      object_cache = path;
+    }
+
+    const std::string
+    get_object_cache ()
+    {
+      return object_cache;
+    }
+
+    /*
+     * Read a file into a string.
+     */
+    static bool
+    read_file (const std::string& path, std::string& contents)
+    {
+      std::ifstream in (path.c_str (), std::ios_base::in | std::ios_base::binary);
+      if (!in.is_open ())
+        return false;
+      std::stringstream ss;
+      ss << in.rdbuf ();
+      if (in.bad ())
+        return false;
+      contents = ss.str ();
+      return true;
+    }
+
+    /*
+     * Write a string to a file.
+     */
+    static bool
+    write_file (const std::string& path, const std::string& contents)
+    {
+      std::ofstream out (path.c_str (),
+                         std::ios_base::out |
+                         std::ios_base::binary |
+                         std::ios_base::trunc);
+      if (!out.is_open ())
+        return false;
+      out.write (contents.data (), contents.size ());
+      out.close ();
+      return !out.fail ();
+    }
+
+    /*
+     * The compiler's path, size and modification time are part of the key so
+     * a different compiler installed at the same path is seen.
+     */
+    static std::string
+    compiler_key (const std::string& command)
+    {
+      std::string path = command;
+      if (command.find_first_of ("/\\") == std::string::npos)
+      {
+        rld::path::paths sp;
+        rld::path::get_system_path (sp);
+        rld::path::find_file (path, command, sp);
+      }
+      struct stat sb;
+      if (path.empty () || (::stat (path.c_str (), &sb) < 0))
+        return command;
+      return path + ' ' + rld::to_string (sb.st_size) +
+        ' ' + rld::to_string (sb.st_mtime);
+    }
+
+    const std::string
+    command_key (const rld::process::arg_container& args)
+    {
+      std::string key;
+      if (!args.empty ())
+      {
+        key = compiler_key (args[0]) + '\n';
+        for (size_t a = 1; a < args.size (); ++a)
+          key += args[a] + '\n';
+      }
+      return key;
+    }
+
+    bool
+    preprocess (const rld::process::arg_container& args,
+                const std::string&                 source,
+                std::string&                       output)
+    {
+      rld::process::arg_container pargs (args);
+      rld::process::tempfile      out;
+      rld::process::tempfile      err;
+      rld::process::status        status;
+
+      if (args.empty ())
+        return false;
+
+      pargs.push_back ("-E");
+      pargs.push_back (source);
+
+      status = rld::process::execute (args[0], pargs, out.name (), err.name ());
+
+      if ((status.type != rld::process::status::normal) ||
+          (status.code != 0) ||
+          !read_file (out.name (), output))
+        return false;
+
+      /*
+       * The source is often a temporary file so its name in the line markers
+       * is replaced or the output would never be the same.
+       */
+      const std::string      quoted = '"' + source + '"';
+      const std::string      marker = "\"<source>\"";
+      std::string::size_type pos = 0;
+      while ((pos = output.find (quoted, pos)) != std::string::npos)
+      {
+        output.replace (pos, quoted.size (), marker);
+        pos += marker.size ();
+      }
+
+      return true;
+    }
+
+    rld::process::status
+    compile_object (const rld::process::arg_container& args,
+                    const std::string&                 source,
+                    const std::string&                 object,
+                    const std::string&                 outname,
+                    const std::string&                 errname)
+    {
+      rld::process::arg_container cargs (args);
+      rld::process::status        status;
+      std::string                 key;
+      std::string                 key_path;
+      std::string                 object_path;
+
+      if (args.empty ())
+        throw rld::error ("No compiler command", "compile object");
+
+      cargs.push_back ("-c");
+      cargs.push_back ("-o");
+      cargs.push_back (object);
+      cargs.push_back (source);
+
+      if (!object_cache.empty ())
+      {
+        std::string src;
+        if (preprocess (args, source, src))
+        {
+          key = "rld-cc object cache 2\n" + command_key (args) + "--\n" + src;
+
+          char name[32];
+          ::snprintf (name, sizeof (name), "%016llx",
+                      (unsigned long long) rld::hash_bytes (key));
+
+          rld::path::path_join (object_cache, std::string (name) + ".key", key_path);
+          rld::path::path_join (object_cache, std::string (name) + ".o", object_path);
+
+          /*
+           * The whole key is held in the entry and checked so a hash
+           * collision is a miss.
+           */
+          std::string entry_key;
+          std::string entry_object;
+          if (read_file (key_path, entry_key) && (entry_key == key) &&
+              read_file (object_path, entry_object) &&
+              write_file (object, entry_object))
+          {
+            if (rld::verbose () >= RLD_VERBOSE_INFO)
+              std::cout << "cc: object cache hit: " << name
+                        << ": " << object << std::endl;
+            status.type = rld::process::status::normal;
+            status.code = 0;
+            return status;
+          }
+        }
+      }
+
+      status = rld::process::execute (args[0], cargs, outname, errname);
+
+      if (!key.empty () &&
+          (status.type == rld::process::status::normal) &&
+          (status.code == 0))
+      {
+        std::string contents;
+        bool        saved = false;
+
+        rld::path::make_directory (object_cache);
+
+        /*
+         * The object is renamed into the cache before the key so a key is
+         * never seen without its object.
+         */
+        if (read_file (object, contents) &&
+            rld::write_file_atomically (object_path, contents))
+          saved = rld::write_file_atomically (key_path, key);
+
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cc: object cache " << (saved ? "saved" : "not saved")
+                    << ": " << object_path << std::endl;
+      }
+
+      return status;
+    }
   }
 }
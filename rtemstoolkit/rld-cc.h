@@ -209,6 +209,63 @@ namespace rld
                             rld::path::paths& libpaths,
                             bool              cpp = false);
 
+    /**
+     * Set the path of the object cache. An empty path disables the cache.
+     */
+    void set_object_cache (const std::string& path);
+
+    /**
+     * Get the path of the object cache.
+     */
+    const std::string get_object_cache ();
+
+    /**
+     * Return a key for a compiler command and flags. The key is the
+     * compiler's path, size and modification time and the flags so it changes
+     * if the compiler or the flags change.
+     */
+    const std::string command_key (const rld::process::arg_container& args);
+
+    /**
+     * Preprocess a source file with the compiler command and flags and return
+     * the output. The source's name in the line markers is replaced so the
+     * output does not depend on it. The output holds the contents of every
+     * header the source includes so it changes if a header changes.
+     *
+     * @param args The compiler command and flags.
+     * @param source The source file to preprocess.
+     * @param output The preprocessed source.
+     * @retval true The source was preprocessed.
+     * @retval false The compiler failed or the output could not be read.
+     */
+    bool preprocess (const rld::process::arg_container& args,
+                     const std::string&                 source,
+                     std::string&                       output);
+
+    /**
+     * Compile a source file to an object file. The arguments are the compiler
+     * command and the flags. The compile and output options, the object and
+     * the source are appended.
+     *
+     * If the object cache is set the object is keyed by the arguments, the
+     * compiler's size and modification time and the preprocessed source. The
+     * source is preprocessed on each call so a change to a header it includes
+     * is seen. The object of an earlier compile with the same key is copied to
+     * the object file and the compiler is not run.
+     *
+     * @param args The compiler command and flags.
+     * @param source The source file to compile.
+     * @param object The object file to create.
+     * @param outname The file to capture the compiler's stdout.
+     * @param errname The file to capture the compiler's stderr.
+     * @return rld::process::status The status of the compile.
+     */
+    rld::process::status compile_object (const rld::process::arg_container& args,
+                                         const std::string&                 source,
+                                         const std::string&                 object,
+                                         const std::string&                 outname,
+                                         const std::string&                 errname);
+
   }
 }
 
@@ -26,8 +26,12 @@
 #include "config.h"
 #endif
 
+#include <condition_variable>
+#include <deque>
 #include <fstream>
 #include <iostream>
+#include <mutex>
+#include <thread>
 
 #include <errno.h>
 #include <string.h>
@@ -41,34 +45,625 @@ namespace rld
 {
   namespace compress
   {
+    codec::~codec ()
+    {
+    }
+
+    /*
+     * Read and write the big endian values in the block headers.
+     */
+    static void
+    put_be (uint8_t* data, size_t value, int bytes)
+    {
+      while (bytes--)
+      {
+        data[bytes] = (uint8_t) value;
+        value >>= 8;
+      }
+    }
+
+    static size_t
+    get_be (const uint8_t* data, int bytes)
+    {
+      size_t value = 0;
+      for (int b = 0; b < bytes; ++b)
+        value = (value << 8) | data[b];
+      return value;
+    }
+
+    /**
+     * FastLZ. The block header is the 16bit size of the compressed block. The
+     * RTEMS loader reads this format. Level 2 blocks are denser and the level
+     * is held in the block so level 1 and level 2 blocks have the same label.
+     * The RTEMS loader decompresses into a fixed 2K buffer so that is the
+     * default block size of both levels. Larger blocks need a loader with
+     * larger buffers and are selected with the block size option.
+     */
+    class codec_fastlz:
+      public codec
+    {
+    public:
+      codec_fastlz (const char* codec_name, int codec_level)
+        : name_ (codec_name),
+          level (codec_level) {
+      }
+
+      const char* name () const {
+        return name_;
+      }
+
+      const char* label () const {
+        return "LZ77";
+      }
+
+      size_t default_block_size () const {
+        return 2 * 1024;
+      }
+
+      /*
+       * The compressed block has to fit the 16bit header and FastLZ can
+       * expand data by 1 byte in 32.
+       */
+      size_t max_block_size () const {
+        return 60 * 1024;
+      }
+
+      size_t bound (size_t size) const {
+        return size + (size / 10) + 66;
+      }
+
+      size_t header_size () const {
+        return 2;
+      }
+
+      void put_header (uint8_t* header, size_t compressed, size_t ) const {
+        put_be (header, compressed, 2);
+      }
+
+      void get_header (const uint8_t* header,
+                       size_t&        compressed,
+                       size_t&        size) const {
+        compressed = get_be (header, 2);
+        size = 0;
+      }
+
+      size_t compress (const uint8_t* in, size_t size, uint8_t* out) const {
+        return ::fastlz_compress_level (level, in, size, out);
+      }
+
+      size_t decompress (const uint8_t* in,
+                         size_t         size,
+                         uint8_t*       out,
+                         size_t         out_size) const {
+        return ::fastlz_decompress (in, size, out, out_size);
+      }
+
+    private:
+      const char* name_;
+      int         level;
+    };
+
+    /**
+     * LZ4 block format. Decompressing is a simple copy loop which suits slow
+     * targets. The block header is the 32bit size of the compressed block and
+     * the 32bit size of the block so larger blocks can be used.
+     */
+    class codec_lz4:
+      public codec
+    {
+    public:
+      const char* name () const {
+        return "lz4";
+      }
+
+      const char* label () const {
+        return "LZ4B";
+      }
+
+      size_t default_block_size () const {
+        return 32 * 1024;
+      }
+
+      size_t max_block_size () const {
+        return 4 * 1024 * 1024;
+      }
+
+      size_t bound (size_t size) const {
+        return size + (size / 255) + 16;
+      }
+
+      size_t header_size () const {
+        return 8;
+      }
+
+      void put_header (uint8_t* header, size_t compressed, size_t size) const {
+        put_be (header, compressed, 4);
+        put_be (header + 4, size, 4);
+      }
+
+      void get_header (const uint8_t* header,
+                       size_t&        compressed,
+                       size_t&        size) const {
+        compressed = get_be (header, 4);
+        size = get_be (header + 4, 4);
+      }
+
+      size_t compress (const uint8_t* in, size_t size, uint8_t* out) const;
+
+      size_t decompress (const uint8_t* in,
+                         size_t         size,
+                         uint8_t*       out,
+                         size_t         out_size) const;
+
+    private:
+      /*
+       * A match is at least 4 bytes, the last 5 bytes are always literals and
+       * the last match starts 12 bytes before the end of the block.
+       */
+      static const size_t min_match = 4;
+      static const size_t last_literals = 5;
+      static const size_t match_limit = 12;
+      static const size_t max_distance = 65535;
+      static const int    hash_bits = 14;
+
+      static uint32_t read32 (const uint8_t* p) {
+        uint32_t v;
+        ::memcpy (&v, p, sizeof (v));
+        return v;
+      }
+
+      static uint32_t hash (uint32_t v) {
+        return (v * 2654435761U) >> (32 - hash_bits);
+      }
+
+      static uint8_t* put_length (uint8_t* op, size_t length) {
+        while (length >= 255)
+        {
+          *op++ = 255;
+          length -= 255;
+        }
+        *op++ = (uint8_t) length;
+        return op;
+      }
+
+      /*
+       * A sequence is a token, the literals and the match's offset. The
+       * token holds the literals and match sizes with the larger sizes
+       * following the token and the offset.
+       */
+      static uint8_t* put_sequence (uint8_t*       op,
+                                    const uint8_t* literals,
+                                    size_t         literals_size,
+                                    size_t         match_size,
+                                    size_t         offset) {
+        uint8_t* token = op++;
+        *token = (literals_size < 15 ? literals_size : 15) << 4;
+        if (literals_size >= 15)
+          op = put_length (op, literals_size - 15);
+        ::memcpy (op, literals, literals_size);
+        op += literals_size;
+        if (match_size)
+        {
+          match_size -= min_match;
+          *token |= match_size < 15 ? match_size : 15;
+          *op++ = (uint8_t) offset;
+          *op++ = (uint8_t) (offset >> 8);
+          if (match_size >= 15)
+            op = put_length (op, match_size - 15);
+        }
+        return op;
+      }
+    };
+
+    size_t
+    codec_lz4::compress (const uint8_t* in, size_t size, uint8_t* out) const
+    {
+      const uint8_t* ip = in;
+      const uint8_t* anchor = in;
+      const uint8_t* end = in + size;
+      uint8_t*       op = out;
+
+      if (size > match_limit)
+      {
+        /*
+         * The table holds the position plus 1 of the last 4 bytes with a hash
+         * so 0 is empty.
+         */
+        std::vector < uint32_t > table (1 << hash_bits, 0);
+        const uint8_t*           limit = end - match_limit;
+        const uint8_t*           last = end - last_literals;
+
+        while (ip < limit)
+        {
+          uint32_t seq = read32 (ip);
+          uint32_t h = hash (seq);
+          size_t   candidate = table[h];
+
+          table[h] = (ip - in) + 1;
+
+          if ((candidate == 0) ||
+              (((ip - in) - (candidate - 1)) > max_distance) ||
+              (read32 (in + candidate - 1) != seq))
+          {
+            ++ip;
+            continue;
+          }
+
+          const uint8_t* ref = in + candidate - 1;
+
+          while ((ip > anchor) && (ref > in) && (ip[-1] == ref[-1]))
+          {
+            --ip;
+            --ref;
+          }
+
+          const uint8_t* mp = ip + min_match;
+          const uint8_t* rp = ref + min_match;
+
+          while ((mp < last) && (*mp == *rp))
+          {
+            ++mp;
+            ++rp;
+          }
+
+          op = put_sequence (op, anchor, ip - anchor, mp - ip, ip - ref);
+
+          ip = anchor = mp;
+        }
+      }
+
+      op = put_sequence (op, anchor, end - anchor, 0, 0);
+
+      return op - out;
+    }
+
+    size_t
+    codec_lz4::decompress (const uint8_t* in,
+                           size_t         size,
+                           uint8_t*       out,
+                           size_t         out_size) const
+    {
+      const uint8_t* ip = in;
+      const uint8_t* iend = in + size;
+      uint8_t*       op = out;
+      uint8_t*       oend = out + out_size;
+
+      while (ip < iend)
+      {
+        unsigned int token = *ip++;
+        size_t       length = token >> 4;
+        uint8_t      b;
+
+        if (length == 15)
+        {
+          do
+          {
+            if (ip >= iend)
+              return 0;
+            b = *ip++;
+            length += b;
+          } while (b == 255);
+        }
+
+        if ((length > (size_t) (iend - ip)) || (length > (size_t) (oend - op)))
+          return 0;
+
+        ::memcpy (op, ip, length);
+        op += length;
+        ip += length;
+
+        /*
+         * The last sequence has no match.
+         */
+        if (ip == iend)
+          break;
+
+        if ((iend - ip) < 2)
+          return 0;
+
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+
+        if ((offset == 0) || (offset > (size_t) (op - out)))
+          return 0;
+
+        length = token & 15;
+
+        if (length == 15)
+        {
+          do
+          {
+            if (ip >= iend)
+              return 0;
+            b = *ip++;
+            length += b;
+          } while (b == 255);
+        }
+
+        length += min_match;
+
+        if (length > (size_t) (oend - op))
+          return 0;
+
+        const uint8_t* ref = op - offset;
+        while (length--)
+          *op++ = *ref++;
+      }
+
+      return op - out;
+    }
+
+    static const codec_fastlz fastlz_1 ("lz77", 1);
+    static const codec_fastlz fastlz_2 ("lz77-2", 2);
+    static const codec_lz4    lz4;
+
+    void
+    get_codecs (codecs& codecs_)
+    {
+      codecs_.push_back (&fastlz_1);
+      codecs_.push_back (&fastlz_2);
+      codecs_.push_back (&lz4);
+    }
+
+    const codec&
+    get_codec (const std::string& name)
+    {
+      codecs codecs_;
+      get_codecs (codecs_);
+      for (codecs::iterator ci = codecs_.begin (); ci != codecs_.end (); ++ci)
+        if (name == (*ci)->name ())
+          return *(*ci);
+      throw rld::error ("Unknown codec: " + name, "compression");
+    }
+
+    const codec&
+    get_codec_by_label (const std::string& label)
+    {
+      codecs codecs_;
+      get_codecs (codecs_);
+      for (codecs::iterator ci = codecs_.begin (); ci != codecs_.end (); ++ci)
+        if (label == (*ci)->label ())
+          return *(*ci);
+      throw rld::error ("Unknown codec label: " + label, "compression");
+    }
+
+    /**
+     * A block in the pipeline.
+     */
+    struct pipeline_block
+    {
+      uint8_t* data;       //< The block.
+      size_t   size;       //< The size of the data buffer.
+      size_t   level;      //< The amount of data in the block.
+      uint8_t* io;         //< The compressed block.
+      size_t   compressed; //< The size of the compressed block.
+      bool     done;       //< The block has been compressed.
+
+      pipeline_block ()
+        : data (0),
+          size (0),
+          level (0),
+          io (0),
+          compressed (0),
+          done (false) {
+      }
+
+      ~pipeline_block () {
+        delete [] data;
+        delete [] io;
+      }
+    };
+
+    /**
+     * The pipeline queues the filled blocks in the order they are filled. The
+     * threads compress the next queued block and the blocks at the head of the
+     * queue are written once they are compressed. The number of blocks in the
+     * pipeline is limited so the writer waits if the threads fall behind.
+     */
+    class pipeline
+    {
+    public:
+      pipeline (const codec& coder, int jobs)
+        : coder (coder),
+          limit (jobs * 2),
+          stopping (false)
+      {
+        for (int j = 0; j < jobs; ++j)
+          threads.push_back (std::thread (worker, this));
+      }
+
+      ~pipeline ()
+      {
+        {
+          std::lock_guard < std::mutex > guard (lock);
+          stopping = true;
+        }
+        work_ready.notify_all ();
+        for (std::vector < std::thread >::iterator ti = threads.begin ();
+             ti != threads.end ();
+             ++ti)
+          (*ti).join ();
+        while (!blocks.empty ())
+        {
+          delete blocks.front ();
+          blocks.pop_front ();
+        }
+        while (!free_blocks.empty ())
+        {
+          delete free_blocks.front ();
+          free_blocks.pop_front ();
+        }
+      }
+
+      /**
+       * Queue a block. The block's buffer is exchanged for an empty buffer of
+       * the same size.
+       */
+      void queue (uint8_t*& buffer, size_t size, size_t level)
+      {
+        pipeline_block* block;
+        {
+          std::lock_guard < std::mutex > guard (lock);
+          if (free_blocks.empty ())
+            block = 0;
+          else
+          {
+            block = free_blocks.front ();
+            free_blocks.pop_front ();
+          }
+        }
+        if (!block)
+          block = new pipeline_block;
+        if (block->size != size)
+        {
+          delete [] block->data;
+          delete [] block->io;
+          block->data = 0;
+          block->io = 0;
+          block->data = new uint8_t[size];
+          block->io = new uint8_t[coder.bound (size)];
+          block->size = size;
+        }
+        std::swap (block->data, buffer);
+        block->level = level;
+        block->done = false;
+        {
+          std::lock_guard < std::mutex > guard (lock);
+          blocks.push_back (block);
+          work.push_back (block);
+        }
+        work_ready.notify_one ();
+      }
+
+      /**
+       * Get the next compressed block in order. If all is false a block is
+       * only returned without waiting or if the pipeline is full.
+       */
+      pipeline_block* next (bool all)
+      {
+        std::unique_lock < std::mutex > guard (lock);
+        while (!blocks.empty ())
+        {
+          pipeline_block* block = blocks.front ();
+          if (block->done)
+          {
+            blocks.pop_front ();
+            return block;
+          }
+          if (!all && (blocks.size () < limit))
+            break;
+          block_done.wait (guard);
+        }
+        return 0;
+      }
+
+      /**
+       * Return a written block for reuse.
+       */
+      void release (pipeline_block* block)
+      {
+        std::lock_guard < std::mutex > guard (lock);
+        free_blocks.push_back (block);
+      }
+
+    private:
+      static void worker (pipeline* pipe)
+      {
+        pipe->compress ();
+      }
+
+      void compress ()
+      {
+        std::unique_lock < std::mutex > guard (lock);
+        while (true)
+        {
+          while (!stopping && work.empty ())
+            work_ready.wait (guard);
+          if (work.empty ())
+            break;
+          pipeline_block* block = work.front ();
+          work.pop_front ();
+          guard.unlock ();
+          block->compressed = coder.compress (block->data,
+                                              block->level,
+                                              block->io);
+          guard.lock ();
+          block->done = true;
+          block_done.notify_all ();
+        }
+      }
+
+      typedef std::deque < pipeline_block* > block_queue;
+
+      const codec&                coder;
+      const size_t                limit;
+      bool                        stopping;
+      block_queue                 blocks;
+      block_queue                 work;
+      block_queue                 free_blocks;
+      std::mutex                  lock;
+      std::condition_variable     work_ready;
+      std::condition_variable     block_done;
+      std::vector < std::thread > threads;
+    };
+
     compressor::compressor (files::image& image,
                             size_t        size,
                             bool          out,
-                            bool          compress)
+                            bool          compress,
+                            const codec*  coder)
       : image (image),
-        size (size),
+        coder (coder ? *coder : fastlz_1),
+        size (0),
         out (out),
         compress (compress),
         buffer (0),
         io (0),
+        io_size (0),
         level (0),
+        position (0),
         total (0),
-        total_compressed (0)
+        total_compressed (0),
+        workers (0)
     {
-      if (size > 0xffff)
-        throw rld::error ("Size too big, 16 bits only", "compression");
+      if (compress && (size > this->coder.max_block_size ()))
+        throw rld::error ("Size too big, " +
+                          rld::to_string (this->coder.max_block_size ()) +
+                          " bytes only", "compression");
 
-      buffer = new uint8_t[size];
-      io = new uint8_t[size + (size / 10)];
+      reserve (size, this->coder.bound (size));
     }
 
     compressor::~compressor ()
     {
       flush ();
+      delete workers;
       delete [] buffer;
       delete [] io;
     }
 
+    void
+    compressor::reserve (size_t block_size, size_t io_size_)
+    {
+      if (block_size > size)
+      {
+        uint8_t* block = new uint8_t[block_size];
+        if (level > position)
+          ::memcpy (block, buffer + position, level - position);
+        level -= position;
+        position = 0;
+        delete [] buffer;
+        buffer = block;
+        size = block_size;
+      }
+      if (io_size_ > io_size)
+      {
+        delete [] io;
+        io = new uint8_t[io_size_];
+        io_size = io_size_;
+      }
+    }
+
     void
     compressor::write (const void* data_, size_t length)
     {
@@ -138,21 +733,20 @@ namespace rld
       {
         input ();
 
-        if (level == 0)
+        if (level == position)
           break;
 
         size_t appending;
 
-        if (length > level)
-          appending = level;
+        if (length > (level - position))
+          appending = level - position;
         else
           appending = length;
 
-        ::memcpy (data, buffer, appending);
-        ::memmove (buffer, buffer + appending, level - appending);
+        ::memcpy (data, buffer + position, appending);
 
         data += appending;
-        level -= appending;
+        position += appending;
         length -= appending;
         total += appending;
         amount += appending;
@@ -184,21 +778,19 @@ namespace rld
       {
         input ();
 
-        if (level == 0)
+        if (level == position)
           break;
 
         size_t appending;
 
-        if (length > level)
-          appending = level;
+        if (length > (level - position))
+          appending = level - position;
         else
           appending = length;
 
-        output_.write (buffer, appending);
-
-        ::memmove (buffer, buffer + appending, level - appending);
+        output_.write (buffer + position, appending);
 
-        level -= appending;
+        position += appending;
         length -= appending;
         total += appending;
         amount += appending;
@@ -211,6 +803,26 @@ namespace rld
     compressor::flush ()
     {
       output (true);
+      if (workers)
+      {
+        pipeline_block* block;
+        while ((block = workers->next (true)) != 0)
+        {
+          output_block (block->io, block->compressed, block->level);
+          workers->release (block);
+        }
+      }
+    }
+
+    void
+    compressor::set_jobs (int jobs)
+    {
+      if (total != 0)
+        throw rld::error ("Jobs set after writing", "compression");
+      delete workers;
+      workers = 0;
+      if (out && compress && (jobs > 1))
+        workers = new pipeline (coder, jobs);
     }
 
     size_t
@@ -236,65 +848,104 @@ namespace rld
     {
       if (out && ((forced && level) || (level >= size)))
       {
-        if (compress)
+        if (compress && workers)
         {
-          int     writing = ::fastlz_compress (buffer, level, io);
-          uint8_t header[2];
-
-          if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
-            std::cout << "rtl: comp: offset=" << total_compressed
-                      << " block-size=" << writing << std::endl;
-
-          header[0] = writing >> 8;
-          header[1] = writing;
-
-          image.write (header, 2);
-          image.write (io, writing);
-
-          total_compressed += 2 + writing;
+          workers->queue (buffer, size, level);
+          pipeline_block* block;
+          while ((block = workers->next (false)) != 0)
+          {
+            output_block (block->io, block->compressed, block->level);
+            workers->release (block);
+          }
+        }
+        else if (compress)
+        {
+          output_block (io, coder.compress (buffer, level, io), level);
         }
         else
         {
           image.write (buffer, level);
+          total_compressed += level;
         }
 
         level = 0;
       }
     }
 
+    void
+    compressor::output_block (const uint8_t* data,
+                              size_t         compressed,
+                              size_t         length)
+    {
+      uint8_t header[16];
+
+      if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
+        std::cout << "rtl: comp: offset=" << total_compressed
+                  << " block-size=" << compressed << std::endl;
+
+      coder.put_header (header, compressed, length);
+
+      image.write (header, coder.header_size ());
+      image.write (data, compressed);
+
+      total_compressed += coder.header_size () + compressed;
+    }
+
     void
     compressor::input ()
     {
-      if (!out && (level == 0))
+      if (!out && (level == position))
       {
+        level = 0;
+        position = 0;
+
         if (compress)
         {
-          uint8_t header[2];
+          uint8_t header[16];
+          size_t  header_size = coder.header_size ();
 
-          if (image.read (header, 2) == 2)
+          if (image.read (header, header_size) == (ssize_t) header_size)
           {
-            uint32_t block_size =
-              (((uint32_t) header[0]) << 8) | (uint32_t) header[1];
+            size_t block_size;
+            size_t block;
+
+            coder.get_header (header, block_size, block);
 
             if (block_size == 0)
               throw rld::error ("Block size is invalid (0)", "compression");
 
-            total_compressed += 2 + block_size;
+            if (block == 0)
+              block = coder.max_block_size ();
+
+            if ((block > coder.max_block_size ()) ||
+                (block_size > coder.bound (block)))
+              throw rld::error ("Block size is invalid", "compression");
+
+            reserve (block, block_size);
+
+            total_compressed += header_size + block_size;
 
             if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
               std::cout << "rtl: decomp: block-size=" << block_size
                         << std::endl;
 
-            if (image.read (io, block_size) != block_size)
+            if (image.read (io, block_size) != (ssize_t) block_size)
               throw rld::error ("Read past end", "compression");
 
-            level = ::fastlz_decompress (io, block_size, buffer, size);
+            level = coder.decompress (io, block_size, buffer, block);
+
+            if (level == 0)
+              throw rld::error ("Block is invalid", "compression");
           }
         }
         else
         {
-          image.read (buffer, size);
-          level = size;
+          ssize_t r = image.read (buffer, size);
+          if (r > 0)
+          {
+            level = r;
+            total_compressed += r;
+          }
         }
       }
     }
@@ -25,12 +25,142 @@
 #if !defined (_RLD_COMPRESSION_H_)
 #define _RLD_COMPRESSION_H_
 
+#include <vector>
+
 #include <rld-files.h>
 
 namespace rld
 {
   namespace compress
   {
+    /**
+     * A codec compresses and decompresses the blocks of a compressed stream.
+     * Each block is written with a header the codec defines. The codec's 4
+     * character label is held in the header of a RAP file.
+     */
+    class codec
+    {
+    public:
+      virtual ~codec ();
+
+      /**
+       * The name used to select the codec.
+       */
+      virtual const char* name () const = 0;
+
+      /**
+       * The label of the codec in a RAP file header.
+       */
+      virtual const char* label () const = 0;
+
+      /**
+       * The block size used if none is given.
+       */
+      virtual size_t default_block_size () const = 0;
+
+      /**
+       * The largest block size the block header can describe.
+       */
+      virtual size_t max_block_size () const = 0;
+
+      /**
+       * The largest a block can be once compressed.
+       *
+       * @param size The size of the block.
+       */
+      virtual size_t bound (size_t size) const = 0;
+
+      /**
+       * The size of the block header.
+       */
+      virtual size_t header_size () const = 0;
+
+      /**
+       * Fill in a block header.
+       *
+       * @param header The header to fill in.
+       * @param compressed The size of the compressed block.
+       * @param size The size of the block.
+       */
+      virtual void put_header (uint8_t* header,
+                               size_t   compressed,
+                               size_t   size) const = 0;
+
+      /**
+       * Get the compressed size and the size from a block header. The size is
+       * 0 if the header does not hold it and the block can be up to the
+       * largest block size.
+       *
+       * @param header The header to read.
+       * @param compressed The size of the compressed block.
+       * @param size The size of the block.
+       */
+      virtual void get_header (const uint8_t* header,
+                               size_t&        compressed,
+                               size_t&        size) const = 0;
+
+      /**
+       * Compress a block.
+       *
+       * @param in The block to compress.
+       * @param size The size of the block.
+       * @param out The compressed block, at least bound (size) in size.
+       * @return size_t The size of the compressed block.
+       */
+      virtual size_t compress (const uint8_t* in,
+                               size_t         size,
+                               uint8_t*       out) const = 0;
+
+      /**
+       * Decompress a block.
+       *
+       * @param in The compressed block.
+       * @param size The size of the compressed block.
+       * @param out The decompressed block.
+       * @param out_size The size of the decompressed block's buffer.
+       * @return size_t The size of the block or 0 if the compressed block is
+       *                not valid.
+       */
+      virtual size_t decompress (const uint8_t* in,
+                                 size_t         size,
+                                 uint8_t*       out,
+                                 size_t         out_size) const = 0;
+    };
+
+    /**
+     * A container of codecs.
+     */
+    typedef std::vector < const codec* > codecs;
+
+    /**
+     * Get the codecs.
+     *
+     * @param codecs_ The codecs are added to this container.
+     */
+    void get_codecs (codecs& codecs_);
+
+    /**
+     * Get a codec by name. An unknown name throws an error.
+     *
+     * @param name The codec's name.
+     * @return const codec& The codec.
+     */
+    const codec& get_codec (const std::string& name);
+
+    /**
+     * Get a codec by its RAP file header label. An unknown label throws an
+     * error.
+     *
+     * @param label The codec's label.
+     * @return const codec& The codec.
+     */
+    const codec& get_codec_by_label (const std::string& label);
+
+    /**
+     * The pipeline of threads compressing the blocks of a compressor.
+     */
+    class pipeline;
+
     /**
      * A compressor.
      */
@@ -44,11 +174,13 @@ namespace rld
        * @param size The size of the input and output buffers.
        * @param out The compressor is compressing.
        * @param compress Set to false to disable compression.
+       * @param coder The codec, the default is FastLZ (lz77).
        */
       compressor (files::image& image,
                   size_t        size,
                   bool          out = true,
-                  bool          compress = true);
+                  bool          compress = true,
+                  const codec*  coder = 0);
 
       /**
        * Destruct the compressor.
@@ -80,6 +212,17 @@ namespace rld
        */
       void flush ();
 
+      /**
+       * Set the number of threads compressing the blocks. The blocks are
+       * filled by the caller's thread and compressed on a pool of threads,
+       * and are written to the image in the order they are filled so the
+       * image is the same for any number of jobs. Set the jobs before
+       * writing any data.
+       *
+       * @param jobs The number of jobs. The default is 1.
+       */
+      void set_jobs (int jobs);
+
       /**
        * Read the compressed data into the input buffer and return the section
        * requested.
@@ -139,22 +282,40 @@ namespace rld
        */
       void output (bool forced = false);
 
+      /**
+       * Write a compressed block with its header to the image.
+       *
+       * @param data The compressed block.
+       * @param compressed The size of the compressed block.
+       * @param length The size of the block.
+       */
+      void output_block (const uint8_t* data, size_t compressed, size_t length);
+
       /**
        * Input a block of compressed data and decompress it.
        */
       void input ();
 
+      /**
+       * Make sure the buffers can hold a block and its compressed data.
+       */
+      void reserve (size_t block_size, size_t io_size);
+
       files::image& image;            //< The image to read or write to or from.
+      const codec&  coder;            //< The codec.
       size_t        size;             //< The size of the buffer.
       bool          out;              //< If true the it is compression.
       bool          compress;         //< If true compress the data.
       uint8_t*      buffer;           //< The decompressed buffer
       uint8_t*      io;               //< The I/O buffer.
+      size_t        io_size;          //< The size of the I/O buffer.
       size_t        level;            //< The amount of data in the buffer.
+      size_t        position;         //< The read position in the buffer.
       size_t        total;            //< The amount of uncompressed data
                                       //  transferred.
       size_t        total_compressed; //< The amount of compressed data
                                       //  transferred.
+      pipeline*     workers;          //< The compress threads if set.
     };
 
     /**
@@ -192,6 +353,63 @@ namespace rld
       return v;
     }
 
+    /**
+     * Write a variable length value to the compressor. The value is written 7
+     * bits at a time starting with the least significant bits and the top bit
+     * of a byte is set if more bytes follow.
+     */
+    inline void write_varint (compressor& comp, uint32_t value)
+    {
+      uint8_t bytes[5];
+      size_t  b = 0;
+      while (value >= 0x80)
+      {
+        bytes[b++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+      }
+      bytes[b++] = (uint8_t) value;
+      comp.write (bytes, b);
+    }
+
+    /**
+     * Read a variable length value from the compressor.
+     */
+    inline uint32_t read_varint (compressor& comp)
+    {
+      uint32_t value = 0;
+      int      shift = 0;
+      while (true)
+      {
+        uint8_t byte;
+        if (comp.read (&byte, 1) != 1)
+          throw rld::error ("Reading of value failed", "compression");
+        if (shift > 28)
+          throw rld::error ("Invalid variable length value", "compression");
+        value |= ((uint32_t) (byte & 0x7f)) << shift;
+        if ((byte & 0x80) == 0)
+          break;
+        shift += 7;
+      }
+      return value;
+    }
+
+    /**
+     * Map a signed value to an unsigned value so small negative values have a
+     * short variable length value.
+     */
+    inline uint32_t zigzag_encode (int32_t value)
+    {
+      return (((uint32_t) value) << 1) ^ (uint32_t) (value >> 31);
+    }
+
+    /**
+     * Map back the unsigned value to the signed value.
+     */
+    inline int32_t zigzag_decode (uint32_t value)
+    {
+      return (int32_t) ((value >> 1) ^ (0 - (value & 1)));
+    }
+
   }
 }
 
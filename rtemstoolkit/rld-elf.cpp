@@ -24,6 +24,8 @@
 
 #include <string.h>
 
+#include <mutex>
+
 #include <rld.h>
 
 namespace rld
@@ -47,6 +49,13 @@ namespace rld
     static unsigned int elf_object_class = ELFCLASSNONE;
     static unsigned int elf_object_machinetype = EM_NONE;
     static unsigned int elf_object_datatype = ELFDATANONE;
+    static elf_word     elf_object_flags = 0;
+
+    /**
+     * Object files can be begun on more than one thread so the library
+     * initialisation and the recorded object type are locked.
+     */
+    static std::mutex elf_object_lock;
 
     /**
      * A single place to initialise the libelf library. This must be called
@@ -56,6 +65,7 @@ namespace rld
     libelf_initialise ()
     {
       static bool libelf_initialised = false;
+      std::lock_guard < std::mutex > guard (elf_object_lock);
       if (!libelf_initialised)
       {
         if (::elf_version (EV_CURRENT) == EV_NONE)
@@ -129,7 +139,7 @@ namespace rld
                       elf_xword          entry_size)
       : file_ (&file_),
         index_ (index_),
-        name_ (name_),
+        name_ (&rld::intern (name_)),
         scn (0),
         data_ (0),
         rela (false)
@@ -166,6 +176,7 @@ namespace rld
     section::section (file& file_, int index_)
       : file_ (&file_),
         index_ (index_),
+        name_ (&rld::intern ("")),
         scn (0),
         data_ (0),
         rela (false)
@@ -181,13 +192,13 @@ namespace rld
 
       if (shdr.sh_type != SHT_NULL)
       {
-        name_ = file_.get_string (shdr.sh_name);
+        name_ = &file_.get_string (shdr.sh_name);
         data_ = ::elf_getdata (scn, 0);
         if (!data_)
         {
           data_ = ::elf_rawdata (scn, 0);
           if (!data_)
-            libelf_error ("elf_getdata: " + name_ + '(' + file_.name () + ')');
+            libelf_error ("elf_getdata: " + *name_ + '(' + file_.name () + ')');
         }
       }
 
@@ -215,6 +226,7 @@ namespace rld
     section::section ()
       : file_ (0),
         index_ (-1),
+        name_ (&rld::intern ("")),
         scn (0),
         data_ (0),
         rela (false)
@@ -233,7 +245,7 @@ namespace rld
 
       data_ = ::elf_newdata(scn);
       if (!data_)
-        libelf_error ("elf_newdata: " + name_ + " (" + file_->name () + ')');
+        libelf_error ("elf_newdata: " + *name_ + " (" + file_->name () + ')');
 
       data_->d_type = type;
       data_->d_off = offset;
@@ -243,7 +255,7 @@ namespace rld
       data_->d_buf = buffer;
 
       if (!gelf_update_shdr (scn, &shdr))
-        libelf_error ("gelf_update_shdr: " + name_ + " (" + file_->name () + ')');
+        libelf_error ("gelf_update_shdr: " + *name_ + " (" + file_->name () + ')');
     }
 
     int
@@ -257,7 +269,7 @@ namespace rld
     section::name () const
     {
       check ("name");
-      return name_;
+      return *name_;
     }
 
     elf_data*
@@ -348,7 +360,7 @@ namespace rld
       check_writable ("set_name");
       shdr.sh_name = index;
       if (!gelf_update_shdr (scn, &shdr))
-        libelf_error ("gelf_update_shdr: " + name_ + " (" + file_->name () + ')');
+        libelf_error ("gelf_update_shdr: " + *name_ + " (" + file_->name () + ')');
     }
 
     void
@@ -428,7 +440,8 @@ namespace rld
         ident_str (0),
         ident_size (0),
         ehdr (0),
-        phdr (0)
+        phdr (0),
+        symbols_loaded (false)
     {
     }
 
@@ -443,6 +456,15 @@ namespace rld
       begin (name__, fd__, writable_, 0, 0);
     }
 
+    void
+    file::begin (const std::string& name__,
+                 int                fd__,
+                 const uint8_t*     image,
+                 size_t             size)
+    {
+      begin (name__, fd__, false, 0, 0, image, size);
+    }
+
     void
     file::begin (const std::string& name__, file& archive_, off_t offset)
     {
@@ -461,7 +483,9 @@ namespace rld
                  int                fd__,
                  const bool         writable_,
                  file*              archive_,
-                 off_t              offset_)
+                 off_t              offset_,
+                 const uint8_t*     image,
+                 size_t             size)
     {
       if (fd__ < 0)
         throw rld::error ("No file descriptor", "elf:file:begin");
@@ -492,11 +516,23 @@ namespace rld
       }
 
       /*
-       * Note, the elf passed is either the archive or NULL.
+       * Cannot write into an image in memory.
+       */
+      if (image && (archive_ || writable_))
+        throw rld::error ("Cannot begin a writable or archived file in memory",
+                          "elf:file:begin");
+
+      /*
+       * Note, the elf passed is either the archive or NULL. A read-only
+       * file in memory does not need libelf to read or map it again.
        */
-      elf* elf__ = ::elf_begin (fd__,
-                                writable_ ? ELF_C_WRITE : ELF_C_READ,
-                                archive_ ? archive_->elf_ : 0);
+      elf* elf__;
+      if (image)
+        elf__ = ::elf_memory ((char*) image, size);
+      else
+        elf__ = ::elf_begin (fd__,
+                             writable_ ? ELF_C_WRITE : ELF_C_READ,
+                             archive_ ? archive_->elf_ : 0);
       if (!elf__)
         libelf_error ("begin: " + name__);
 
@@ -612,6 +648,7 @@ namespace rld
        */
       shstrtab += '\0';
       shstrtab += ".shstrtab";
+      shstrtab += '\0';
 
       /*
        * Create the string table section.
@@ -695,6 +732,13 @@ namespace rld
       return ident_str[EI_DATA];
     }
 
+    elf_word
+    file::flags () const
+    {
+      check_ehdr ("flags");
+      return ehdr->e_flags;
+    }
+
     bool
     file::is_archive () const
     {
@@ -778,7 +822,7 @@ namespace rld
     void
     file::load_symbols ()
     {
-      if (symbols.empty ())
+      if (!symbols_loaded)
       {
         if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
           std::cout << "elf:symbol: " << name () << std::endl;
@@ -787,6 +831,14 @@ namespace rld
 
         get_sections (symbol_secs, SHT_SYMTAB);
 
+        size_t total = 0;
+        for (sections::iterator si = symbol_secs.begin ();
+             si != symbol_secs.end ();
+             ++si)
+          total += (*si)->entries ();
+
+        symbols.reserve (total);
+
         for (sections::iterator si = symbol_secs.begin ();
              si != symbol_secs.end ();
              ++si)
@@ -801,8 +853,8 @@ namespace rld
             if (!::gelf_getsym (sec.data (), s, &esym))
              error ("gelf_getsym");
 
-            std::string     name = get_string (sec.link (), esym.st_name);
-            symbols::symbol sym (s, name, esym);
+            const std::string& name = get_string (sec.link (), esym.st_name);
+            symbols::symbol    sym (s, name, esym);
 
             if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
               std::cout << "elf:symbol: " << sym << std::endl;
@@ -810,6 +862,8 @@ namespace rld
             symbols.push_back (sym);
           }
         }
+
+        symbols_loaded = true;
       }
     }
 
@@ -830,47 +884,7 @@ namespace rld
 
       load_symbols ();
 
-      filtered_syms.clear ();
-
-      for (symbols::bucket::iterator si = symbols.begin ();
-           si != symbols.end ();
-           ++si)
-      {
-        symbols::symbol& sym = *si;
-
-        int stype = sym.type ();
-        int sbind = sym.binding ();
-
-        /*
-         * If wanting unresolved symbols and the type is no-type and the
-         * section is undefined, or, the type is no-type or object or function
-         * and the bind is local and we want local symbols, or the bind is weak
-         * and we want weak symbols, or the bind is global and we want global
-         * symbols then add the filtered symbols container.
-         */
-        bool add = false;
-
-        if ((stype == STT_NOTYPE) &&
-            (sbind == STB_GLOBAL) &&
-            (sym.section_index () == SHN_UNDEF))
-        {
-          if (unresolved)
-            add = true;
-        }
-        else
-        {
-          if (((stype == STT_NOTYPE) ||
-               (stype == STT_OBJECT) ||
-               (stype == STT_FUNC)) &&
-              ((weak && (sbind == STB_WEAK)) ||
-               (!unresolved && ((local && (sbind == STB_LOCAL)) ||
-                                (global && (sbind == STB_GLOBAL))))))
-            add = true;
-        }
-
-        if (add)
-          filtered_syms.push_back (&sym);
-      }
+      filter_symbols (symbols, filtered_syms, unresolved, local, weak, global);
     }
 
     const symbols::symbol&
@@ -895,6 +909,11 @@ namespace rld
       if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
         std::cout << "elf:reloc: " << name () << std::endl;
 
+      /*
+       * The relocation records reference the symbols.
+       */
+      load_symbols ();
+
       sections rel_secs;
 
       get_sections (rel_secs, SHT_REL);
@@ -970,31 +989,32 @@ namespace rld
       }
     }
 
-    std::string
+    const std::string&
     file::get_string (int section, size_t offset)
     {
       check ("get_string");
       char* s = ::elf_strptr (elf_, section, offset);
       if (!s)
         error ("elf_strptr");
-      return s;
+      return rld::intern (s);
     }
 
-    std::string
+    const std::string&
     file::get_string (size_t offset)
     {
       check ("get_string");
       char* s = ::elf_strptr (elf_, strings_section (), offset);
       if (!s)
         error ("elf_strptr");
-      return s;
+      return rld::intern (s);
     }
 
     void
     file::set_header (elf_half      type,
                       int           class_,
                       elf_half      machinetype,
-                      unsigned char datatype)
+                      unsigned char datatype,
+                      elf_word      flags)
     {
       check_writable ("set_header");
 
@@ -1018,7 +1038,7 @@ namespace rld
       {
         ((elf32_ehdr*)ehdr)->e_type = type;
         ((elf32_ehdr*)ehdr)->e_machine = machinetype;
-        ((elf32_ehdr*)ehdr)->e_flags = 0;
+        ((elf32_ehdr*)ehdr)->e_flags = flags;
         ((elf32_ehdr*)ehdr)->e_ident[EI_DATA] = datatype;
         ((elf32_ehdr*)ehdr)->e_version = EV_CURRENT;
       }
@@ -1026,7 +1046,7 @@ namespace rld
       {
         ehdr->e_type = type;
         ehdr->e_machine = machinetype;
-        ehdr->e_flags = 0;
+        ehdr->e_flags = flags;
         ehdr->e_ident[EI_DATA] = datatype;
         ehdr->e_version = EV_CURRENT;
       }
@@ -1180,11 +1200,22 @@ namespace rld
       return elf_object_datatype;
     }
 
+    elf_word
+    object_flags ()
+    {
+      return elf_object_flags;
+    }
+
     void
     check_file(const file& file)
     {
+      std::lock_guard < std::mutex > guard (elf_object_lock);
+
       if (elf_object_machinetype == EM_NONE)
+      {
         elf_object_machinetype = file.machinetype ();
+        elf_object_flags = file.flags ();
+      }
       else if (file.machinetype () != elf_object_machinetype)
       {
         std::ostringstream oss;
@@ -1206,5 +1237,56 @@ namespace rld
                           "elf:check_file: " + file.name ());
     }
 
+    void
+    filter_symbols (symbols::bucket&   syms,
+                    symbols::pointers& filtered_syms,
+                    bool               unresolved,
+                    bool               local,
+                    bool               weak,
+                    bool               global)
+    {
+      filtered_syms.clear ();
+
+      for (symbols::bucket::iterator si = syms.begin ();
+           si != syms.end ();
+           ++si)
+      {
+        symbols::symbol& sym = *si;
+
+        int stype = sym.type ();
+        int sbind = sym.binding ();
+
+        /*
+         * If wanting unresolved symbols and the type is no-type and the
+         * section is undefined, or, the type is no-type or object or function
+         * and the bind is local and we want local symbols, or the bind is weak
+         * and we want weak symbols, or the bind is global and we want global
+         * symbols then add the filtered symbols container.
+         */
+        bool add = false;
+
+        if ((stype == STT_NOTYPE) &&
+            (sbind == STB_GLOBAL) &&
+            (sym.section_index () == SHN_UNDEF))
+        {
+          if (unresolved)
+            add = true;
+        }
+        else
+        {
+          if (((stype == STT_NOTYPE) ||
+               (stype == STT_OBJECT) ||
+               (stype == STT_FUNC)) &&
+              ((weak && (sbind == STB_WEAK)) ||
+               (!unresolved && ((local && (sbind == STB_LOCAL)) ||
+                                (global && (sbind == STB_GLOBAL))))))
+            add = true;
+        }
+
+        if (add)
+          filtered_syms.push_back (&sym);
+      }
+    }
+
   }
 }
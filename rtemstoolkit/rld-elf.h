@@ -342,14 +342,14 @@ namespace rld
        */
       void check_writable (const char* where) const;
 
-      file*       file_;  //< The ELF file.
-      int         index_; //< The section header index.
-      std::string name_;  //< The section's name.
-      elf_scn*    scn;    //< ELF private section data.
-      elf_shdr    shdr;   //< The section header.
-      elf_data*   data_;  //< The section's data.
-      bool        rela;   //< The type of relocation records.
-      relocations relocs; //< The relocation records.
+      file*              file_;  //< The ELF file.
+      int                index_; //< The section header index.
+      const std::string* name_;  //< The section's interned name.
+      elf_scn*           scn;    //< ELF private section data.
+      elf_shdr           shdr;   //< The section header.
+      elf_data*          data_;  //< The section's data.
+      bool               rela;   //< The type of relocation records.
+      relocations        relocs; //< The relocation records.
     };
 
     /**
@@ -434,6 +434,22 @@ namespace rld
        */
       void begin (const std::string& name, int fd, const bool writable = false);
 
+      /**
+       * Begin reading the ELF file from an image of it in memory, for example
+       * the file mapped into memory. The image must stay valid until the
+       * session ends. Objects in the image if it is an archive are views of
+       * the image and are not read from the file descriptor.
+       *
+       * @param name The full name of the file.
+       * @param fd The file descriptor of the file the image is of.
+       * @param image The image of the file.
+       * @param size The size of the image.
+       */
+      void begin (const std::string& name,
+                  int                fd,
+                  const uint8_t*     image,
+                  size_t             size);
+
       /**
        * Begin using the ELF file in an archive.
        *
@@ -480,6 +496,11 @@ namespace rld
        */
       unsigned int data_type () const;
 
+      /**
+       * Get the processor specific flags in the ELF header.
+       */
+      elf_word flags () const;
+
       /**
        * Is the file an archive format file ?
        */
@@ -535,21 +556,22 @@ namespace rld
        *
        * @param section The section to search for the string.
        * @param offset The offset in the string section.
-       * @return std::string The string.
+       * @return const std::string& The interned string.
        */
-      std::string get_string (int section, size_t offset);
+      const std::string& get_string (int section, size_t offset);
 
       /**
        * Get the string from the ELF header declared string section at the
        * requested offset.
        *
        * @param offset The offset in the string section.
-       * @return std::string The string.
+       * @return const std::string& The interned string.
        */
-      std::string get_string (size_t offset);
+      const std::string& get_string (size_t offset);
 
       /**
-       * Load the symbols.
+       * Load the symbols. The symbols are loaded once and stay loaded when
+       * the session ends.
        */
       void load_symbols ();
 
@@ -613,11 +635,13 @@ namespace rld
        * @param class_ The files ELF class.
        * @param machinetype The type of machine code present in the ELF file.
        * @param datatype The data type, ie LSB or MSB.
+       * @param flags The processor specific flags.
        */
       void set_header (elf_half      type,
                        int           class_,
                        elf_half      machinetype,
-                       unsigned char datatype);
+                       unsigned char datatype,
+                       elf_word      flags = 0);
 
       /**
        * Add a section to the ELF file if writable.
@@ -654,12 +678,16 @@ namespace rld
        * @param writable The file is writeable. It cannot be part of an archive.
        * @param archive The archive's ELF handle or 0 if not an archive.
        * @param offset The offset of the ELF file in the archive if elf is non-zero.
+       * @param image The image of the file in memory or 0 to read the file.
+       * @param size The size of the image.
        */
       void begin (const std::string& name,
                   int                fd,
                   const bool         writable,
                   file*              archive,
-                  off_t              offset);
+                  off_t              offset,
+                  const uint8_t*     image = 0,
+                  size_t             size = 0);
 
       /**
        * Check if the file is usable. Throw an exception if not.
@@ -711,6 +739,7 @@ namespace rld
       program_headers      phdrs;      //< The program headers when creating
                                        //  ELF files.
       rld::symbols::bucket symbols;    //< The symbols. All tables point here.
+      bool                 symbols_loaded; //< The symbols have been loaded.
     };
 
     /**
@@ -740,6 +769,12 @@ namespace rld
      */
     unsigned int object_datatype ();
 
+    /**
+     * Return the processor specific flags of the first file checked by the
+     * check_file call.
+     */
+    elf_word object_flags ();
+
     /**
      * Check the file against the global machine type, object class and data
      * type. If this is the first file checked it becomes the default all
@@ -750,6 +785,26 @@ namespace rld
      */
     void check_file(const file& file);
 
+    /**
+     * Filter a bucket of symbols by the various types. The filtered symbols
+     * are in the bucket's order. The file's symbols are filtered with this
+     * call.
+     *
+     * @param syms The symbols to filter.
+     * @param filtered_syms The filtered symbols. This is a list of pointers
+     *                      to the symbols in the bucket.
+     * @param unresolved Return unresolved symbols.
+     * @param local Return local symbols.
+     * @param weak Return weak symbols.
+     * @param global Return global symbols.
+     */
+    void filter_symbols (rld::symbols::bucket&   syms,
+                         rld::symbols::pointers& filtered_syms,
+                         bool                    unresolved,
+                         bool                    local,
+                         bool                    weak,
+                         bool                    global);
+
   }
 }
 
@@ -19,6 +19,12 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <errno.h>
 #include <fcntl.h>
@@ -27,6 +33,14 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#if HAVE_GETRLIMIT
+#include <sys/resource.h>
+#endif
+
 #include <rld.h>
 
 #if __WIN32__
@@ -228,6 +242,9 @@ namespace rld
       : name_ (name),
         references_ (0),
         fd_ (-1),
+        map_ (0),
+        map_size_ (0),
+        position_ (0),
         symbol_refs (0),
         writable (false)
     {
@@ -237,6 +254,9 @@ namespace rld
       : name_ (path, is_object),
         references_ (0),
         fd_ (-1),
+        map_ (0),
+        map_size_ (0),
+        position_ (0),
         symbol_refs (0),
         writable (false)
     {
@@ -245,6 +265,9 @@ namespace rld
     image::image ()
       : references_ (0),
         fd_ (-1),
+        map_ (0),
+        map_size_ (0),
+        position_ (0),
         symbol_refs (0),
         writable (false)
     {
@@ -254,6 +277,7 @@ namespace rld
     {
       if (references_)
         throw rld_error_at ("references when destructing image");
+      unmap ();
       if (fd_ >= 0)
         ::close (fd_);
     }
@@ -289,6 +313,9 @@ namespace rld
           fd_ = ::open (path.c_str (), OPEN_FLAGS | O_RDONLY);
         if (fd_ < 0)
           throw rld::error (::strerror (errno), "open:" + path);
+
+        if (!writable)
+          map ();
       }
       else
       {
@@ -311,6 +338,12 @@ namespace rld
         --references_;
         if (references_ == 0)
         {
+          /*
+           * A session reading the mapped file cannot outlive the mapping.
+           */
+          if (map_)
+            elf_.end ();
+          unmap ();
           ::close (fd_);
           fd_ = -1;
         }
@@ -320,6 +353,19 @@ namespace rld
     ssize_t
     image::read (void* buffer_, size_t size)
     {
+      const uint8_t* data = mapped ();
+      if (data)
+      {
+        size_t available = 0;
+        if ((size_t) position_ < mapped_size ())
+          available = mapped_size () - position_;
+        if (size > available)
+          size = available;
+        ::memcpy (buffer_, data + position_, size);
+        position_ += size;
+        return size;
+      }
+
       uint8_t* buffer = static_cast <uint8_t*> (buffer_);
       size_t   have_read = 0;
       size_t   to_read = size;
@@ -358,6 +404,11 @@ namespace rld
     void
     image::seek (off_t offset)
     {
+      if (mapped ())
+      {
+        position_ = name_.offset () + offset;
+        return;
+      }
       if (::lseek (fd (), name_.offset () + offset, SEEK_SET) < 0)
         throw rld::error (strerror (errno), "lseek:" + name ().path ());
     }
@@ -400,12 +451,54 @@ namespace rld
       return fd_;
     }
 
+    const uint8_t*
+    image::mapped () const
+    {
+      return map_;
+    }
+
+    size_t
+    image::mapped_size () const
+    {
+      return map_size_;
+    }
+
     rld::elf::file&
     image::elf ()
     {
       return elf_;
     }
 
+    void
+    image::map ()
+    {
+#if HAVE_MMAP
+      struct stat sb;
+      if ((::fstat (fd_, &sb) == 0) && S_ISREG (sb.st_mode) && (sb.st_size > 0))
+      {
+        void* m = ::mmap (0, sb.st_size, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (m != MAP_FAILED)
+        {
+          map_ = static_cast <uint8_t*> (m);
+          map_size_ = sb.st_size;
+          position_ = 0;
+        }
+      }
+#endif
+    }
+
+    void
+    image::unmap ()
+    {
+#if HAVE_MMAP
+      if (map_)
+        ::munmap (map_, map_size_);
+#endif
+      map_ = 0;
+      map_size_ = 0;
+      position_ = 0;
+    }
+
     void
     image::symbol_referenced ()
     {
@@ -437,10 +530,7 @@ namespace rld
            */
 
           size_t l = size < COPY_FILE_BUFFER_SIZE ? size : COPY_FILE_BUFFER_SIZE;
-          ssize_t r = ::read (in.fd (), buffer, l);
-
-          if (r < 0)
-            throw rld::error (::strerror (errno), "reading: " + in.name ().full ());
+          ssize_t r = in.read (buffer, l);
 
           if (r == 0)
           {
@@ -470,6 +560,52 @@ namespace rld
         delete [] buffer;
     }
 
+    uint64_t
+    hash_object (object& obj, uint64_t hash)
+    {
+      const off_t  offset = obj.name ().offset ();
+      const size_t size = obj.name ().size ();
+
+      obj.open ();
+
+      try
+      {
+        const uint8_t* data = obj.mapped ();
+        if (data)
+        {
+          if ((offset + size) > obj.mapped_size ())
+            throw rld::error ("image too short",
+                              "hash: " + obj.name ().full ());
+          hash = rld::hash_bytes (data + offset, size, hash);
+        }
+        else
+        {
+          uint8_t buffer[COPY_FILE_BUFFER_SIZE];
+          size_t  have_read = 0;
+          while (have_read < size)
+          {
+            size_t l = size - have_read;
+            if (l > sizeof (buffer))
+              l = sizeof (buffer);
+            if (!obj.seek_read (have_read, buffer, l))
+              throw rld::error ("input too short",
+                                "hash: " + obj.name ().full ());
+            hash = rld::hash_bytes (buffer, l, hash);
+            have_read += l;
+          }
+        }
+      }
+      catch (...)
+      {
+        obj.close ();
+        throw;
+      }
+
+      obj.close ();
+
+      return hash;
+    }
+
     /**
      * Defines for the header of an archive.
      */
@@ -513,7 +649,10 @@ namespace rld
     {
       if (references () == 1)
       {
-        elf ().begin (name ().full (), fd ());
+        if (mapped ())
+          elf ().begin (name ().full (), fd (), mapped (), mapped_size ());
+        else
+          elf ().begin (name ().full (), fd ());
 
         /*
          * Make sure it is an archive.
@@ -832,6 +971,27 @@ namespace rld
     {
     }
 
+    relocation::relocation (const uint32_t     offset,
+                            const uint32_t     type,
+                            const uint32_t     info,
+                            const int32_t      addend,
+                            const std::string& symname,
+                            const uint32_t     symtype,
+                            const int          symsect,
+                            const uint32_t     symvalue,
+                            const uint32_t     symbinding)
+      : offset (offset),
+        type (type),
+        info (info),
+        addend (addend),
+        symname (rld::intern (symname)),
+        symtype (symtype),
+        symsect (symsect),
+        symvalue (symvalue),
+        symbinding (symbinding)
+    {
+    }
+
     section::section (const elf::section& es)
       : name (es.name ()),
         index (es.index ()),
@@ -899,6 +1059,7 @@ namespace rld
       : image (name_),
         archive_ (&archive_),
         valid_ (false),
+        indexed_ (false),
         resolving_ (false),
         resolved_ (false)
     {
@@ -910,6 +1071,7 @@ namespace rld
       : image (path),
         archive_ (0),
         valid_ (false),
+        indexed_ (false),
         resolving_ (false),
         resolved_ (false)
     {
@@ -920,6 +1082,7 @@ namespace rld
     object::object ()
       : archive_ (0),
         valid_ (false),
+        indexed_ (false),
         resolving_ (false),
         resolved_ (false)
     {
@@ -970,8 +1133,13 @@ namespace rld
         std::cout << "object:begin: " << name ().full () << " in-archive:"
                   << ((char*) (archive_ ? "yes" : "no")) << std::endl;
 
-      if (archive_)
+      if (archive_ && archive_->mapped ())
+        elf ().begin (name ().full (), archive_->fd (),
+                      archive_->mapped () + name ().offset (), name ().size ());
+      else if (archive_)
         elf ().begin (name ().full (), archive_->elf(), name ().offset ());
+      else if (!is_writable () && mapped ())
+        elf ().begin (name ().full (), fd (), mapped (), mapped_size ());
       else
         elf ().begin (name ().full (), fd (), is_writable ());
 
@@ -1043,7 +1211,7 @@ namespace rld
 
       if (local)
       {
-        elf ().get_symbols (syms, false, true, false, false);
+        get_symbols (syms, false, true, false, false);
 
         if (rld::verbose () >= RLD_VERBOSE_TRACE_SYMS)
           std::cout << "object:load-sym: local: total "
@@ -1063,7 +1231,7 @@ namespace rld
         }
       }
 
-      elf ().get_symbols (syms, false, false, true, false);
+      get_symbols (syms, false, false, true, false);
 
       if (rld::verbose () >= RLD_VERBOSE_TRACE_SYMS)
         std::cout << "object:load-sym: weak: total "
@@ -1083,7 +1251,7 @@ namespace rld
         externals.push_back (&sym);
       }
 
-      elf ().get_symbols (syms, false, false, false, true);
+      get_symbols (syms, false, false, false, true);
 
       if (rld::verbose () >= RLD_VERBOSE_TRACE_SYMS)
         std::cout << "object:load-sym: global: total "
@@ -1103,7 +1271,7 @@ namespace rld
         externals.push_back (&sym);
       }
 
-      elf ().get_symbols (syms, true, false, true, true);
+      get_symbols (syms, true, false, true, true);
 
       if (rld::verbose () >= RLD_VERBOSE_TRACE_SYMS)
         std::cout << "object:load-sym: unresolved: total "
@@ -1126,6 +1294,67 @@ namespace rld
       }
     }
 
+    void
+    object::load_index (symbols::bucket& syms)
+    {
+      index_syms.clear ();
+      index_syms.swap (syms);
+      indexed_ = true;
+    }
+
+    void
+    object::get_index_symbols (symbols::pointers& syms)
+    {
+      symbols::pointers globals;
+      get_symbols (syms, true, false, true, false);
+      get_symbols (globals, false, false, false, true);
+      syms.insert (syms.end (), globals.begin (), globals.end ());
+    }
+
+    bool
+    object::indexed () const
+    {
+      return indexed_;
+    }
+
+    void
+    object::load_sections ()
+    {
+      if (!valid_)
+      {
+        open ();
+        try
+        {
+          begin ();
+          end ();
+        }
+        catch (...)
+        {
+          close ();
+          throw;
+        }
+        close ();
+      }
+    }
+
+    void
+    object::get_symbols (symbols::pointers& syms,
+                         bool               unresolved,
+                         bool               local,
+                         bool               weak,
+                         bool               global)
+    {
+      if (indexed_)
+      {
+        if (local)
+          throw rld::error ("Local symbols are not indexed",
+                            "object:get-symbols: " + name ().full ());
+        elf::filter_symbols (index_syms, syms, unresolved, local, weak, global);
+      }
+      else
+        elf ().get_symbols (syms, unresolved, local, weak, global);
+    }
+
     void
     object::load_relocations ()
     {
@@ -1160,6 +1389,22 @@ namespace rld
       return image::size ();
     }
 
+    const uint8_t*
+    object::mapped () const
+    {
+      if (archive_)
+        return archive_->mapped ();
+      return image::mapped ();
+    }
+
+    size_t
+    object::mapped_size () const
+    {
+      if (archive_)
+        return archive_->mapped_size ();
+      return image::mapped_size ();
+    }
+
     int
     object::fd () const
     {
@@ -1279,7 +1524,8 @@ namespace rld
     }
 
     cache::cache ()
-      : opened (false)
+      : opened (false),
+        jobs_ (1)
     {
     }
 
@@ -1441,30 +1687,638 @@ namespace rld
       }
     }
 
+    /**
+     * The path of the archive symbol indexes. Empty if not used.
+     */
+    static std::string symbol_index_path;
+
+    void
+    set_symbol_index (const std::string& path)
+    {
+      symbol_index_path = path;
+    }
+
+    const std::string
+    get_symbol_index ()
+    {
+      return symbol_index_path;
+    }
+
+    /*
+     * The symbol index of an archive is a magic line, the archive's key and
+     * the object files. The numbers are 32bit little endian values and the
+     * strings have a 32bit length.
+     */
+    static const char* symbol_index_magic = "rld-symbol-index 2";
+
+    static void
+    index_put (std::ostream& out, uint32_t value)
+    {
+      char bytes[4] = { (char) value,
+                        (char) (value >> 8),
+                        (char) (value >> 16),
+                        (char) (value >> 24) };
+      out.write (bytes, sizeof (bytes));
+    }
+
+    static void
+    index_put (std::ostream& out, uint64_t value)
+    {
+      index_put (out, (uint32_t) value);
+      index_put (out, (uint32_t) (value >> 32));
+    }
+
+    static void
+    index_put (std::ostream& out, const std::string& str)
+    {
+      index_put (out, (uint32_t) str.size ());
+      out.write (str.data (), str.size ());
+    }
+
+    /**
+     * Read the values from a symbol index held in memory.
+     */
+    class index_reader
+    {
+    public:
+      index_reader (const std::string& data)
+        : data (data),
+          pos (0) {
+      }
+
+      bool get (uint32_t& value) {
+        if ((data.size () - pos) < 4)
+          return false;
+        const unsigned char* bytes = (const unsigned char*) data.data () + pos;
+        value = ((uint32_t) bytes[0]) |
+          (((uint32_t) bytes[1]) << 8) |
+          (((uint32_t) bytes[2]) << 16) |
+          (((uint32_t) bytes[3]) << 24);
+        pos += 4;
+        return true;
+      }
+
+      bool get (uint64_t& value) {
+        uint32_t low;
+        uint32_t high;
+        if (!get (low) || !get (high))
+          return false;
+        value = (((uint64_t) high) << 32) | low;
+        return true;
+      }
+
+      bool get (std::string& str) {
+        uint32_t size;
+        if (!get (size) || ((data.size () - pos) < size))
+          return false;
+        str.assign (data, pos, size);
+        pos += size;
+        return true;
+      }
+
+      bool get_line (std::string& line) {
+        size_t eol = data.find ('\n', pos);
+        if (eol == std::string::npos)
+          return false;
+        line.assign (data, pos, eol - pos);
+        pos = eol + 1;
+        return true;
+      }
+
+      bool end () const {
+        return pos == data.size ();
+      }
+
+    private:
+      const std::string& data;
+      size_t             pos;
+    };
+
+    /**
+     * The symbol index of an archive. The index holds the global, weak and
+     * unresolved symbols of each object file in the archive so the symbol
+     * table can be loaded without reading the object files. The archive's
+     * key is its size, modification time and a hash of the names, offsets
+     * and sizes of its object files. An index with a different key is not
+     * used and is replaced.
+     */
+    class symbol_index
+    {
+    public:
+      symbol_index ();
+
+      /**
+       * Load the index of the archive. The object files are the archive's
+       * object files and make the key. A missing or damaged index is empty.
+       */
+      void load (archive& ar, const object_list& objs);
+
+      /**
+       * Load the object file's symbols from the index. Returns false if the
+       * object file is not in the index.
+       */
+      bool get (object& obj);
+
+      /**
+       * Save the index if an object file was not in it. The object files
+       * need to have their symbols loaded.
+       */
+      void save (const object_list& objs);
+
+    private:
+      /**
+       * An object file in the index.
+       */
+      struct member
+      {
+        std::string     name;    //< The object file's name.
+        uint64_t        size;    //< The size in the archive.
+        symbols::bucket syms;    //< The object file's symbols.
+      };
+
+      typedef std::map < uint64_t, member > members;
+
+      std::string path;     //< The path of the index.
+      std::string key;      //< The archive's key.
+      members     mems;     //< The object files by offset.
+      bool        missed;   //< An object file was not in the index.
+    };
+
+    symbol_index::symbol_index ()
+      : missed (false)
+    {
+    }
+
+    void
+    symbol_index::load (archive& ar, const object_list& objs)
+    {
+      char name[32];
+
+      ::snprintf (name, sizeof (name), "%016llx.rldi",
+                  (unsigned long long) rld::hash_bytes (ar.path ()));
+      rld::path::path_join (symbol_index_path, name, path);
+
+      /*
+       * The key is the hash of the name, offset, size and bytes of each object
+       * file. The archive is held open so it is mapped once.
+       */
+      uint64_t hash = rld::hash_basis;
+
+      ar.open ();
+
+      try
+      {
+        for (object_list::const_iterator oi = objs.begin ();
+             oi != objs.end ();
+             ++oi)
+        {
+          const file& oname = (*oi)->name ();
+          hash = rld::hash_bytes (oname.oname () + ' ' +
+                                  rld::to_string (oname.offset ()) + ' ' +
+                                  rld::to_string (oname.size ()) + '\n',
+                                  hash);
+          hash = hash_object (*(*oi), hash);
+        }
+      }
+      catch (...)
+      {
+        ar.close ();
+        throw;
+      }
+
+      ar.close ();
+
+      char hash_str[32];
+      ::snprintf (hash_str, sizeof (hash_str), "%016llx",
+                  (unsigned long long) hash);
+
+      key = ar.path () + ' ' + hash_str;
+
+      std::ifstream in (path.c_str (), std::ios_base::in | std::ios_base::binary);
+      if (!in.is_open ())
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:symbol-index: " << ar.path ()
+                    << ": no index" << std::endl;
+        return;
+      }
+
+      std::string contents;
+      in.seekg (0, std::ios_base::end);
+      std::streamoff size = in.tellg ();
+      in.seekg (0, std::ios_base::beg);
+      if (size > 0)
+      {
+        contents.resize (size);
+        if (!in.read (&contents[0], size))
+          contents.clear ();
+      }
+      in.close ();
+
+      index_reader reader (contents);
+      std::string  line;
+      std::string  index_key;
+      uint32_t     count = 0;
+      bool         ok = (reader.get_line (line) &&
+                         (line == symbol_index_magic) &&
+                         reader.get (index_key) &&
+                         reader.get (count));
+
+      if (ok && (index_key != key))
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:symbol-index: " << ar.path ()
+                    << ": archive changed" << std::endl;
+        return;
+      }
+
+      for (uint32_t m = 0; ok && (m < count); ++m)
+      {
+        std::string mname;
+        uint64_t    offset = 0;
+        uint32_t    syms = 0;
+
+        ok = reader.get (mname) && reader.get (offset);
+        if (!ok)
+          break;
+
+        member& mem = mems[offset];
+
+        mem.name = mname;
+
+        ok = reader.get (mem.size) && reader.get (syms);
+
+        for (uint32_t s = 0; ok && (s < syms); ++s)
+        {
+          uint32_t     index = 0;
+          std::string  sname;
+          elf::elf_sym esym;
+          uint64_t     value = 0;
+          uint64_t     ssize = 0;
+          uint32_t     info = 0;
+          uint32_t     other = 0;
+          uint32_t     shndx = 0;
+
+          ok = (reader.get (index) &&
+                reader.get (sname) &&
+                reader.get (value) &&
+                reader.get (ssize) &&
+                reader.get (info) &&
+                reader.get (other) &&
+                reader.get (shndx));
+
+          if (ok)
+          {
+            ::memset (&esym, 0, sizeof (esym));
+            esym.st_value = value;
+            esym.st_size = ssize;
+            esym.st_info = info;
+            esym.st_other = other;
+            esym.st_shndx = shndx;
+            mem.syms.push_back (symbols::symbol (index, sname, esym));
+          }
+        }
+      }
+
+      if (ok)
+        ok = reader.end ();
+
+      if (!ok)
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:symbol-index: " << path
+                    << ": invalid, ignored" << std::endl;
+        mems.clear ();
+        return;
+      }
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "cache:symbol-index: " << ar.path ()
+                  << ": objects: " << mems.size () << std::endl;
+    }
+
+    bool
+    symbol_index::get (object& obj)
+    {
+      members::iterator mi = mems.find (obj.name ().offset ());
+      if ((mi == mems.end ()) ||
+          ((*mi).second.name != obj.name ().oname ()) ||
+          ((*mi).second.size != (uint64_t) obj.name ().size ()))
+      {
+        missed = true;
+        return false;
+      }
+      obj.load_index ((*mi).second.syms);
+      mems.erase (mi);
+      return true;
+    }
+
+    void
+    symbol_index::save (const object_list& objs)
+    {
+      if (!missed)
+        return;
+
+      rld::path::make_directory (symbol_index_path);
+
+      rld::atomic_file file (path);
+      if (!file.is_open ())
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:symbol-index: " << path
+                    << ": cannot create" << std::endl;
+        return;
+      }
+
+      std::ostream& out = file.out ();
+
+      out << symbol_index_magic << std::endl;
+      index_put (out, key);
+      index_put (out, (uint32_t) objs.size ());
+
+      for (object_list::const_iterator oi = objs.begin ();
+           oi != objs.end ();
+           ++oi)
+      {
+        object&           obj = *(*oi);
+        symbols::pointers syms;
+
+        obj.get_index_symbols (syms);
+
+        index_put (out, obj.name ().oname ());
+        index_put (out, (uint64_t) obj.name ().offset ());
+        index_put (out, (uint64_t) obj.name ().size ());
+        index_put (out, (uint32_t) syms.size ());
+
+        for (symbols::pointers::const_iterator si = syms.begin ();
+             si != syms.end ();
+             ++si)
+        {
+          const symbols::symbol& sym = *(*si);
+          const elf::elf_sym&    esym = sym.esym ();
+          index_put (out, (uint32_t) sym.index ());
+          index_put (out, sym.name ());
+          index_put (out, (uint64_t) esym.st_value);
+          index_put (out, (uint64_t) esym.st_size);
+          index_put (out, (uint32_t) esym.st_info);
+          index_put (out, (uint32_t) esym.st_other);
+          index_put (out, (uint32_t) esym.st_shndx);
+        }
+      }
+
+      if (!file.commit ())
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:symbol-index: " << path
+                    << ": not saved" << std::endl;
+        return;
+      }
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "cache:symbol-index: " << path
+                  << ": saved: objects: " << objs.size () << std::endl;
+    }
+
+    /**
+     * The number of threads that can load object files. A thread has at most
+     * one object file that is not in an archive open so leave enough file
+     * descriptors for the archives held open and the files opened as the
+     * output is created.
+     */
+    static int
+    load_jobs (int jobs, size_t objects, size_t archives)
+    {
+      if ((size_t) jobs > objects)
+        jobs = objects;
+#if HAVE_GETRLIMIT
+      struct rlimit rl;
+      if ((::getrlimit (RLIMIT_NOFILE, &rl) == 0) &&
+          (rl.rlim_cur != RLIM_INFINITY))
+      {
+        const rlim_t reserved = archives + 32;
+        if (rl.rlim_cur <= reserved)
+          jobs = 1;
+        else if ((rlim_t) jobs > rl.rlim_cur - reserved)
+          jobs = rl.rlim_cur - reserved;
+      }
+#else
+      (void) archives;
+#endif
+      if (jobs < 1)
+        jobs = 1;
+      return jobs;
+    }
+
+    /**
+     * Parse the symbols of the object files on a pool of threads. An object
+     * file in an open archive that is mapped into memory is a view of the
+     * archive's image and can be read without touching the archive. Any
+     * other object file in an archive shares the archive's file and libelf
+     * handle and is read holding a lock. The first error in object file
+     * order is rethrown once all threads have finished.
+     */
+    class object_parser
+    {
+    public:
+      object_parser (std::vector < object* >& objs)
+        : objs (objs),
+          next (0),
+          failed (false),
+          error_index (objs.size ())
+      {
+      }
+
+      void run (int jobs)
+      {
+        std::vector < std::thread > threads;
+
+        for (int j = 0; j < jobs; ++j)
+          threads.push_back (std::thread (worker, this));
+        for (std::vector < std::thread >::iterator ti = threads.begin ();
+             ti != threads.end ();
+             ++ti)
+          (*ti).join ();
+
+        if (error)
+          std::rethrow_exception (error);
+      }
+
+    private:
+      static void worker (object_parser* parser)
+      {
+        parser->parse ();
+      }
+
+      void parse ()
+      {
+        while (!failed)
+        {
+          const size_t o = next++;
+          if (o >= objs.size ())
+            break;
+
+          object& obj = *objs[o];
+
+          try
+          {
+            archive* ar = obj.get_archive ();
+            if (ar && ar->is_open () && ar->mapped ())
+            {
+              obj.begin ();
+              obj.elf ().load_symbols ();
+              obj.end ();
+            }
+            else if (ar)
+            {
+              std::lock_guard < std::mutex > guard (archive_lock);
+              obj.open ();
+              obj.begin ();
+              obj.elf ().load_symbols ();
+              obj.end ();
+              obj.close ();
+            }
+            else
+            {
+              obj.open ();
+              obj.begin ();
+              obj.elf ().load_symbols ();
+              obj.end ();
+              obj.close ();
+            }
+          }
+          catch (...)
+          {
+            std::lock_guard < std::mutex > guard (error_lock);
+            if (o < error_index)
+            {
+              error = std::current_exception ();
+              error_index = o;
+            }
+            failed = true;
+          }
+        }
+      }
+
+      std::vector < object* >& objs;        //< The object files to parse.
+      std::atomic < size_t >   next;        //< The next object file to parse.
+      std::atomic < bool >     failed;      //< An object file failed.
+      std::mutex               archive_lock; //< Serialise shared archives.
+      std::mutex               error_lock;  //< Protect the error.
+      std::exception_ptr       error;       //< The first error.
+      size_t                   error_index; //< The object the error is from.
+    };
+
+    void
+    cache::parse_objects (int jobs)
+    {
+      std::vector < object* > objs;
+
+      for (objects::iterator oi = objects_.begin ();
+           oi != objects_.end ();
+           ++oi)
+        if (!(*oi).second->indexed ())
+          objs.push_back ((*oi).second);
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "cache:load-sym: jobs: " << jobs << std::endl;
+
+      object_parser parser (objs);
+      parser.run (jobs);
+    }
+
     void
     cache::load_symbols (rld::symbols::table& symbols, bool local)
     {
+      typedef std::map < std::string, symbol_index > symbol_indexes;
+      typedef std::map < std::string, object_list > archive_objects;
+
+      symbol_indexes  indexes;
+      archive_objects members;
+      size_t          indexed = 0;
+
       if (rld::verbose () >= RLD_VERBOSE_INFO)
         std::cout << "cache:load-sym: object files: " << objects_.size ()
                   << std::endl;
 
+      /*
+       * Load the symbols of the object files in archives from the archives'
+       * symbol indexes. Local symbols are not in the indexes.
+       */
+      if (!symbol_index_path.empty () && !local)
+      {
+        for (objects::iterator oi = objects_.begin ();
+             oi != objects_.end ();
+             ++oi)
+        {
+          object*  obj = (*oi).second;
+          archive* ar = obj->get_archive ();
+          if (ar && !obj->indexed ())
+            members[ar->path ()].push_back (obj);
+        }
+
+        for (archive_objects::iterator ai = members.begin ();
+             ai != members.end ();
+             ++ai)
+        {
+          archive*      ar = (*ai).second.front ()->get_archive ();
+          symbol_index& index = indexes[(*ai).first];
+
+          index.load (*ar, (*ai).second);
+
+          for (object_list::iterator oi = (*ai).second.begin ();
+               oi != (*ai).second.end ();
+               ++oi)
+            if (index.get (*(*oi)))
+              ++indexed;
+        }
+
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "cache:load-sym: indexed: " << indexed << std::endl;
+      }
+
+      const int jobs = load_jobs (jobs_, objects_.size () - indexed,
+                                  archives_.size ());
+
+      /*
+       * With more than one job the symbols are parsed first and loaded into
+       * the table below in object file order without a session.
+       */
+      if (jobs > 1)
+        parse_objects (jobs);
+
       for (objects::iterator oi = objects_.begin ();
            oi != objects_.end ();
            ++oi)
       {
         object* obj = (*oi).second;
-        obj->open ();
-        obj->begin ();
-        obj->load_symbols (symbols, local);
-        obj->end ();
-        obj->close ();
+        if ((jobs > 1) || obj->indexed ())
+          obj->load_symbols (symbols, local);
+        else
+        {
+          obj->open ();
+          obj->begin ();
+          obj->load_symbols (symbols, local);
+          obj->end ();
+          obj->close ();
+        }
       }
 
+      for (archive_objects::iterator ai = members.begin ();
+           ai != members.end ();
+           ++ai)
+        indexes[(*ai).first].save ((*ai).second);
+
       if (rld::verbose () >= RLD_VERBOSE_INFO)
         std::cout << "cache:load-sym: symbols: " << symbols.size ()
                   << std::endl;
     }
 
+    void
+    cache::set_jobs (int jobs)
+    {
+      jobs_ = jobs < 1 ? 1 : jobs;
+    }
+
     void
     cache::output_unresolved_symbols (std::ostream& out)
     {
@@ -326,6 +326,23 @@ namespace rld
        */
       virtual int fd () const;
 
+      /**
+       * The image of the file mapped into memory. A read-only image is mapped
+       * when opened if the host can map files and is read from memory rather
+       * than the file descriptor. Writable images are never mapped.
+       *
+       * @return const uint8_t* The start of the file in memory or 0 if the
+       *                        file is not mapped.
+       */
+      virtual const uint8_t* mapped () const;
+
+      /**
+       * The size of the image of the file mapped into memory.
+       *
+       * @return size_t The size of the mapped file.
+       */
+      virtual size_t mapped_size () const;
+
       /**
        * The ELF reference.
        *
@@ -376,9 +393,23 @@ namespace rld
 
     private:
 
+      /**
+       * Map the open file into memory. If the file cannot be mapped it is
+       * read using the file descriptor.
+       */
+      void map ();
+
+      /**
+       * Unmap the file from memory.
+       */
+      void unmap ();
+
       file      name_;       //< The name of the file.
       int       references_; //< The number of handles open.
       int       fd_;         //< The file descriptor of the archive.
+      uint8_t*  map_;        //< The file mapped into memory or 0.
+      size_t    map_size_;   //< The size of the mapped file.
+      off_t     position_;   //< The read position in the mapped file.
       elf::file elf_;        //< The libelf reference.
       int       symbol_refs; //< The number of symbols references made.
       bool      writable;    //< The image is writable.
@@ -542,7 +573,7 @@ namespace rld
       const uint32_t    type;      //< The type of relocation record.
       const uint32_t    info;      //< The ELF info field.
       const int32_t     addend;    //< The constant addend.
-      const std::string symname;   //< The name of the symbol.
+      const std::string& symname;  //< The interned name of the symbol.
       const uint32_t    symtype;   //< The type of symbol.
       const int         symsect;   //< The symbol's section symbol.
       const uint32_t    symvalue;  //< The symbol's value.
@@ -553,6 +584,19 @@ namespace rld
        */
       relocation (const elf::relocation& er);
 
+      /**
+       * Construct from the fields of a relocation record.
+       */
+      relocation (const uint32_t     offset,
+                  const uint32_t     type,
+                  const uint32_t     info,
+                  const int32_t      addend,
+                  const std::string& symname,
+                  const uint32_t     symtype,
+                  const int          symsect,
+                  const uint32_t     symvalue,
+                  const uint32_t     symbinding);
+
     private:
       /**
        * The default constructor is not allowed due to all elements being
@@ -573,7 +617,7 @@ namespace rld
      */
     struct section
     {
-      const std::string name;      //< The name of the section.
+      const std::string& name;     //< The interned name of the section.
       const int         index;     //< The section's index in the object file.
       const uint32_t    type;      //< The type of section.
       const size_t      size;      //< The size of the section.
@@ -689,6 +733,36 @@ namespace rld
        */
       void load_symbols (symbols::table& symbols, bool local = false);
 
+      /**
+       * Load the symbols from an archive's symbol index. The symbols are
+       * moved to the object file and are used when its symbols are loaded
+       * into the symbols table so the object file is not read. Local symbols
+       * are not held in the index.
+       *
+       * @param syms The global, weak and unresolved symbols of the object.
+       */
+      void load_index (symbols::bucket& syms);
+
+      /**
+       * Get the symbols an archive's symbol index holds for the object file,
+       * the global, weak and unresolved symbols.
+       *
+       * @param syms The symbols.
+       */
+      void get_index_symbols (symbols::pointers& syms);
+
+      /**
+       * Are the object file's symbols from an archive's symbol index ?
+       */
+      bool indexed () const;
+
+      /**
+       * Read the object file if it has not been read. The symbols of an
+       * object file from an archive's symbol index are loaded without reading
+       * it so read it before using its sections.
+       */
+      void load_sections ();
+
       /**
        * Load the relocations.
        */
@@ -709,6 +783,17 @@ namespace rld
        */
       virtual int fd () const;
 
+      /**
+       * The image of the file mapped into memory. An object in an archive is
+       * a view of the archive's image.
+       */
+      virtual const uint8_t* mapped () const;
+
+      /**
+       * The size of the image of the file mapped into memory.
+       */
+      virtual size_t mapped_size () const;
+
       /**
        * A symbol in the image has been referenced.
        */
@@ -790,11 +875,23 @@ namespace rld
       bool resolved () const;
 
     private:
+      /**
+       * Get the filtered symbols from the index symbols if indexed else the
+       * ELF file.
+       */
+      void get_symbols (symbols::pointers& syms,
+                        bool               unresolved,
+                        bool               local,
+                        bool               weak,
+                        bool               global);
+
       archive*          archive_;   //< Points to the archive if part of an
                                     //  archive.
       bool              valid_;     //< If true begin has run and finished.
       symbols::symtab   unresolved; //< This object's unresolved symbols.
       symbols::pointers externals;  //< This object's external symbols.
+      symbols::bucket   index_syms; //< The symbols from the symbol index.
+      bool              indexed_;   //< The symbols are from the index.
       sections          secs;       //< The sections.
       bool              resolving_; //< The object is being resolved.
       bool              resolved_;  //< The object has been resolved.
@@ -885,13 +982,29 @@ namespace rld
       void collect_object_files (const std::string& path);
 
       /**
-       * Load the symbols into the symbol table.
+       * Load the symbols into the symbol table. If more than one job is set
+       * the object files are read and their symbols parsed on a pool of
+       * threads and then added to the symbol table in the same order as a
+       * single job so the table is the same.
+       *
+       * If the symbol index is set the symbols of the object files in
+       * archives come from the archives' symbol indexes and the object files
+       * are not read. An archive's index is saved if it is missing or not
+       * current. The index is not used when loading local symbols.
        *
        * @param symbols The symbol table to load.
        * @param locals Include local symbols. The default does not include them.
        */
       void load_symbols (symbols::table& symbols, bool locals = false);
 
+      /**
+       * Set the number of jobs used to load symbols. The number of threads
+       * is limited by the number of files the process can open.
+       *
+       * @param jobs The number of jobs. The default is 1.
+       */
+      void set_jobs (int jobs);
+
       /**
        * Output the unresolved symbol table to the output stream.
        */
@@ -960,10 +1073,18 @@ namespace rld
       virtual void input (const std::string& path);
 
     private:
+      /**
+       * Read the object files and parse their symbols on a pool of threads.
+       *
+       * @param jobs The number of threads.
+       */
+      void parse_objects (int jobs);
+
       path::paths paths_;    //< The names of the files to process.
       archives    archives_; //< The archive files.
       objects     objects_;  //< The object files.
       bool        opened;    //< The cache is open.
+      int         jobs_;     //< The number of jobs to load symbols with.
     };
 
     /**
@@ -975,6 +1096,28 @@ namespace rld
      */
     void copy_file (image& in, image& out, size_t size = 0);
 
+    /**
+     * The FNV-1a hash of the bytes of an object file added to a hash. An
+     * object file in an archive is the member's bytes. The object file is
+     * opened and closed.
+     *
+     * @param obj The object file to hash.
+     * @param hash The hash to add the bytes to, rld::hash_basis to start.
+     * @return uint64_t The hash.
+     */
+    uint64_t hash_object (object& obj, uint64_t hash);
+
+    /**
+     * Set the path of the archive symbol indexes. An empty path disables the
+     * indexes.
+     */
+    void set_symbol_index (const std::string& path);
+
+    /**
+     * Get the path of the archive symbol indexes.
+     */
+    const std::string get_symbol_index ();
+
     /**
      * Find the libraries given the list of libraries as bare name which
      * have 'lib' and '.a' added.
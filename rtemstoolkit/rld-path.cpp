@@ -176,6 +176,19 @@ namespace rld
       return false;
     }
 
+    bool
+    make_directory (const std::string& path)
+    {
+      if (check_directory (path))
+        return true;
+#if _WIN32
+      ::mkdir (path.c_str ());
+#else
+      ::mkdir (path.c_str (), 0777);
+#endif
+      return check_directory (path);
+    }
+
     void
     find_file (std::string& path, const std::string& name, paths& search_paths)
     {
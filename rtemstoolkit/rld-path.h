@@ -126,6 +126,16 @@ namespace rld
      */
     bool check_directory (const std::string& path);
 
+    /**
+     * Create the directory if it is not present. The parent directory must
+     * exist.
+     *
+     * @param path The path of the directory.
+     * @retval false The path is not a directory and could not be created.
+     * @retval true The path is a directory.
+     */
+    bool make_directory (const std::string& path);
+
     /**
      * Find the file given a container of paths and file names.
      *
@@ -30,8 +30,10 @@
 #include <string.h>
 
 #include <algorithm>
+#include <fstream>
 #include <list>
 #include <iomanip>
+#include <map>
 
 #include <rld.h>
 #include <rld-compression.h>
@@ -52,6 +54,24 @@ namespace rld
      */
     std::string rpath;
 
+    /**
+     * The codec, the size of the compressed blocks and the number of threads
+     * compressing them.
+     */
+    std::string compression = "lz77";
+    size_t      block_size = 0;
+    int         jobs = 1;
+
+    /**
+     * Keep an incremental index with the output.
+     */
+    bool incremental = false;
+
+    /**
+     * Write compact relocation records.
+     */
+    bool compact_relocs = false;
+
     /**
      * The names of the RAP sections.
      */
@@ -267,6 +287,84 @@ namespace rld
      */
     typedef std::list < external > externals;
 
+    /**
+     * An incremental index entry. The relocation records and sizes of an
+     * object file's sections in the RAP image are kept by the section's index
+     * so the relocation records are not loaded again if the object file has
+     * not changed. The contents of the sections are always read from the
+     * object file.
+     */
+    struct index_entry
+    {
+      typedef std::map < int, files::relocations > relocations;
+      typedef std::map < int, uint32_t >           sizes;
+
+      std::string key;       //< The object file's size and hash.
+      relocations relocs;    //< The relocation records of the sections.
+      sizes       sec_sizes; //< The sizes of the sections.
+      bool        current;   //< The entry matches the object file.
+      bool        used;      //< The entry is used in the link.
+
+      /**
+       * Construct an empty entry.
+       */
+      index_entry ();
+
+      /**
+       * Is the entry current for the sections? All sections need to be held
+       * with the size in the object file.
+       */
+      bool holds (const files::sections& secs) const;
+
+      /**
+       * Restore the relocation records to the sections.
+       */
+      void restore (files::sections& secs) const;
+
+      /**
+       * Keep the relocation records and sizes of the sections.
+       */
+      void keep (const files::sections& secs);
+    };
+
+    /**
+     * The incremental index of a RAP file. It is kept next to the RAP file
+     * and has an entry for each object file in the last link. The layout,
+     * symbols and externals are created on each link because a change to one
+     * object file moves the ones after it.
+     */
+    class incremental_index
+    {
+    public:
+      /**
+       * Load the index for a RAP file. A missing or damaged index is empty.
+       */
+      incremental_index (const std::string& output);
+
+      /**
+       * Get the entry for an object file. The entry is reset if the object
+       * file has changed.
+       */
+      index_entry& get (files::object& obj);
+
+      /**
+       * Save the entries used in the link.
+       */
+      void save () const;
+
+    private:
+      typedef std::map < std::string, index_entry > entries;
+
+      std::string path;    //< The path of the index.
+      entries     ents;    //< The entries by object file name.
+      int         reused;  //< The number of current entries.
+
+      /**
+       * Load the index.
+       */
+      void load ();
+    };
+
     /**
      * The specific data for each object we need to collect to create the RAP
      * format file.
@@ -283,11 +381,13 @@ namespace rld
       files::sections symtab;         //< All exported symbols.
       files::sections strtab;         //< All exported strings.
       section         secs[rap_secs]; //< The sections of interest.
+      index_entry*    entry;          //< The incremental index entry.
 
       /**
-       * The constructor. Need to have an object file to create.
+       * The constructor. Need to have an object file to create. The
+       * relocation records are taken from a current incremental index entry.
        */
-      object (files::object& obj);
+      object (files::object& obj, index_entry* entry = 0);
 
       /**
        * The copy constructor.
@@ -320,6 +420,11 @@ namespace rld
        * No default constructor allowed.
        */
       object ();
+
+      /**
+       * Get the sections from the object file.
+       */
+      void get_sections ();
     };
 
     /**
@@ -344,10 +449,12 @@ namespace rld
        * @param app_objects The object files in the application.
        * @param init The initialisation entry point label.
        * @param fini The finish entry point label.
+       * @param index The incremental index, 0 if there is no index.
        */
       void layout (const files::object_list& app_objects,
                    const std::string&        init,
-                   const std::string&        fini);
+                   const std::string&        fini,
+                   incremental_index*        index = 0);
 
       /**
        * Collection the symbols from the object file.
@@ -379,12 +486,12 @@ namespace rld
        * alignment of the first section of the object when it is written.
        *
        * @param comp The compressor.
-       * @param obj The object file the sections are part of.
+       * @param obj The object the sections are part of.
        * @param secs The container of file sections to write.
        * @param offset The current offset in the RAP section.
        */
       void write (compress::compressor&  comp,
-                  files::object&         obj,
+                  object&                obj,
                   const files::sections& secs,
                   uint32_t&              offset);
 
@@ -424,8 +531,22 @@ namespace rld
        */
       std::size_t find_in_strtab (const std::string& symname);
 
+      /**
+       * Add a string to the string table and return its offset.
+       */
+      std::size_t add_to_strtab (const std::string& str);
+
     private:
 
+      /**
+       * The ends of the strings in the string table keyed by their last
+       * characters. A name can be the tail of a longer string so each string
+       * is held under each of its last characters up to the key size.
+       */
+      typedef std::map < std::string, std::vector < uint32_t > > strtab_ends;
+
+      static const size_t strtab_key_size = 8;
+
       objects     objs;                //< The RAP objects
       uint32_t    sec_size[rap_secs];  //< The sections of interest.
       uint32_t    sec_align[rap_secs]; //< The sections of interest.
@@ -433,6 +554,7 @@ namespace rld
       externals   externs;             //< The symbols in the image
       uint32_t    symtab_size;         //< The size of the symbols.
       std::string strtab;              //< The strings table.
+      strtab_ends strtab_index;        //< The index of the strings table.
       uint32_t    relocs_size;         //< The relocations size.
       uint32_t    init_off;            //< The strtab offset to the init label.
       uint32_t    fini_off;            //< The strtab offset to the fini label.
@@ -771,8 +893,9 @@ namespace rld
     {
     }
 
-    object::object (files::object& obj)
-      : obj (obj)
+    object::object (files::object& obj, index_entry* entry)
+      : obj (obj),
+        entry (entry)
     {
       /*
        * Set up the names of the sections.
@@ -781,33 +904,62 @@ namespace rld
         secs[s].name = section_names[s];
 
       /*
-       * Get the relocation records. Collect the various section types from the
-       * object file into the RAP sections. Merge those sections into the RAP
+       * Get the relocation records from a current incremental index entry or
+       * the object file. Collect the various section types from the object
+       * file into the RAP sections. Merge those sections into the RAP
        * sections.
        */
+      if (entry && entry->current)
+      {
+        get_sections ();
+        entry->current = (entry->holds (text) &&
+                          entry->holds (const_) &&
+                          entry->holds (ctor) &&
+                          entry->holds (dtor) &&
+                          entry->holds (data));
+      }
 
-      obj.open ();
-      try
+      if (entry && entry->current)
       {
-        obj.begin ();
-        obj.load_relocations ();
-        obj.end ();
+        entry->restore (text);
+        entry->restore (const_);
+        entry->restore (ctor);
+        entry->restore (dtor);
+        entry->restore (data);
       }
-      catch (...)
+      else
       {
+        if (entry)
+        {
+          entry->relocs.clear ();
+          entry->sec_sizes.clear ();
+        }
+
+        obj.open ();
+        try
+        {
+          obj.begin ();
+          obj.load_relocations ();
+          obj.end ();
+        }
+        catch (...)
+        {
+          obj.close ();
+          throw;
+        }
         obj.close ();
-        throw;
-      }
-      obj.close ();
 
-      obj.get_sections (text,   SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
-      obj.get_sections (const_, SHT_PROGBITS, SHF_ALLOC, SHF_WRITE | SHF_EXECINSTR);
-      obj.get_sections (ctor,   ".ctors");
-      obj.get_sections (dtor,   ".dtors");
-      obj.get_sections (data,   SHT_PROGBITS, SHF_ALLOC | SHF_WRITE);
-      obj.get_sections (bss,    SHT_NOBITS,   SHF_ALLOC | SHF_WRITE);
-      obj.get_sections (symtab, SHT_SYMTAB);
-      obj.get_sections (strtab, ".strtab");
+        get_sections ();
+
+        if (entry)
+        {
+          entry->keep (text);
+          entry->keep (const_);
+          entry->keep (ctor);
+          entry->keep (dtor);
+          entry->keep (data);
+        }
+      }
 
       std::for_each (text.begin (), text.end (),
                      section_merge (*this, secs[rap_text]));
@@ -832,12 +984,35 @@ namespace rld
         data (orig.data),
         bss (orig.bss),
         symtab (orig.symtab),
-        strtab (orig.strtab)
+        strtab (orig.strtab),
+        entry (orig.entry)
     {
       for (int s = 0; s < rap_secs; ++s)
         secs[s] = orig.secs[s];
     }
 
+    void
+    object::get_sections ()
+    {
+      text.clear ();
+      const_.clear ();
+      ctor.clear ();
+      dtor.clear ();
+      data.clear ();
+      bss.clear ();
+      symtab.clear ();
+      strtab.clear ();
+
+      obj.get_sections (text,   SHT_PROGBITS, SHF_ALLOC | SHF_EXECINSTR);
+      obj.get_sections (const_, SHT_PROGBITS, SHF_ALLOC, SHF_WRITE | SHF_EXECINSTR);
+      obj.get_sections (ctor,   ".ctors");
+      obj.get_sections (dtor,   ".dtors");
+      obj.get_sections (data,   SHT_PROGBITS, SHF_ALLOC | SHF_WRITE);
+      obj.get_sections (bss,    SHT_NOBITS,   SHF_ALLOC | SHF_WRITE);
+      obj.get_sections (symtab, SHT_SYMTAB);
+      obj.get_sections (strtab, ".strtab");
+    }
+
     sections
     object::find (const uint32_t index) const
     {
@@ -910,7 +1085,8 @@ namespace rld
     void
     image::layout (const files::object_list& app_objects,
                    const std::string&        init,
-                   const std::string&        fini)
+                   const std::string&        fini,
+                   incremental_index*        index)
     {
       clear ();
 
@@ -923,11 +1099,13 @@ namespace rld
       {
         files::object& app_obj = *(*aoi);
 
+        app_obj.load_sections ();
+
         if (!app_obj.valid ())
           throw rld::error ("Not valid: " + app_obj.name ().full (),
                             "rap::layout");
 
-        objs.push_back (object (app_obj));
+        objs.push_back (object (app_obj, index ? &index->get (app_obj) : 0));
       }
 
       for (objects::iterator oi = objs.begin (), poi = objs.begin ();
@@ -973,13 +1151,34 @@ namespace rld
           obj.output ();
       }
 
-      init_off = strtab.size () + 1;
-      strtab += '\0';
-      strtab += init;
+      init_off = add_to_strtab (init);
+      fini_off = add_to_strtab (fini);
 
-      fini_off = strtab.size () + 1;
-      strtab += '\0';
-      strtab += fini;
+      /*
+       * The compact relocation records reference the symbol names in the
+       * string table so add the names that are not exported.
+       */
+      if (compact_relocs)
+      {
+        for (objects::iterator oi = objs.begin (); oi != objs.end (); ++oi)
+        {
+          object& obj = *oi;
+          for (int s = 0; s < rap_secs; ++s)
+          {
+            const relocations& relocs = obj.secs[s].relocs;
+            for (relocations::const_iterator ri = relocs.begin ();
+                 ri != relocs.end ();
+                 ++ri)
+            {
+              const relocation& reloc = *ri;
+              if ((reloc.symtype != STT_SECTION) &&
+                  (reloc.symbinding != STB_LOCAL) &&
+                  (find_in_strtab (reloc.symname) == std::string::npos))
+                add_to_strtab (reloc.symname);
+            }
+          }
+        }
+      }
 
       if (rld::verbose () >= RLD_VERBOSE_INFO)
       {
@@ -1033,11 +1232,7 @@ namespace rld
             name = find_in_strtab (sym.name ());
 
             if (name == std::string::npos)
-            {
-              name = strtab.size () + 1;
-              strtab += '\0';
-              strtab += sym.name ();
-            }
+              name = add_to_strtab (sym.name ());
 
             /*
              * The symbol's value is the symbols value plus the offset of the
@@ -1177,19 +1372,19 @@ namespace rld
       switch (sec)
       {
         case rap_text:
-          img.write (comp, obj.obj, obj.text, offset);
+          img.write (comp, obj, obj.text, offset);
           break;
         case rap_const:
-          img.write (comp, obj.obj, obj.const_, offset);
+          img.write (comp, obj, obj.const_, offset);
           break;
         case rap_ctor:
-          img.write (comp, obj.obj, obj.ctor, offset);
+          img.write (comp, obj, obj.ctor, offset);
           break;
         case rap_dtor:
-          img.write (comp, obj.obj, obj.dtor, offset);
+          img.write (comp, obj, obj.dtor, offset);
           break;
         case rap_data:
-          img.write (comp, obj.obj, obj.data, offset);
+          img.write (comp, obj, obj.data, offset);
           break;
         default:
           break;
@@ -1218,20 +1413,21 @@ namespace rld
 
     void
     image::write (compress::compressor&  comp,
-                  files::object&         obj,
+                  object&                obj,
                   const files::sections& secs,
                   uint32_t&              offset)
     {
       uint32_t size = 0;
 
-      obj.open ();
+      obj.obj.open ();
 
       try
       {
-        obj.begin ();
+        obj.obj.begin ();
 
         if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
-          std::cout << "rap:write sections: " << obj.name ().full () << std::endl;
+          std::cout << "rap:write sections: " << obj.obj.name ().full ()
+                    << std::endl;
 
         for (files::sections::const_iterator si = secs.begin ();
              si != secs.end ();
@@ -1249,7 +1445,7 @@ namespace rld
               comp.write (&ee, 1);
           }
 
-          comp.write (obj, sec.offset, sec.size);
+          comp.write (obj.obj, sec.offset, sec.size);
 
           if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
             std::cout << " sec: " << sec.index << ' ' << sec.name
@@ -1266,15 +1462,15 @@ namespace rld
         if (rld::verbose () >= RLD_VERBOSE_FULL_DEBUG)
           std::cout << " total size=" << offset << std::endl;
 
-        obj.end ();
+        obj.obj.end ();
       }
       catch (...)
       {
-        obj.close ();
+        obj.obj.close ();
         throw;
       }
 
-      obj.close ();
+      obj.obj.close ();
     }
 
     void
@@ -1313,6 +1509,7 @@ namespace rld
         uint32_t count = get_relocations (s);
         uint32_t sr = 0;
         uint32_t header;
+        uint32_t last_offset = 0;
 
         if (rld::verbose () >= RLD_VERBOSE_TRACE)
           std::cout << "rap:relocation: section:" << section_names[s]
@@ -1433,10 +1630,30 @@ namespace rld
                         << std::endl;
             }
 
-            comp << info << offset;
+            if (compact_relocs)
+            {
+              /*
+               * The type and the string bits are moved to the bottom so the
+               * common records are short.
+               */
+              compress::write_varint (comp,
+                                      (((info >> 8) & 0x3fffff) << 10) |
+                                      ((info & 0xff) << 2) |
+                                      (info >> 30));
+              compress::write_varint (comp,
+                                      compress::zigzag_encode ((int32_t) (offset - last_offset)));
+              last_offset = offset;
+
+              if (write_addend)
+                compress::write_varint (comp, compress::zigzag_encode ((int32_t) addend));
+            }
+            else
+            {
+              comp << info << offset;
 
-            if (write_addend)
-              comp << addend;
+              if (write_addend)
+                comp << addend;
+            }
 
             if (write_symname)
               comp << reloc.symname;
@@ -1591,6 +1808,7 @@ namespace rld
       }
       symtab_size = 0;
       strtab.clear ();
+      strtab_index.clear ();
       relocs_size = 0;
       init_off = 0;
       fini_off = 0;
@@ -1608,39 +1826,431 @@ namespace rld
     std::size_t
     image::find_in_strtab (const std::string& symname)
     {
-      std::size_t pos = 0;
-      while (pos < strtab.size ())
+      /*
+       * The first string that ends with the name. The empty name matches the
+       * leading nul.
+       */
+      if (symname.empty ())
+        return strtab.empty () ? std::string::npos : 0;
+
+      size_t                      key_size = std::min (symname.size (),
+                                                       strtab_key_size);
+      strtab_ends::const_iterator sei =
+        strtab_index.find (symname.substr (symname.size () - key_size));
+
+      if (sei != strtab_index.end ())
       {
-        std::size_t off = strtab.find (symname, pos);
-        if (off == std::string::npos)
-          break;
-        if (::strlen (strtab.c_str () + off) == symname.size ())
-          return off;
-        pos = off + 1;
+        const std::vector < uint32_t >& ends = (*sei).second;
+        for (std::vector < uint32_t >::const_iterator ei = ends.begin ();
+             ei != ends.end ();
+             ++ei)
+        {
+          std::size_t off = *ei - symname.size ();
+          if ((*ei >= symname.size ()) &&
+              (strtab.compare (off, symname.size (), symname) == 0))
+            return off;
+        }
       }
+
       return std::string::npos;
     }
 
+    std::size_t
+    image::add_to_strtab (const std::string& str)
+    {
+      std::size_t offset = strtab.size () + 1;
+      strtab += '\0';
+      strtab += str;
+
+      const uint32_t end = strtab.size ();
+      for (size_t k = 1; (k <= str.size ()) && (k <= strtab_key_size); ++k)
+        strtab_index[str.substr (str.size () - k)].push_back (end);
+
+      return offset;
+    }
+
+    index_entry::index_entry ()
+      : current (false),
+        used (false)
+    {
+    }
+
+    bool
+    index_entry::holds (const files::sections& secs) const
+    {
+      for (files::sections::const_iterator si = secs.begin ();
+           si != secs.end ();
+           ++si)
+      {
+        const files::section& sec = *si;
+        sizes::const_iterator ssi = sec_sizes.find (sec.index);
+        if ((ssi == sec_sizes.end ()) ||
+            ((*ssi).second != sec.size) ||
+            (relocs.find (sec.index) == relocs.end ()))
+          return false;
+      }
+      return true;
+    }
+
+    void
+    index_entry::restore (files::sections& secs) const
+    {
+      for (files::sections::iterator si = secs.begin ();
+           si != secs.end ();
+           ++si)
+      {
+        files::section&           sec = *si;
+        const files::relocations& frelocs = (*relocs.find (sec.index)).second;
+        /*
+         * The relocation records cannot be assigned.
+         */
+        sec.relocs.clear ();
+        sec.relocs.insert (sec.relocs.end (), frelocs.begin (), frelocs.end ());
+      }
+    }
+
+    void
+    index_entry::keep (const files::sections& secs)
+    {
+      for (files::sections::const_iterator si = secs.begin ();
+           si != secs.end ();
+           ++si)
+      {
+        const files::section& sec = *si;
+        files::relocations&   frelocs = relocs[sec.index];
+        sec_sizes[sec.index] = sec.size;
+        frelocs.clear ();
+        frelocs.insert (frelocs.end (), sec.relocs.begin (), sec.relocs.end ());
+      }
+    }
+
+    /*
+     * The index is a magic line followed by the entries. The numbers are 32bit
+     * little endian values and the strings have a 32bit length.
+     */
+    static const char* index_magic = "rld-rap-index 3";
+
+    static void
+    index_put (std::ostream& out, uint32_t value)
+    {
+      char bytes[4] = { (char) value,
+                        (char) (value >> 8),
+                        (char) (value >> 16),
+                        (char) (value >> 24) };
+      out.write (bytes, sizeof (bytes));
+    }
+
+    static void
+    index_put (std::ostream& out, const std::string& str)
+    {
+      index_put (out, str.size ());
+      out.write (str.data (), str.size ());
+    }
+
+    /**
+     * Read the values from an index held in memory.
+     */
+    class index_reader
+    {
+    public:
+      index_reader (const std::string& data)
+        : data (data),
+          pos (0) {
+      }
+
+      bool get (uint32_t& value) {
+        if ((data.size () - pos) < 4)
+          return false;
+        const unsigned char* bytes = (const unsigned char*) data.data () + pos;
+        value = ((uint32_t) bytes[0]) |
+          (((uint32_t) bytes[1]) << 8) |
+          (((uint32_t) bytes[2]) << 16) |
+          (((uint32_t) bytes[3]) << 24);
+        pos += 4;
+        return true;
+      }
+
+      bool get (std::string& str) {
+        uint32_t size;
+        if (!get (size) || ((data.size () - pos) < size))
+          return false;
+        str.assign (data, pos, size);
+        pos += size;
+        return true;
+      }
+
+      bool get_line (std::string& line) {
+        size_t eol = data.find ('\n', pos);
+        if (eol == std::string::npos)
+          return false;
+        line.assign (data, pos, eol - pos);
+        pos = eol + 1;
+        return true;
+      }
+
+    private:
+      const std::string& data;
+      size_t             pos;
+    };
+
+    /**
+     * The key of an object file is the FNV-1a hash of its bytes. An object in
+     * an archive is also keyed by its offset and size. A file's time is not
+     * used because a rebuild within the same second would match it.
+     */
+    static std::string
+    index_key (files::object& obj)
+    {
+      const uint64_t hash = files::hash_object (obj, rld::hash_basis);
+      return rld::to_string (obj.name ().size ()) +
+        ' ' + rld::to_string (hash, std::hex) +
+        ' ' + rld::to_string (obj.name ().offset ());
+    }
+
+    incremental_index::incremental_index (const std::string& output)
+      : path (output + ".rapi"),
+        reused (0)
+    {
+      load ();
+    }
+
+    index_entry&
+    incremental_index::get (files::object& obj)
+    {
+      index_entry& entry = ents[obj.name ().full ()];
+      std::string  key = index_key (obj);
+      entry.current = !key.empty () && (entry.key == key);
+      if (!entry.current)
+      {
+        entry.key = key;
+        entry.relocs.clear ();
+        entry.sec_sizes.clear ();
+      }
+      else
+        ++reused;
+      entry.used = true;
+      return entry;
+    }
+
+    void
+    incremental_index::load ()
+    {
+      std::ifstream in (path.c_str (), std::ios_base::in | std::ios_base::binary);
+      if (!in.is_open ())
+        return;
+
+      std::string contents;
+      in.seekg (0, std::ios_base::end);
+      std::streamoff size = in.tellg ();
+      in.seekg (0, std::ios_base::beg);
+      if (size > 0)
+      {
+        contents.resize (size);
+        if (!in.read (&contents[0], size))
+          contents.clear ();
+      }
+      in.close ();
+
+      index_reader reader (contents);
+      std::string  line;
+      uint32_t    count = 0;
+      bool         ok = (reader.get_line (line) &&
+                         (line == index_magic) &&
+                         reader.get (count));
+
+      for (uint32_t e = 0; ok && (e < count); ++e)
+      {
+        std::string name;
+        uint32_t    secs = 0;
+
+        ok = reader.get (name);
+        if (!ok)
+          break;
+
+        index_entry& entry = ents[name];
+
+        ok = reader.get (entry.key) && reader.get (secs);
+
+        for (uint32_t s = 0; ok && (s < secs); ++s)
+        {
+          uint32_t sec_index = 0;
+          uint32_t relocs = 0;
+
+          ok = (reader.get (sec_index) &&
+                reader.get (entry.sec_sizes[sec_index]) &&
+                reader.get (relocs));
+
+          files::relocations& frelocs = entry.relocs[sec_index];
+
+          for (uint32_t r = 0; ok && (r < relocs); ++r)
+          {
+            uint32_t    offset = 0;
+            uint32_t    type = 0;
+            uint32_t    info = 0;
+            uint32_t    addend = 0;
+            std::string symname;
+            uint32_t    symtype = 0;
+            uint32_t    symsect = 0;
+            uint32_t    symvalue = 0;
+            uint32_t    symbinding = 0;
+
+            ok = (reader.get (offset) &&
+                  reader.get (type) &&
+                  reader.get (info) &&
+                  reader.get (addend) &&
+                  reader.get (symname) &&
+                  reader.get (symtype) &&
+                  reader.get (symsect) &&
+                  reader.get (symvalue) &&
+                  reader.get (symbinding));
+
+            if (ok)
+              frelocs.push_back (files::relocation (offset, type, info,
+                                                    (int32_t) addend,
+                                                    symname, symtype,
+                                                    (int) symsect,
+                                                    symvalue, symbinding));
+          }
+        }
+      }
+
+      if (!ok)
+      {
+        if (rld::verbose () >= RLD_VERBOSE_INFO)
+          std::cout << "rap: index: " << path << ": invalid, ignored" << std::endl;
+        ents.clear ();
+        return;
+      }
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "rap: index: " << path
+                  << ": objects: " << ents.size () << std::endl;
+    }
+
+    void
+    incremental_index::save () const
+    {
+      uint32_t count = 0;
+
+      for (entries::const_iterator ei = ents.begin (); ei != ents.end (); ++ei)
+        if ((*ei).second.used && !(*ei).second.key.empty ())
+          ++count;
+
+      /*
+       * A link that fails part way does not leave a damaged index.
+       */
+      rld::atomic_file file (path);
+      if (!file.is_open ())
+        return;
+
+      std::ostream& out = file.out ();
+
+      out << index_magic << std::endl;
+      index_put (out, count);
+
+      for (entries::const_iterator ei = ents.begin (); ei != ents.end (); ++ei)
+      {
+        const index_entry& entry = (*ei).second;
+
+        if (!entry.used || entry.key.empty ())
+          continue;
+
+        index_put (out, (*ei).first);
+        index_put (out, entry.key);
+        index_put (out, entry.sec_sizes.size ());
+
+        for (index_entry::sizes::const_iterator ssi = entry.sec_sizes.begin ();
+             ssi != entry.sec_sizes.end ();
+             ++ssi)
+        {
+          index_entry::relocations::const_iterator rsi =
+            entry.relocs.find ((*ssi).first);
+
+          index_put (out, (*ssi).first);
+          index_put (out, (*ssi).second);
+
+          if (rsi == entry.relocs.end ())
+          {
+            index_put (out, 0);
+            continue;
+          }
+
+          const files::relocations& frelocs = (*rsi).second;
+
+          index_put (out, frelocs.size ());
+
+          for (files::relocations::const_iterator ri = frelocs.begin ();
+               ri != frelocs.end ();
+               ++ri)
+          {
+            const files::relocation& freloc = *ri;
+            index_put (out, freloc.offset);
+            index_put (out, freloc.type);
+            index_put (out, freloc.info);
+            index_put (out, (uint32_t) freloc.addend);
+            index_put (out, freloc.symname);
+            index_put (out, freloc.symtype);
+            index_put (out, (uint32_t) freloc.symsect);
+            index_put (out, freloc.symvalue);
+            index_put (out, freloc.symbinding);
+          }
+        }
+      }
+
+      bool ok = file.commit ();
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "rap: index: " << path
+                  << ": objects: " << count
+                  << ", reused: " << reused
+                  << (ok ? "" : ": not saved") << std::endl;
+    }
+
     void
     write (files::image&             app,
            const std::string&        init,
            const std::string&        fini,
            const files::object_list& app_objects,
-           const symbols::table&     /* symbols */) /* Add back for incremental
-                                                     * linking */
+           const symbols::table&     /* symbols */)
     {
-      std::string header;
+      std::string            header;
+      bool                   compressing = compression != "none";
+      const compress::codec& coder =
+        compress::get_codec (compressing ? compression : "lz77");
+      size_t                 size = block_size;
 
-      header = "RAP,00000000,0002,LZ77,00000000\n";
+      if (size == 0)
+        size = coder.default_block_size ();
+
+      std::ostringstream version;
+
+      version << std::setfill ('0') << std::setw (4)
+              << (compact_relocs ? RAP_VERSION_COMPACT : RAP_VERSION);
+
+      header = "RAP,00000000," + version.str () + ',';
+      header += compressing ? coder.label () : "NONE";
+      header += ",00000000\n";
       app.write (header.c_str (), header.size ());
 
-      compress::compressor compressor (app, 2 * 1024);
+      compress::compressor compressor (app, size, true, compressing, &coder);
       image                rap;
 
-      rap.layout (app_objects, init, fini);
-      rap.write (compressor);
+      compressor.set_jobs (jobs);
 
-      compressor.flush ();
+      if (incremental)
+      {
+        incremental_index index (app.name ().full ());
+        rap.layout (app_objects, init, fini, &index);
+        rap.write (compressor);
+        compressor.flush ();
+        index.save ();
+      }
+      else
+      {
+        rap.layout (app_objects, init, fini);
+        rap.write (compressor);
+        compressor.flush ();
+      }
 
       std::ostringstream length;
 
@@ -41,6 +41,42 @@ namespace rld
       */
      extern std::string rpath;
 
+    /**
+     * The codec used to compress the image, 'none' stores the image.
+     */
+    extern std::string compression;
+
+    /**
+     * The size of the compressed blocks, 0 is the codec's default.
+     */
+    extern size_t block_size;
+
+    /**
+     * The number of threads compressing the blocks.
+     */
+    extern int jobs;
+
+    /**
+     * Keep an index of the object files next to the output and use it to
+     * avoid loading the relocation records of the object files that have not
+     * changed.
+     */
+    extern bool incremental;
+
+    /**
+     * Write the relocation records in the compact format.
+     */
+    extern bool compact_relocs;
+
+    /**
+     * The RAP format versions. The relocation records are compact in version
+     * 3. The offsets are the difference to the previous record's offset, the
+     * fields are variable length values and the symbol names are in the
+     * string table.
+     */
+    #define RAP_VERSION         (2)
+    #define RAP_VERSION_COMPACT (3)
+
     /**
      * The RAP relocation bit masks.
      */
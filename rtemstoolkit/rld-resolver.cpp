@@ -26,18 +26,152 @@
 #include "config.h"
 #endif
 
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <unordered_set>
 
 #include <sys/stat.h>
 
+#if HAVE_GETRUSAGE
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+
 #include <rld.h>
-#include <rld.h>
+#include <rld-resolver.h>
 
 namespace rld
 {
   namespace resolver
   {
+    /**
+     * An object file waiting to have its symbols resolved.
+     */
+    struct work
+    {
+      files::object* object; //< The object file.
+      int            depth;  //< The depth in the chain of references.
+
+      work (files::object* object, int depth)
+        : object (object),
+          depth (depth) {
+      }
+    };
+
+    /**
+     * The object files waiting to be resolved. It is a stack so the object
+     * files referenced by an object file are resolved before its siblings.
+     */
+    typedef std::vector < work > worklist;
+
+    /**
+     * The set of object files found and waiting or resolved.
+     */
+    typedef std::unordered_set < files::object* > object_set;
+
+    /**
+     * The state of a resolve.
+     */
+    struct context
+    {
+      files::object_list& dependents;   //< The dependent object files found.
+      files::cache&       cache;        //< The file cache.
+      symbols::table&     base_symbols; //< The base image symbols.
+      symbols::table&     symbols;      //< The object file and library symbols.
+      object_set          found;        //< The object files found.
+      worklist            pending;      //< The object files to resolve.
+      phase_stats*        phase;        //< The current phase if not 0.
+      size_t              lookups;      //< The finds when the phase started.
+      size_t              probes;       //< The probes when the phase started.
+
+      context (files::object_list& dependents,
+               files::cache&       cache,
+               symbols::table&     base_symbols,
+               symbols::table&     symbols)
+        : dependents (dependents),
+          cache (cache),
+          base_symbols (base_symbols),
+          symbols (symbols),
+          phase (0),
+          lookups (0),
+          probes (0) {
+      }
+    };
+
+    phase_stats::phase_stats (const std::string& name)
+      : name (name),
+        objects (0),
+        symbols (0),
+        base (0),
+        dependents (0),
+        depth (0),
+        lookups (0),
+        probes (0),
+        seconds (0),
+        peak_rss (0),
+        start (std::chrono::steady_clock::now ())
+    {
+    }
+
+    void
+    phase_stats::stop ()
+    {
+      std::chrono::duration < double > elapsed =
+        std::chrono::steady_clock::now () - start;
+      seconds = elapsed.count ();
+#if HAVE_GETRUSAGE
+      struct rusage usage;
+      if (::getrusage (RUSAGE_SELF, &usage) == 0)
+      {
+        /*
+         * MacOS reports the peak in bytes, the other hosts in KB.
+         */
+#if __APPLE__
+        peak_rss = usage.ru_maxrss / 1024;
+#else
+        peak_rss = usage.ru_maxrss;
+#endif
+      }
+#endif
+    }
+
+    /**
+     * Start a phase of the resolver.
+     */
+    static void
+    phase_start (context& ctx, stats* phases, const std::string& name)
+    {
+      if (phases)
+      {
+        phases->push_back (phase_stats (name));
+        ctx.phase = &phases->back ();
+        ctx.lookups = 0;
+        ctx.probes = 0;
+        ctx.base_symbols.lookup_stats (ctx.lookups, ctx.probes);
+        ctx.symbols.lookup_stats (ctx.lookups, ctx.probes);
+      }
+    }
+
+    /**
+     * Stop the current phase of the resolver.
+     */
+    static void
+    phase_stop (context& ctx)
+    {
+      if (ctx.phase)
+      {
+        size_t lookups = 0;
+        size_t probes = 0;
+        ctx.base_symbols.lookup_stats (lookups, probes);
+        ctx.symbols.lookup_stats (lookups, probes);
+        ctx.phase->lookups = lookups - ctx.lookups;
+        ctx.phase->probes = probes - ctx.probes;
+        ctx.phase->stop ();
+        ctx.phase = 0;
+      }
+    }
+
     static files::object*
     get_object (files::cache&      cache,
                 const std::string& fullname)
@@ -49,56 +183,29 @@ namespace rld
       return (*oi).second;
     }
 
+    /**
+     * Find each unresolved symbol in the symbol table pointing the unresolved
+     * symbol's object file to the file that resolves the symbol. Each object
+     * file found that is not resolved or waiting is added to the work list
+     * and the dependents. The 'urs' is the unresolved symbol and 'es' is the
+     * exported symbol.
+     */
     static void
-    resolve_symbols (files::object_list& dependents,
-                     files::cache&       cache,
-                     symbols::table&     base_symbols,
-                     symbols::table&     symbols,
-                     symbols::symtab&    unresolved,
-                     const std::string&  fullname)
+    resolve_symbols (context&           ctx,
+                     symbols::symtab&   unresolved,
+                     const std::string& name,
+                     int                depth)
     {
-      const std::string name = path::basename (fullname);
-
-      static int nesting = 0;
-
-      ++nesting;
-
-      /*
-       * Find each unresolved symbol in the symbol table pointing the
-       * unresolved symbol's object file to the file that resolves the
-       * symbol. Record each object file that is found and when all unresolved
-       * symbols in this object file have been found iterate over the found
-       * object files resolving them. The 'urs' is the unresolved symbol and
-       * 'es' is the exported symbol.
-       */
-
-      files::object* object = get_object (cache, fullname);
-
-      if (object)
-      {
-        if (object->resolved () || object->resolving ())
-        {
-          if (rld::verbose () >= RLD_VERBOSE_INFO)
-            std::cout << "resolver:resolving: "
-                      << std::setw (nesting - 1) << ' '
-                      << name
-                      << " is resolved or resolving"
-                      << std::endl;
-          return;
-        }
-        object->resolve_set ();
-      }
+      size_t referenced = 0;
 
       if (rld::verbose () >= RLD_VERBOSE_INFO)
         std::cout << "resolver:resolving: "
-                  << std::setw (nesting - 1) << ' '
+                  << std::setw (depth) << ' '
                   << name
                   << ", unresolved: "
                   << unresolved.size ()
                   << std::endl;
 
-      files::object_list objects;
-
       for (symbols::symtab::iterator ursi = unresolved.begin ();
            ursi != unresolved.end ();
            ++ursi)
@@ -108,22 +215,23 @@ namespace rld
         if ((urs.binding () != STB_WEAK) && urs.object ())
           continue;
 
-        symbols::symbol* es = base_symbols.find_global (urs.name ());
+        symbols::symbol* es = ctx.base_symbols.find_global (urs.name (),
+                                                            urs.hash ());
         bool             base = true;
 
         if (rld::verbose () >= RLD_VERBOSE_INFO)
         {
           std::cout << "resolver:resolve  : "
-                    << std::setw (nesting + 1) << ' '
+                    << std::setw (depth + 2) << ' '
                     << " |- " << urs.name () << std::endl;
         }
 
         if (!es)
         {
-          es = symbols.find_global (urs.name ());
+          es = ctx.symbols.find_global (urs.name (), urs.hash ());
           if (!es)
           {
-            es = symbols.find_weak (urs.name ());
+            es = ctx.symbols.find_weak (urs.name (), urs.hash ());
             if (!es)
               throw rld::error ("symbol not found: " + urs.name (), name);
           }
@@ -132,10 +240,17 @@ namespace rld
 
         symbols::symbol& esym = *es;
 
+        if (ctx.phase)
+        {
+          ++ctx.phase->symbols;
+          if (base)
+            ++ctx.phase->base;
+        }
+
         if (rld::verbose () >= RLD_VERBOSE_INFO)
         {
           std::cout << "resolver:resolved : "
-                    << std::setw (nesting + 1) << ' '
+                    << std::setw (depth + 2) << ' '
                     << " |   `--> ";
           if (esym.object())
           {
@@ -146,8 +261,10 @@ namespace rld
               std::cout << " (resolved)";
             else if (base)
               std::cout << " (base)";
+            else if (ctx.found.count (esym.object ()))
+              std::cout << " (waiting)";
             else
-              std::cout << " (unresolved: " << objects.size () + 1 << ')';
+              std::cout << " (unresolved: " << referenced + 1 << ')';
           }
           else
             std::cout << "null";
@@ -158,51 +275,102 @@ namespace rld
         {
           files::object& eobj = *esym.object ();
           urs.set_object (eobj);
-          if (!eobj.resolved () && !eobj.resolving ())
+          if (!eobj.resolved () && !eobj.resolving () &&
+              ctx.found.insert (&eobj).second)
           {
-            objects.push_back (&eobj);
-            objects.unique ();
+            ctx.pending.push_back (work (&eobj, depth + 1));
+            ctx.dependents.push_back (&eobj);
+            ++referenced;
           }
         }
 
         esym.referenced ();
       }
 
-      if (object)
+      if (ctx.phase)
       {
-        object->resolve_clear ();
-        object->resolved_set ();
+        ctx.phase->dependents += referenced;
+        if (referenced && (ctx.phase->depth < (size_t) (depth + 1)))
+          ctx.phase->depth = depth + 1;
       }
 
-      /*
-       * Recurse into any references object files.
-       */
-
       if (rld::verbose () >= RLD_VERBOSE_INFO)
         std::cout << "resolver:resolved : "
-                  << std::setw (nesting + 1) << ' '
-                  << " +-- referenced objects: " << objects.size ()
+                  << std::setw (depth + 2) << ' '
+                  << " +-- referenced objects: " << referenced
                   << std::endl;
+    }
 
-      for (files::object_list::iterator oli = objects.begin ();
-           oli != objects.end ();
-           ++oli)
+    /**
+     * Resolve an object file's symbols and then the object files it depends
+     * on until there are no more object files to resolve.
+     */
+    static void
+    resolve_object (context&           ctx,
+                    files::object*     object,
+                    symbols::symtab&   unresolved,
+                    std::string        fullname)
+    {
+      size_t waiting = ctx.pending.size ();
+      int    depth = 0;
+
+      while (true)
       {
-        files::object& obj = *(*oli);
+        const std::string name = path::basename (fullname);
+
+        if (object)
+        {
+          if (object->resolved () || object->resolving ())
+          {
+            if (rld::verbose () >= RLD_VERBOSE_INFO)
+              std::cout << "resolver:resolving: "
+                        << std::setw (depth) << ' '
+                        << name
+                        << " is resolved or resolving"
+                        << std::endl;
+          }
+          else
+          {
+            object->resolve_set ();
+
+            if (ctx.phase)
+              ++ctx.phase->objects;
+
+            /*
+             * Reverse the object files found so the first is resolved first.
+             */
+            size_t found = ctx.pending.size ();
+            resolve_symbols (ctx, object->unresolved_symbols (), name, depth);
+            std::reverse (ctx.pending.begin () + found, ctx.pending.end ());
+
+            object->resolve_clear ();
+            object->resolved_set ();
+          }
+        }
+        else
+        {
+          size_t found = ctx.pending.size ();
+          resolve_symbols (ctx, unresolved, name, depth);
+          std::reverse (ctx.pending.begin () + found, ctx.pending.end ());
+        }
+
+        if (ctx.pending.size () == waiting)
+          break;
+
+        work next = ctx.pending.back ();
+        ctx.pending.pop_back ();
+
+        object = next.object;
+        depth = next.depth;
+
         if (rld::verbose () >= RLD_VERBOSE_INFO)
           std::cout << "resolver:resolving: "
-                    << std::setw (nesting) << ' '
-                    << "] " << name << " ==> "
-                    << obj.name ().basename () << std::endl;
-        resolve_symbols (dependents, cache, base_symbols, symbols,
-                         obj.unresolved_symbols (),
-                         obj.name ().full ());
-      }
+                    << std::setw (depth) << ' '
+                    << "] ==> "
+                    << object->name ().basename () << std::endl;
 
-      --nesting;
-
-      dependents.merge (objects);
-      dependents.unique ();
+        fullname = object->name ().full ();
+      }
     }
 
     void
@@ -210,21 +378,30 @@ namespace rld
              files::cache&       cache,
              symbols::table&     base_symbols,
              symbols::table&     symbols,
-             symbols::symtab&    undefined)
+             symbols::symtab&    undefined,
+             stats*              phases)
     {
       files::object_list objects;
+      context            ctx (dependents, cache, base_symbols, symbols);
+
       cache.get_objects (objects);
 
       /*
        * First resolve any undefined symbols that are forced by the linker or
        * the user.
        */
-      resolver::resolve_symbols (dependents, cache, base_symbols, symbols,
-                                 undefined, "undefines");
+      phase_start (ctx, phases, "undefines");
+
+      resolve_object (ctx, get_object (cache, "undefines"), undefined,
+                      "undefines");
+
+      phase_stop (ctx);
 
       /*
        * Resolve the symbols in the object files.
        */
+      phase_start (ctx, phases, "objects");
+
       for (files::object_list::iterator oi = objects.begin ();
            oi != objects.end ();
            ++oi)
@@ -233,11 +410,12 @@ namespace rld
         if (rld::verbose () >= RLD_VERBOSE_INFO)
           std::cout << "resolver:resolving: top: "
                     << object.name ().basename () << std::endl;
-        resolver::resolve_symbols (dependents, cache, base_symbols, symbols,
-                                   object.unresolved_symbols (),
-                                   object.name ().full ());
+        resolve_object (ctx, &object, object.unresolved_symbols (),
+                        object.name ().full ());
       }
 
+      phase_stop (ctx);
+
       if (rld::verbose () >= RLD_VERBOSE_INFO)
       {
         std::cout << "resolver:resolving: dependents: "
@@ -253,6 +431,54 @@ namespace rld
         }
       }
     }
+
+    void
+    output (std::ostream& out, const stats& phases)
+    {
+      double total = 0;
+
+      out << "Link statistics:" << std::endl
+          << "  " << std::left << std::setw (10) << "phase" << std::right
+          << std::setw (9) << "objects"
+          << std::setw (10) << "symbols"
+          << std::setw (9) << "base"
+          << std::setw (11) << "dependents"
+          << std::setw (7) << "depth"
+          << std::setw (11) << "time(ms)"
+          << std::setw (10) << "rss(KB)"
+          << std::setw (10) << "lookups"
+          << std::setw (9) << "probes" << std::endl;
+
+      for (stats::const_iterator pi = phases.begin ();
+           pi != phases.end ();
+           ++pi)
+      {
+        const phase_stats& phase = *pi;
+        out << "  " << std::left << std::setw (10) << phase.name << std::right
+            << std::setw (9) << phase.objects
+            << std::setw (10) << phase.symbols
+            << std::setw (9) << phase.base
+            << std::setw (11) << phase.dependents
+            << std::setw (7) << phase.depth
+            << std::setw (11) << std::fixed << std::setprecision (3)
+            << phase.seconds * 1000.0
+            << std::setw (10) << phase.peak_rss
+            << std::setw (10) << phase.lookups
+            << std::setw (9) << phase.probes << std::endl;
+        total += phase.seconds;
+      }
+
+      out << "  " << std::left << std::setw (56) << "total" << std::right
+          << std::setw (11) << std::fixed << std::setprecision (3)
+          << total * 1000.0 << std::endl;
+      out.unsetf (std::ios_base::floatfield);
+
+      size_t strings = 0;
+      size_t chars = 0;
+      rld::interned (strings, chars);
+      out << "  interned strings: " << strings
+          << " (" << chars << " chars)" << std::endl;
+    }
   }
 
 }
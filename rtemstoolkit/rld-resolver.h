@@ -25,6 +25,9 @@
 #if !defined (_RLD_RESOLVER_H_)
 #define _RLD_RESOLVER_H_
 
+#include <chrono>
+#include <vector>
+
 #include <rld-files.h>
 #include <rld-symbols.h>
 
@@ -32,6 +35,42 @@ namespace rld
 {
   namespace resolver
   {
+    /**
+     * The statistics of a phase of a link. The counts a phase does not have
+     * are 0.
+     */
+    struct phase_stats
+    {
+      std::string name;       //< The name of the phase.
+      size_t      objects;    //< The number of object files.
+      size_t      symbols;    //< The number of symbols.
+      size_t      base;       //< The number of symbols found in the base image.
+      size_t      dependents; //< The number of dependent object files found.
+      size_t      depth;      //< The deepest chain of dependent object files.
+      size_t      lookups;    //< The number of symbol table finds.
+      size_t      probes;     //< The symbol table slots the finds probed.
+      double      seconds;    //< The wall time of the phase.
+      size_t      peak_rss;   //< The peak resident set size in KB, 0 if unknown.
+
+      /**
+       * Construct a phase and start timing it.
+       */
+      phase_stats (const std::string& name);
+
+      /**
+       * Stop timing the phase.
+       */
+      void stop ();
+
+    private:
+      std::chrono::steady_clock::time_point start; //< When the phase started.
+    };
+
+    /**
+     * The phases of a link.
+     */
+    typedef std::vector < phase_stats > stats;
+
     /**
      * Resolve the dependences between object files.
      *
@@ -42,12 +81,22 @@ namespace rld
      * @param symbols The object file and library symbols
      * @param undefined Extra undefined symbols dependent object files are
      *                  added for.
+     * @param phases If not 0 the resolver's phases are appended.
      */
     void resolve (files::object_list& dependents,
                   files::cache&       cache,
                   symbols::table&     base_symbols,
                   symbols::table&     symbols,
-                  symbols::symtab&    undefined);
+                  symbols::symtab&    undefined,
+                  stats*              phases = 0);
+
+    /**
+     * Output the statistics of the phases.
+     *
+     * @param out The stream to output to.
+     * @param phases The phases.
+     */
+    void output (std::ostream& out, const stats& phases);
   }
 }
 
@@ -24,6 +24,15 @@
  */
 
 
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <fstream>
+#include <map>
+#include <set>
+#include <sstream>
+
 #include <rld-size-of.h>
 #include <rld-cc.h>
 
@@ -31,33 +40,67 @@ namespace rld
 {
   namespace size_of
   {
+    /**
+     * The path of the type size database.
+     */
+    static std::string database;
+
+    /**
+     * A size in the database is held against the context it was found in and
+     * the type's name.
+     */
+    typedef std::pair < uint64_t, std::string > entry_key;
+
+    /**
+     * The sizes in the database.
+     */
+    typedef std::map < entry_key, size_t > entries;
+
     void
-    compile_wrapper (rld::process::tempfile& c,
-                     rld::process::tempfile& o)
+    set_database (const std::string& path)
     {
-      rld::process::arg_container args;
+      database = path;
+    }
 
-      if (rld::verbose ())
-      std::cout << "wrapper O file: " << o.name () << std::endl;
+    const std::string
+    get_database ()
+    {
+      return database;
+    }
 
+    /*
+     * The compiler command and flags used to probe the sizes.
+     */
+    static void
+    make_probe_command (rld::process::arg_container& args)
+    {
       rld::cc::make_cc_command (args);
       rld::cc::append_flags (rld::cc::ft_cflags, args);
 
       args.push_back ("-O2");
       args.push_back ("-g");
-      args.push_back ("-c");
-      args.push_back ("-o");
-      args.push_back (o.name ());
-      args.push_back (c.name ());
+    }
+
+    static void
+    compile_wrapper (rld::process::tempfile& c,
+                     rld::process::tempfile& o)
+    {
+      rld::process::arg_container args;
+
+      if (rld::verbose ())
+      std::cout << "wrapper O file: " << o.name () << std::endl;
+
+      make_probe_command (args);
 
       rld::process::tempfile out;
       rld::process::tempfile err;
       rld::process::status   status;
 
-      status = rld::process::execute (rld::cc::get_cc (),
-                                      args,
-                                      out.name (),
-                                      err.name ());
+      status = rld::cc::compile_object (args,
+                                        c.name (),
+                                        o.name (),
+                                        out.name (),
+                                        err.name ());
 
       if ((status.type != rld::process::status::normal) ||
           (status.code != 0))
@@ -67,114 +110,231 @@ namespace rld
       }
     }
 
-    std::string
-    format_string (std::string str)
+    /*
+     * The C keywords that can be part of a type's name. They do not change
+     * with the declarations in the prefix code.
+     */
+    static bool
+    is_keyword (const std::string& word)
     {
-      /*
-       * Remove whitespaces and operators from string.
-       */
-      str = rld::find_replace (str, " ", "_");
-      str = rld::find_replace (str, "*", "_pointer");
-      return str;
+      static const char* keywords[] =
+        {
+          "_Bool", "bool", "char", "const", "double", "enum", "float", "int",
+          "long", "short", "signed", "struct", "union", "unsigned", "void",
+          "volatile", 0
+        };
+      for (int k = 0; keywords[k] != 0; ++k)
+        if (word == keywords[k])
+          return true;
+      return false;
     }
 
-    int
-    read_stream_int32 (std::stringstream& binary_stream)
+    /*
+     * Add the identifiers in the code that are not keywords.
+     */
+    static void
+    get_identifiers (const std::string& code, std::set < std::string >& ids)
     {
-      char buffer[4];
-      int32_t temp = 1;
-      int32_t value = 0;
+      size_t c = 0;
+      while (c < code.size ())
+      {
+        if (::isalpha (code[c]) || (code[c] == '_'))
+        {
+          size_t start = c;
+          while ((c < code.size ()) && (::isalnum (code[c]) || (code[c] == '_')))
+            ++c;
+          std::string id = code.substr (start, c - start);
+          if (!is_keyword (id))
+            ids.insert (id);
+        }
+        else
+        {
+          ++c;
+        }
+      }
+    }
+
+    /*
+     * The context of a type. A type that names an identifier in the prefix
+     * code can change size when the prefix code changes so it is held against
+     * the hash of the prefix code. Any other type only depends on the target,
+     * the flags and the headers and can be shared by all trace
+     * configurations.
+     */
+    static uint64_t
+    get_context (const std::string&               name,
+                 const std::set < std::string >& prefix_ids,
+                 uint64_t                         prefix_hash)
+    {
+      std::set < std::string > ids;
+      get_identifiers (name, ids);
+      for (std::set < std::string >::const_iterator ii = ids.begin ();
+           ii != ids.end ();
+           ++ii)
+      {
+        if (prefix_ids.find (*ii) != prefix_ids.end ())
+          return prefix_hash;
+      }
+      return 0;
+    }
+
+    /*
+     * The database has a file for each key. The key is the compiler, the
+     * flags and the preprocessed headers.
+     */
+    static const char* database_magic = "rld-size-of 2";
+
+    static std::string
+    database_path (const std::string& key)
+    {
+      char        name[32];
+      std::string path;
+      ::snprintf (name, sizeof (name), "%016llx.sizes",
+                  (unsigned long long) rld::hash_bytes (key));
+      rld::path::path_join (database, name, path);
+      return path;
+    }
+
+    static void
+    load_database (const std::string& path,
+                   const std::string& key,
+                   entries&           sizes)
+    {
+      std::ifstream in (path.c_str (), std::ios_base::in | std::ios_base::binary);
+      if (!in.is_open ())
+        return;
+
+      std::string line;
+      size_t      key_size = 0;
 
-      binary_stream.read (buffer, 1);
+      if (!std::getline (in, line) || (line != database_magic))
+        return;
+      if (!std::getline (in, line))
+        return;
+      key_size = ::strtoul (line.c_str (), 0, 10);
+
+      std::string db_key (key_size, ' ');
+      if (key_size && !in.read (&db_key[0], key_size))
+        return;
+
+      /*
+       * The whole key is checked so a hash collision is not used.
+       */
+      if (db_key != key)
+        return;
 
-      binary_stream.read (buffer, 4);
-      for (int i = 0; i <= 3; i++)
+      while (std::getline (in, line))
       {
-        for (int j = 0; j <= 7; j++)
+        std::istringstream iss (line);
+        std::string        context;
+        size_t             size;
+        std::string        name;
+        if (iss >> context >> size)
         {
-          if (( buffer[i] & 1 << j ) != 0)
-              value = value + temp;
-          temp = temp * 2;
+          std::getline (iss, name);
+          name = rld::trim (name);
+          if (!name.empty ())
+            sizes[entry_key (::strtoull (context.c_str (), 0, 16), name)] = size;
         }
       }
-      binary_stream.read (buffer, 1);
-      return value;
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "size-of: database: " << path
+                  << ": sizes: " << sizes.size () << std::endl;
     }
 
-    std::string
-    read_stream_string (std::stringstream& binary_stream, unsigned int size)
+    static void
+    save_database (const std::string& path,
+                   const std::string& key,
+                   const entries&     sizes)
     {
-      char buffer[64] = "";
-      binary_stream.read (buffer, size);
-      if (!strcmp (buffer, ""))
+      rld::path::make_directory (database);
+
+      rld::atomic_file file (path);
+      if (!file.is_open ())
+        return;
+
+      std::ostream& out = file.out ();
+
+      out << database_magic << std::endl
+          << key.size () << std::endl
+          << key;
+
+      for (entries::const_iterator ei = sizes.begin ();
+           ei != sizes.end ();
+           ++ei)
       {
-        return "NIL";
+        char context[32];
+        ::snprintf (context, sizeof (context), "%016llx",
+                    (unsigned long long) (*ei).first.first);
+        out << context << ' ' << (*ei).second << ' '
+            << (*ei).first.second << std::endl;
       }
-      return buffer;
+
+      bool ok = file.commit ();
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "size-of: database: " << path
+                  << (ok ? ": saved" : ": not saved") << std::endl;
     }
 
-    void
-    get_sizeof (types& types_,
-                const std::string& prefix_code,
-                std::string headers)
+    /*
+     * Compile the types and read their sizes from the object file. The sizes
+     * are held in an array of packed records, a name and the size's 4 bytes
+     * least significant first, so the object can be read without knowing the
+     * target's alignment or byte order.
+     */
+    static void
+    probe_sizeof (types&             probe,
+                  const std::string& prefix_code,
+                  const std::string& headers)
     {
       std::stringstream sss;
-      std::stringstream binary_stream;
       files::sections   secs;
-      std::string       s1;
-      char              buf;
-      unsigned int      max_size = 0;
+      size_t            max_size = 0;
+      bool              found = false;
 
       rld::process::tempfile c (".c");
       rld::process::tempfile o (".o");
-      c.override ("tempcfile");
-      o.override ("tempofile");
-      c.keep ();
-      o.keep ();
       c.open (true);
 
       sss << headers << std::endl
           << prefix_code;
 
-      for (types::iterator ti = types_.begin ();
-           ti != types_.end ();
+      for (types::iterator ti = probe.begin ();
+           ti != probe.end ();
            ++ti)
       {
         max_size = (max_size > (*ti).get_name ().size ())? max_size: (*ti).get_name ().size ();
       }
 
-      sss << "struct type_map {"
-          << std::endl
-          << "  char name["
-          << max_size + 1
-          << "];"
-          << std::endl
-          << "  char tag_s;"
-          << std::endl
-          << "  int32_t len;"
-          << std::endl
-          << "  char tag_e;"
+      const size_t record_size = max_size + 1 + 4;
+
+      sss << "struct type_map {" << std::endl
+          << "  char name[" << max_size + 1 << "];" << std::endl
+          << "  unsigned char size[4];" << std::endl
+          << "};" << std::endl
           << std::endl
-          << "} __attribute__((packed));"
+          << "#define TYPE_MAP_SIZE(t) { sizeof(t) & 0xff, (sizeof(t) >> 8) & 0xff, \\" << std::endl
+          << "                           (sizeof(t) >> 16) & 0xff, (sizeof(t) >> 24) & 0xff }" << std::endl
           << std::endl
+          << "static const struct type_map __type_map[]"
+          << " __attribute__((used, section(\"__barectf_type_map\"))) = {"
           << std::endl;
 
-      for (types::const_iterator ti = types_.begin ();
-           ti != types_.end ();
+      for (types::const_iterator ti = probe.begin ();
+           ti != probe.end ();
            ++ti)
       {
-        type typ = *ti;
-        sss << "static struct type_map __type_map_"
-            << format_string (typ.get_name ())
-            << " __used __attribute__((section(\"__barectf_type_map\")))"
-            << " = {  .name = \"" << typ.get_name ()
-            << "\", .tag_s = '[',"
-            << "  .len = sizeof(" << typ.get_name () << "),"
-            << " .tag_e = ']',};"
-            << std::endl << std::endl;
+        const std::string& name = (*ti).get_name ();
+        sss << "  { \"" << name << "\", TYPE_MAP_SIZE(" << name << ") },"
+            << std::endl;
       }
 
+      sss << "};" << std::endl;
+
       c.write_line (sss.str ());
+      c.close ();
       compile_wrapper (c, o);
 
       rld::files::object obj (o.name ());
@@ -186,10 +346,6 @@ namespace rld
                           "init::image");
       obj.get_sections (secs);
 
-      /*
-       * Find ELF data section, convert it to binary-stream, read and record
-       * sizes from the stream.
-       */
       for (files::sections::iterator ii = secs.begin ();
            ii != secs.end ();
            ++ii)
@@ -197,34 +353,129 @@ namespace rld
         const files::section& fsec = *ii;
         if (fsec.name == "__barectf_type_map")
         {
-          rld::elf::section sect = obj.elf ().get_section (fsec.index);
+          rld::elf::section   sect = obj.elf ().get_section (fsec.index);
           rld::elf::elf_data* data = sect.data ();
+          const uint8_t*      map = (const uint8_t*) data->d_buf;
+
+          if (data->d_size < (probe.size () * record_size))
+            throw rld::error ("type map too small", "size-of");
 
-          for (unsigned int i=0; i < data->d_size; i++)
+          for (size_t t = 0; t < probe.size (); ++t)
           {
-            buf = ((char*) data->d_buf)[i];
-            binary_stream << buf;
+            const uint8_t* rec = map + (t * record_size);
+            const uint8_t* size = rec + max_size + 1;
+            if (probe[t].get_name () != (const char*) rec)
+              throw rld::error ("type map mismatch: " + probe[t].get_name (),
+                                "size-of");
+            probe[t].set_size (size[0] | (size[1] << 8) |
+                               (size[2] << 16) | (size[3] << 24));
           }
 
-          while ((s1 = read_stream_string (binary_stream, max_size + 1)) != "NIL")
+          found = true;
+          break;
+        }
+      }
+
+      obj.end ();
+      obj.close ();
+
+      if (!found)
+        throw rld::error ("no type map", "size-of");
+    }
+
+    void
+    get_sizeof (types& types_,
+                const std::string& prefix_code,
+                std::string headers)
+    {
+      entries                  sizes;
+      std::string              key;
+      std::string              path;
+      std::set < std::string > prefix_ids;
+      uint64_t                 prefix_hash = 0;
+      types                    probe;
+
+      if (!database.empty ())
+      {
+        rld::process::arg_container args;
+        make_probe_command (args);
+
+        /*
+         * The headers are preprocessed so a change to a file they include
+         * changes the key. The macros are kept as the prefix code can use
+         * them. The database is not used if this fails.
+         */
+        rld::process::arg_container pargs (args);
+        rld::process::tempfile      h (".c");
+        h.open (true);
+        h.write_line (headers);
+        h.close ();
+
+        pargs.push_back ("-dD");
+
+        std::string preprocessed;
+        if (rld::cc::preprocess (pargs, h.name (), preprocessed))
+        {
+          key = rld::cc::command_key (args) + "--\n" + preprocessed;
+          path = database_path (key);
+
+          load_database (path, key, sizes);
+
+          get_identifiers (prefix_code, prefix_ids);
+          prefix_hash = rld::hash_bytes (prefix_code);
+        }
+      }
+
+      /*
+       * Only probe the types not in the database.
+       */
+      for (types::iterator ti = types_.begin ();
+           ti != types_.end ();
+           ++ti)
+      {
+        type& typ = *ti;
+        if (!key.empty ())
+        {
+          entry_key ek (get_context (typ.get_name (), prefix_ids, prefix_hash),
+                        typ.get_name ());
+          entries::const_iterator ei = sizes.find (ek);
+          if (ei != sizes.end ())
           {
-            for (types::iterator ti = types_.begin ();
-                 ti != types_.end ();
-                 ++ti)
-            {
-              type ttype = *ti;
-              if (!strcmp (s1.c_str (), ttype.get_name ().c_str ()))
-              {
-                type temp (s1);
-                temp.set_size (read_stream_int32 (binary_stream));
-                types_.erase (ti);
-                types_.insert (ti, temp);
-              }
-            }
+            typ.set_size ((*ei).second);
+            continue;
           }
-          break;
         }
+        probe.push_back (typ);
+      }
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "size-of: types: " << types_.size ()
+                  << " probed: " << probe.size () << std::endl;
+
+      if (probe.empty ())
+        return;
+
+      probe_sizeof (probe, prefix_code, headers);
+
+      for (types::const_iterator pi = probe.begin ();
+           pi != probe.end ();
+           ++pi)
+      {
+        const type& ptyp = *pi;
+        for (types::iterator ti = types_.begin ();
+             ti != types_.end ();
+             ++ti)
+        {
+          if ((*ti).get_name () == ptyp.get_name ())
+            (*ti).set_size (ptyp.get_size ());
+        }
+        if (!key.empty ())
+          sizes[entry_key (get_context (ptyp.get_name (), prefix_ids, prefix_hash),
+                           ptyp.get_name ())] = ptyp.get_size ();
       }
+
+      if (!key.empty ())
+        save_database (path, key, sizes);
     }
 
   }
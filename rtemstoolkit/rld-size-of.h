@@ -105,6 +105,18 @@ namespace rld
      */
     typedef std::vector < type > types;
 
+    /**
+     * Set the path of the type size database. The sizes found are saved in
+     * the database and only types not in the database are compiled. An empty
+     * path disables the database.
+     */
+    void set_database (const std::string& path);
+
+    /**
+     * Get the path of the type size database.
+     */
+    const std::string get_database ();
+
     /**
      * Get the sizeof() of the container of types.
      */
@@ -24,7 +24,13 @@
 
 #include <string.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iomanip>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <rld.h>
 
@@ -35,38 +41,178 @@ namespace rld
   namespace symbols
   {
     /**
-     * Get the demangled name.
+     * The demangled names keyed by the name. A name that cannot be demangled
+     * has an empty demangled name. The values do not move when names are
+     * added so references to them stay valid.
      */
-    bool
-    is_cplusplus (const std::string& name)
+    typedef std::unordered_map < std::string, std::string > demangled_names;
+
+    static demangled_names demangled_cache;
+    static std::mutex      demangled_lock;
+
+    /**
+     * Call the demangler.
+     */
+    static std::string
+    call_demangler (const std::string& name)
     {
-      char* demangled_name = ::cplus_demangle (name.c_str (),
-                                               DMGL_ANSI | DMGL_PARAMS);
-      bool yes = false;
+      std::string demangled;
+      char*       demangled_name = ::cplus_demangle (name.c_str (),
+                                                     DMGL_ANSI | DMGL_PARAMS);
       if (demangled_name)
       {
-        yes = true;
+        demangled = demangled_name;
         ::free (demangled_name);
       }
-      return yes;
+      return demangled;
+    }
+
+    const std::string&
+    demangle (const std::string& name)
+    {
+      {
+        std::lock_guard < std::mutex > guard (demangled_lock);
+        demangled_names::const_iterator di = demangled_cache.find (name);
+        if (di != demangled_cache.end ())
+          return (*di).second;
+      }
+
+      /*
+       * Demangle without the lock held. If another thread demangles the same
+       * name first its result is kept, the results are the same.
+       */
+      std::string demangled = call_demangler (name);
+
+      std::lock_guard < std::mutex > guard (demangled_lock);
+      return (*demangled_cache.insert (std::make_pair (name,
+                                                       demangled)).first).second;
+    }
+
+    /**
+     * Demangle names on a pool of threads.
+     */
+    class demangler
+    {
+    public:
+      demangler (const std::vector < std::string >& names)
+        : names (names),
+          demangled (names.size ()),
+          next (0)
+      {
+      }
+
+      void run (int jobs)
+      {
+        std::vector < std::thread > threads;
+
+        for (int j = 0; j < jobs; ++j)
+          threads.push_back (std::thread (worker, this));
+        for (std::vector < std::thread >::iterator ti = threads.begin ();
+             ti != threads.end ();
+             ++ti)
+          (*ti).join ();
+
+        std::lock_guard < std::mutex > guard (demangled_lock);
+        for (size_t n = 0; n < names.size (); ++n)
+          demangled_cache.insert (std::make_pair (names[n], demangled[n]));
+      }
+
+    private:
+      static void worker (demangler* dm)
+      {
+        dm->demangle ();
+      }
+
+      void demangle ()
+      {
+        while (true)
+        {
+          const size_t n = next++;
+          if (n >= names.size ())
+            break;
+          demangled[n] = call_demangler (names[n]);
+        }
+      }
+
+      const std::vector < std::string >& names;     //< The names to demangle.
+      std::vector < std::string >        demangled; //< The demangled names.
+      std::atomic < size_t >             next;      //< The next name.
+    };
+
+    /**
+     * Collect the C++ names in a symtab not in the cache.
+     */
+    static void
+    demangle_collect (const symtab&                 symbols,
+                      std::vector < std::string >& names)
+    {
+      for (symtab::const_iterator si = symbols.begin ();
+           si != symbols.end ();
+           ++si)
+      {
+        const symbol& sym = *((*si).second);
+        if (sym.is_cplusplus () &&
+            (demangled_cache.find (sym.name ()) == demangled_cache.end ()))
+          names.push_back (sym.name ());
+      }
     }
 
     void
-    demangle_name (std::string& name, std::string& demangled)
+    demangle (const table& symbols, int jobs)
     {
-      char* demangled_name = ::cplus_demangle (name.c_str (),
-                                               DMGL_ANSI | DMGL_PARAMS);
-      if (demangled_name)
+      std::vector < std::string > names;
+
       {
-        demangled = demangled_name;
-        ::free (demangled_name);
+        std::lock_guard < std::mutex > guard (demangled_lock);
+        demangle_collect (symbols.globals (), names);
+        demangle_collect (symbols.weaks (), names);
+        demangle_collect (symbols.locals (), names);
       }
+
+      std::sort (names.begin (), names.end ());
+      names.erase (std::unique (names.begin (), names.end ()), names.end ());
+
+      if ((size_t) jobs > names.size ())
+        jobs = names.size ();
+
+      if (rld::verbose () >= RLD_VERBOSE_INFO)
+        std::cout << "symbols:demangle: names: " << names.size ()
+                  << " jobs: " << jobs << std::endl;
+
+      if (jobs > 0)
+      {
+        demangler dm (names);
+        dm.run (jobs);
+      }
+    }
+
+    bool
+    is_cplusplus (const std::string& name)
+    {
+      return !demangle (name).empty ();
+    }
+
+    void
+    demangle_name (std::string& name, std::string& demangled)
+    {
+      const std::string& demangled_name = demangle (name);
+      if (!demangled_name.empty ())
+        demangled = demangled_name;
+    }
+
+    size_t
+    hash_name (const std::string& name)
+    {
+      return (size_t) rld::hash_bytes (name);
     }
 
     symbol::symbol ()
       : index_ (-1),
+        name_ (&intern ("")),
+        hash_ (hash_name (*name_)),
         object_ (0),
-        references_ (0)
+        references_ (0),
+        demangles_ (false)
     {
       memset (&esym_, 0, sizeof (esym_));
     }
@@ -76,36 +222,38 @@ namespace rld
                     files::object&      object,
                     const elf::elf_sym& esym)
       : index_ (index),
-        name_ (name),
+        name_ (&intern (name)),
+        hash_ (hash_name (*name_)),
         object_ (&object),
         esym_ (esym),
-        references_ (0)
+        references_ (0),
+        demangles_ (true)
     {
       if (!object_)
         throw rld_error_at ("object pointer is 0");
-      if (is_cplusplus ())
-        demangle_name (name_, demangled_);
     }
 
     symbol::symbol (int                 index,
                     const std::string&  name,
                     const elf::elf_sym& esym)
       : index_ (index),
-        name_ (name),
+        name_ (&intern (name)),
+        hash_ (hash_name (*name_)),
         object_ (0),
         esym_ (esym),
-        references_ (0)
+        references_ (0),
+        demangles_ (true)
     {
-      if (is_cplusplus ())
-        demangle_name (name_, demangled_);
     }
 
     symbol::symbol (const std::string&  name,
                     const elf::elf_addr value)
       : index_ (-1),
-        name_ (name),
+        name_ (&intern (name)),
+        hash_ (hash_name (*name_)),
         object_ (0),
-        references_ (0)
+        references_ (0),
+        demangles_ (false)
     {
       memset (&esym_, 0, sizeof (esym_));
       esym_.st_value = value;
@@ -114,9 +262,11 @@ namespace rld
     symbol::symbol (const char*         name,
                     const elf::elf_addr value)
       : index_ (-1),
-        name_ (name),
+        name_ (&intern (name)),
+        hash_ (hash_name (*name_)),
         object_ (0),
-        references_ (0)
+        references_ (0),
+        demangles_ (false)
     {
       memset (&esym_, 0, sizeof (esym_));
       esym_.st_value = value;
@@ -131,19 +281,28 @@ namespace rld
     const std::string&
     symbol::name () const
     {
-      return name_;
+      return *name_;
+    }
+
+    size_t
+    symbol::hash () const
+    {
+      return hash_;
     }
 
     const std::string&
     symbol::demangled () const
     {
-      return demangled_;
+      static const std::string not_cplusplus;
+      if (!demangles_ || !is_cplusplus ())
+        return not_cplusplus;
+      return demangle (*name_);
     }
 
     bool
     symbol::is_cplusplus () const
     {
-      return (name_[0] == '_') && (name_[1] == 'Z');
+      return ((*name_)[0] == '_') && ((*name_)[1] == 'Z');
     }
 
     bool
@@ -223,7 +382,7 @@ namespace rld
     bool
     symbol::operator< (const symbol& rhs) const
     {
-      return name_ < rhs.name_;
+      return *name_ < *rhs.name_;
     }
 
     void
@@ -298,6 +457,119 @@ namespace rld
         out << "   (" << object ()->name ().basename () << ')';
     }
 
+    hashtab::hashtab ()
+      : count (0),
+        ordered_valid (true),
+        lookups (0),
+        probes (0)
+    {
+    }
+
+    void
+    hashtab::add (symbol& sym)
+    {
+      if ((count + 1) * 4 > slots.size () * 3)
+        grow ();
+
+      const size_t mask = slots.size () - 1;
+      size_t       s = sym.hash () & mask;
+
+      while (slots[s].sym)
+      {
+        if ((slots[s].hash == sym.hash ()) &&
+            (slots[s].sym->name () == sym.name ()))
+          break;
+        s = (s + 1) & mask;
+      }
+
+      if (!slots[s].sym)
+        ++count;
+
+      slots[s].hash = sym.hash ();
+      slots[s].sym = &sym;
+      ordered_valid = false;
+    }
+
+    symbol*
+    hashtab::find (const std::string& name, size_t hash) const
+    {
+      ++lookups;
+
+      if (count == 0)
+        return 0;
+
+      const size_t mask = slots.size () - 1;
+      size_t       s = hash & mask;
+
+      ++probes;
+
+      while (slots[s].sym)
+      {
+        if ((slots[s].hash == hash) && (slots[s].sym->name () == name))
+          return slots[s].sym;
+        s = (s + 1) & mask;
+        ++probes;
+      }
+
+      return 0;
+    }
+
+    size_t
+    hashtab::size () const
+    {
+      return count;
+    }
+
+    const symtab&
+    hashtab::ordered () const
+    {
+      if (!ordered_valid)
+      {
+        ordered_.clear ();
+        for (std::vector < slot >::const_iterator si = slots.begin ();
+             si != slots.end ();
+             ++si)
+        {
+          if ((*si).sym)
+            ordered_[(*si).sym->name ()] = (*si).sym;
+        }
+        ordered_valid = true;
+      }
+      return ordered_;
+    }
+
+    void
+    hashtab::lookup_stats (size_t& lookups_, size_t& probes_) const
+    {
+      lookups_ += lookups;
+      probes_ += probes;
+    }
+
+    void
+    hashtab::grow ()
+    {
+      std::vector < slot > old;
+      slot                 empty = { 0, 0 };
+
+      old.swap (slots);
+      slots.resize (old.empty () ? 64 : old.size () * 2, empty);
+
+      const size_t mask = slots.size () - 1;
+
+      for (std::vector < slot >::const_iterator si = old.begin ();
+           si != old.end ();
+           ++si)
+      {
+        if ((*si).sym)
+        {
+          size_t s = (*si).hash & mask;
+          while (slots[s].sym)
+            s = (s + 1) & mask;
+          slots[s] = *si;
+        }
+      }
+    }
+
     table::table ()
     {
     }
@@ -309,46 +581,55 @@ namespace rld
     void
     table::add_global (symbol& sym)
     {
-      globals_[sym.name ()] = &sym;
+      globals_.add (sym);
     }
 
     void
     table::add_weak (symbol& sym)
     {
-      weaks_[sym.name ()] = &sym;
+      weaks_.add (sym);
     }
 
     void
     table::add_local (symbol& sym)
     {
-      locals_[sym.name ()] = &sym;
+      locals_.add (sym);
     }
 
     symbol*
     table::find_global (const std::string& name)
     {
-      symtab::iterator sti = globals_.find (name);
-      if (sti == globals_.end ())
-        return 0;
-      return (*sti).second;
+      return globals_.find (name, hash_name (name));
+    }
+
+    symbol*
+    table::find_global (const std::string& name, size_t hash)
+    {
+      return globals_.find (name, hash);
     }
 
     symbol*
     table::find_weak (const std::string& name)
     {
-      symtab::iterator sti = weaks_.find (name);
-      if (sti == weaks_.end ())
-        return 0;
-      return (*sti).second;
+      return weaks_.find (name, hash_name (name));
+    }
+
+    symbol*
+    table::find_weak (const std::string& name, size_t hash)
+    {
+      return weaks_.find (name, hash);
     }
 
     symbol*
     table::find_local (const std::string& name)
     {
-      symtab::iterator sti = locals_.find (name);
-      if (sti == locals_.end ())
-        return 0;
-      return (*sti).second;
+      return locals_.find (name, hash_name (name));
+    }
+
+    symbol*
+    table::find_local (const std::string& name, size_t hash)
+    {
+      return locals_.find (name, hash);
     }
 
     size_t
@@ -357,29 +638,38 @@ namespace rld
       return globals_.size () + weaks_.size () + locals_.size ();
     }
 
+    void
+    table::lookup_stats (size_t& lookups, size_t& probes) const
+    {
+      globals_.lookup_stats (lookups, probes);
+      weaks_.lookup_stats (lookups, probes);
+      locals_.lookup_stats (lookups, probes);
+    }
+
     const symtab&
     table::globals () const
     {
-      return globals_;
+      return globals_.ordered ();
     }
 
     const symtab&
     table::weaks () const
     {
-      return weaks_;
+      return weaks_.ordered ();
     }
 
     const symtab&
     table::locals () const
     {
-      return locals_;
+      return locals_.ordered ();
     }
 
     void
     table::globals (addrtab& addresses)
     {
-      for (symtab::iterator gi = globals_.begin ();
-           gi != globals_.end ();
+      const symtab& globals = globals_.ordered ();
+      for (symtab::const_iterator gi = globals.begin ();
+           gi != globals.end ();
            ++gi)
       {
         symbol& sym = *((*gi).second);
@@ -390,8 +680,9 @@ namespace rld
     void
     table::weaks (addrtab& addresses)
     {
-      for (symtab::iterator wi = weaks_.begin ();
-           wi != weaks_.end ();
+      const symtab& weaks = weaks_.ordered ();
+      for (symtab::const_iterator wi = weaks.begin ();
+           wi != weaks.end ();
            ++wi)
       {
         symbol& sym = *((*wi).second);
@@ -402,8 +693,9 @@ namespace rld
     void
     table::locals (addrtab& addresses)
     {
-      for (symtab::iterator li = locals_.begin ();
-           li != locals_.end ();
+      const symtab& locals = locals_.ordered ();
+      for (symtab::const_iterator li = locals.begin ();
+           li != locals.end ();
            ++li)
       {
         symbol& sym = *((*li).second);
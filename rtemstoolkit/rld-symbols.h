@@ -26,9 +26,9 @@
 #define _RLD_SYMBOLS_H_
 
 #include <iostream>
-#include <list>
 #include <map>
 #include <string>
+#include <vector>
 
 #include <rld-elf-types.h>
 
@@ -45,11 +45,20 @@ namespace rld
   namespace symbols
   {
     /**
-     * C++ demangler.
+     * C++ demangler. The demangled names are held in a cache shared by all
+     * threads so a name is only demangled once. The demangled name is empty
+     * if the name cannot be demangled.
      */
+    const std::string& demangle (const std::string& name);
     bool is_cplusplus (const std::string& name);
     void demangle_name (std::string& name, std::string& demangled);
 
+    /**
+     * Hash a symbol name. The hash is computed once for each symbol and held
+     * with it.
+     */
+    size_t hash_name (const std::string& name);
+
     /**
      * Use a local type for the address.
      */
@@ -102,7 +111,13 @@ namespace rld
       const std::string& name () const;
 
       /**
-       * The symbol's demangled name.
+       * The hash of the symbol's name.
+       */
+      size_t hash () const;
+
+      /**
+       * The symbol's demangled name. The name is demangled when first asked
+       * for.
        */
       const std::string& demangled () const;
 
@@ -191,23 +206,27 @@ namespace rld
 
     private:
 
-      int            index_;      //< The symbol's index in the ELF file.
-      std::string    name_;       //< The name of the symbol.
-      std::string    demangled_;  //< If a C++ symbol the demangled name.
-      files::object* object_;     //< The object file containing the symbol.
-      elf::elf_sym   esym_;       //< The ELF symbol.
-      int            references_; //< The number of times if it referenced.
+      int                index_;      //< The symbol's index in the ELF file.
+      const std::string* name_;       //< The interned name of the symbol.
+      size_t             hash_;       //< The hash of the name.
+      files::object*     object_;     //< The object file containing the symbol.
+      elf::elf_sym       esym_;       //< The ELF symbol.
+      int                references_; //< The number of times if it referenced.
+      bool               demangles_;  //< The name is demangled, linker
+                                      //  symbols are not.
     };
 
     /**
-     * Container of symbols. A bucket of symbols.
+     * Container of symbols. A bucket of symbols. The symbols are held in one
+     * block so a bucket must be reserved before references to its symbols are
+     * taken and not added to after.
      */
-    typedef std::list < symbol > bucket;
+    typedef std::vector < symbol > bucket;
 
     /**
      * References to symbols. Should always point to symbols held in a bucket.
      */
-    typedef std::list < symbol* > pointers;
+    typedef std::vector < symbol* > pointers;
 
     /**
      * A symbols table is a map container of symbols. Should always point to
@@ -221,6 +240,71 @@ namespace rld
      */
     typedef std::map < address, symbol* > addrtab;
 
+    /**
+     * A hash table of symbols indexed by name. Should always point to symbols
+     * held in a bucket. The table holds the symbol and the hash of its name
+     * and does not copy the name so a lookup is a hash probe that only
+     * compares names when the hashes match. Adding a symbol with the name of a
+     * symbol in the table replaces it. The symbols ordered by name are
+     * available as a symtab which is built when first asked for.
+     */
+    class hashtab
+    {
+    public:
+      /**
+       * Construct a hash table.
+       */
+      hashtab ();
+
+      /**
+       * Add a symbol.
+       */
+      void add (symbol& sym);
+
+      /**
+       * Find a symbol by name given the hash of the name.
+       */
+      symbol* find (const std::string& name, size_t hash) const;
+
+      /**
+       * The number of symbols in the table.
+       */
+      size_t size () const;
+
+      /**
+       * The symbols in the table ordered by name.
+       */
+      const symtab& ordered () const;
+
+      /**
+       * Add the number of finds and the slots they probed to the counts.
+       */
+      void lookup_stats (size_t& lookups, size_t& probes) const;
+
+    private:
+
+      /**
+       * A slot in the table. A slot with no symbol is empty.
+       */
+      struct slot
+      {
+        size_t  hash; //< The hash of the symbol's name.
+        symbol* sym;  //< The symbol.
+      };
+
+      /**
+       * Grow the table rehashing the symbols.
+       */
+      void grow ();
+
+      std::vector < slot > slots;         //< The slots, a power of 2 in size.
+      size_t               count;         //< The number of symbols.
+      mutable symtab       ordered_;      //< The symbols ordered by name.
+      mutable bool         ordered_valid; //< The ordered symbols are current.
+      mutable size_t       lookups;       //< The number of finds.
+      mutable size_t       probes;        //< The slots the finds probed.
+    };
+
     /**
      * A symbols contains a symbol table of global, weak and local symbols.
      */
@@ -257,21 +341,42 @@ namespace rld
        */
       symbol* find_global (const std::string& name);
 
+      /**
+       * Find a global symbol given the hash of the name.
+       */
+      symbol* find_global (const std::string& name, size_t hash);
+
       /**
        * Find an weak symbol.
        */
       symbol* find_weak (const std::string& name);
 
+      /**
+       * Find an weak symbol given the hash of the name.
+       */
+      symbol* find_weak (const std::string& name, size_t hash);
+
       /**
        * Find an local symbol.
        */
       symbol* find_local (const std::string& name);
 
+      /**
+       * Find an local symbol given the hash of the name.
+       */
+      symbol* find_local (const std::string& name, size_t hash);
+
       /**
        * Return the size of the symbols loaded.
        */
       size_t size () const;
 
+      /**
+       * Add the number of finds and the slots they probed in the global, weak
+       * and local symbols to the counts.
+       */
+      void lookup_stats (size_t& lookups, size_t& probes) const;
+
       /**
        * Return the globals symbol table.
        */
@@ -312,17 +417,17 @@ namespace rld
       /**
        * A table of global symbols.
        */
-      symtab globals_;
+      hashtab globals_;
 
       /**
        * A table of weak symbols.
        */
-      symtab weaks_;
+      hashtab weaks_;
 
       /**
        * A table of local symbols.
        */
-      symtab locals_;
+      hashtab locals_;
     };
 
     /**
@@ -340,6 +445,16 @@ namespace rld
      */
     size_t referenced (pointers& symbols);
 
+    /**
+     * Demangle the C++ names of the symbols in the table on a pool of threads
+     * and hold them in the demangler's cache. Call before outputting a large
+     * table.
+     *
+     * @param symbols The symbol table.
+     * @param jobs The number of threads.
+     */
+    void demangle (const table& symbols, int jobs);
+
     /**
      * Output the symbol table.
      */
@@ -26,9 +26,14 @@
 #include "config.h"
 #endif
 
+#include <deque>
 #include <iostream>
+#include <mutex>
+#include <vector>
 
+#include <string.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 #include <rld.h>
 
@@ -81,6 +86,200 @@ namespace rld
    */
   static uint64_t _version_revision;
 
+  /**
+   * The pool of interned strings. The strings are held in blocks so they do
+   * not move once added. The table is open addressed and holds the hash of
+   * each string so a look up only compares the characters when the hashes
+   * match.
+   */
+  class string_pool
+  {
+  public:
+    string_pool ()
+      : slots (1024),
+        count (0),
+        chars (0) {
+    }
+
+    const std::string& intern (const char* str, size_t len) {
+      size_t hash = (size_t) hash_bytes (str, len);
+
+      std::lock_guard < std::mutex > guard (lock);
+
+      size_t mask = slots.size () - 1;
+      size_t s = hash & mask;
+      while (slots[s].str)
+      {
+        const std::string& istr = *slots[s].str;
+        if ((slots[s].hash == hash) && (istr.size () == len) &&
+            (::memcmp (istr.data (), str, len) == 0))
+          return istr;
+        s = (s + 1) & mask;
+      }
+
+      strings.push_back (std::string (str, len));
+      slots[s].hash = hash;
+      slots[s].str = &strings.back ();
+      ++count;
+      chars += len;
+
+      if ((count * 4) > (slots.size () * 3))
+        grow ();
+
+      return strings.back ();
+    }
+
+    void interned (size_t& count_, size_t& chars_) {
+      std::lock_guard < std::mutex > guard (lock);
+      count_ = count;
+      chars_ = chars;
+    }
+
+  private:
+    struct slot
+    {
+      size_t             hash;  //< The hash of the string.
+      const std::string* str;   //< The string, 0 if empty.
+    };
+
+    void grow () {
+      std::vector < slot > old;
+      old.swap (slots);
+      slot empty = { 0, 0 };
+      slots.resize (old.size () * 2, empty);
+      size_t mask = slots.size () - 1;
+      for (std::vector < slot >::const_iterator si = old.begin ();
+           si != old.end ();
+           ++si)
+      {
+        if ((*si).str)
+        {
+          size_t s = (*si).hash & mask;
+          while (slots[s].str)
+            s = (s + 1) & mask;
+          slots[s] = *si;
+        }
+      }
+    }
+
+    std::deque < std::string > strings; //< The strings.
+    std::vector < slot >       slots;   //< The table, a power of 2 in size.
+    size_t                     count;   //< The number of strings.
+    size_t                     chars;   //< The characters in the strings.
+    std::mutex                 lock;    //< Protect the pool.
+  };
+
+  /**
+   * The pool is created when first used so it exists before any static
+   * object that interns a string.
+   */
+  static string_pool&
+  pool ()
+  {
+    static string_pool* strings = new string_pool;
+    return *strings;
+  }
+
+  const std::string&
+  intern (const char* str, size_t len)
+  {
+    return pool ().intern (str, len);
+  }
+
+  const std::string&
+  intern (const char* str)
+  {
+    return pool ().intern (str, ::strlen (str));
+  }
+
+  const std::string&
+  intern (const std::string& str)
+  {
+    return pool ().intern (str.data (), str.size ());
+  }
+
+  void
+  interned (size_t& count, size_t& chars)
+  {
+    pool ().interned (count, chars);
+  }
+
+  uint64_t
+  hash_bytes (const void* data, size_t size, uint64_t hash)
+  {
+    const uint8_t* bytes = static_cast < const uint8_t* > (data);
+    for (size_t b = 0; b < size; ++b)
+    {
+      hash ^= bytes[b];
+      hash *= 0x100000001b3ULL;
+    }
+    return hash;
+  }
+
+  uint64_t
+  hash_bytes (const std::string& str, uint64_t hash)
+  {
+    return hash_bytes (str.data (), str.size (), hash);
+  }
+
+  atomic_file::atomic_file (const std::string& path)
+    : path (path),
+      temp (path + ".tmp." + to_string (::getpid ())),
+      out_ (temp.c_str (),
+            std::ios_base::out | std::ios_base::binary | std::ios_base::trunc),
+      committed (false)
+  {
+  }
+
+  atomic_file::~atomic_file ()
+  {
+    if (!committed)
+    {
+      if (out_.is_open ())
+        out_.close ();
+      ::unlink (temp.c_str ());
+    }
+  }
+
+  bool
+  atomic_file::is_open () const
+  {
+    return out_.is_open ();
+  }
+
+  std::ostream&
+  atomic_file::out ()
+  {
+    return out_;
+  }
+
+  bool
+  atomic_file::commit ()
+  {
+    if (!out_.is_open ())
+      return false;
+    out_.close ();
+    if (out_.fail ())
+      return false;
+#if _WIN32
+    ::unlink (path.c_str ());
+#endif
+    if (::rename (temp.c_str (), path.c_str ()) < 0)
+      return false;
+    committed = true;
+    return true;
+  }
+
+  bool
+  write_file_atomically (const std::string& path, const std::string& contents)
+  {
+    atomic_file file (path);
+    if (!file.is_open ())
+      return false;
+    file.out ().write (contents.data (), contents.size ());
+    return file.commit ();
+  }
+
   bool
   starts_with(const std::string& s1, const std::string& s2)
   {
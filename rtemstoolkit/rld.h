@@ -27,6 +27,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <fstream>
 #include <functional>
 #include <iostream>
 #include <list>
@@ -181,6 +182,79 @@ namespace rld
    */
   const std::string tolower (const std::string& sin);
 
+  /**
+   * Intern a string. Equal strings share a single copy that is held for the
+   * life of the process so a name can be held as a reference to it. The
+   * characters are not copied to look a string up. Safe to call from any
+   * thread.
+   */
+  const std::string& intern (const char* str, size_t len);
+  const std::string& intern (const char* str);
+  const std::string& intern (const std::string& str);
+
+  /**
+   * The number of interned strings and the number of characters they hold.
+   */
+  void interned (size_t& count, size_t& chars);
+
+  /**
+   * The FNV-1a hash of some bytes added to a hash. Start with hash_basis. The
+   * hash is stable between runs and hosts so it can name and check files.
+   */
+  const uint64_t hash_basis = 0xcbf29ce484222325ULL;
+  uint64_t hash_bytes (const void* data,
+                       size_t      size,
+                       uint64_t    hash = hash_basis);
+  uint64_t hash_bytes (const std::string& str, uint64_t hash = hash_basis);
+
+  /**
+   * A file written under a temporary name and renamed to its path when
+   * committed so another process never reads part of it. The temporary file
+   * is removed if the file is not committed.
+   */
+  class atomic_file
+  {
+  public:
+    /**
+     * Create the temporary file for the path.
+     */
+    atomic_file (const std::string& path);
+
+    /**
+     * Remove the temporary file if not committed.
+     */
+    ~atomic_file ();
+
+    /**
+     * Is the temporary file open ?
+     */
+    bool is_open () const;
+
+    /**
+     * The stream to write the file's contents to.
+     */
+    std::ostream& out ();
+
+    /**
+     * Close the temporary file and rename it to the path. Returns false if
+     * the file could not be written or renamed.
+     */
+    bool commit ();
+
+  private:
+    const std::string path;      //< The file's path.
+    const std::string temp;      //< The temporary file's path.
+    std::ofstream     out_;      //< The temporary file.
+    bool              committed; //< The file has been committed.
+  };
+
+  /**
+   * Write the contents to a file using an atomic_file. Returns false if the
+   * file is not written.
+   */
+  bool write_file_atomically (const std::string& path,
+                              const std::string& contents);
+
   /**
    * Parse version string of format major.minor.revision where revieion can be
    * a git hash.
@@ -0,0 +1,638 @@
+/*! @file AddressToLineMapper.cc
+ *  @brief AddressToLineMapper Implementation
+ *
+ *  This file contains the implementation of the functions supporting
+ *  the decoding of the DWARF line number information of an executable.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include <rld.h>
+
+#include "AddressToLineMapper.h"
+
+namespace Coverage {
+
+  /*
+   *  DWARF constants used by the line number program.
+   */
+  #define DW_LNS_copy               1
+  #define DW_LNS_advance_pc         2
+  #define DW_LNS_advance_line       3
+  #define DW_LNS_set_file           4
+  #define DW_LNS_const_add_pc       8
+  #define DW_LNS_fixed_advance_pc   9
+
+  #define DW_LNE_end_sequence       1
+  #define DW_LNE_set_address        2
+  #define DW_LNE_define_file        3
+
+  #define DW_LNCT_path              1
+  #define DW_LNCT_directory_index   2
+
+  #define DW_FORM_block2            0x03
+  #define DW_FORM_block4            0x04
+  #define DW_FORM_data2             0x05
+  #define DW_FORM_data4             0x06
+  #define DW_FORM_data8             0x07
+  #define DW_FORM_string            0x08
+  #define DW_FORM_block             0x09
+  #define DW_FORM_block1            0x0a
+  #define DW_FORM_data1             0x0b
+  #define DW_FORM_sdata             0x0d
+  #define DW_FORM_strp              0x0e
+  #define DW_FORM_udata             0x0f
+  #define DW_FORM_data16            0x1e
+  #define DW_FORM_line_strp         0x1f
+
+  /*
+   *  A bounds checked reader of DWARF section data.  Reading past the
+   *  end of the data sets the bad flag and returns zero.
+   */
+  class dwarfReader {
+  public:
+    dwarfReader(
+      const uint8_t* start,
+      const uint8_t* end,
+      bool           bigEndian
+    ) : p( start ), end( end ), bigEndian( bigEndian ), bad( false )
+    {
+    }
+
+    uint64_t readUnsigned( int size )
+    {
+      uint64_t value = 0;
+      int      i;
+
+      if ((end - p) < size) {
+        bad = true;
+        p = end;
+        return 0;
+      }
+
+      for (i = 0; i < size; i++) {
+        if (bigEndian)
+          value = (value << 8) | p[ i ];
+        else
+          value |= ((uint64_t) p[ i ]) << (i * 8);
+      }
+      p += size;
+      return value;
+    }
+
+    uint64_t readULEB128( void )
+    {
+      uint64_t value = 0;
+      int      shift = 0;
+      uint8_t  byte;
+
+      do {
+        if (p >= end) {
+          bad = true;
+          return 0;
+        }
+        byte = *p++;
+        if (shift < 64)
+          value |= ((uint64_t) (byte & 0x7f)) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+
+      return value;
+    }
+
+    int64_t readSLEB128( void )
+    {
+      int64_t value = 0;
+      int     shift = 0;
+      uint8_t byte;
+
+      do {
+        if (p >= end) {
+          bad = true;
+          return 0;
+        }
+        byte = *p++;
+        if (shift < 64)
+          value |= ((int64_t) (byte & 0x7f)) << shift;
+        shift += 7;
+      } while (byte & 0x80);
+
+      if ((shift < 64) && (byte & 0x40))
+        value |= -(((int64_t) 1) << shift);
+
+      return value;
+    }
+
+    const char* readString( void )
+    {
+      const uint8_t* s = p;
+
+      while ((p < end) && (*p != '\0'))
+        p++;
+      if (p >= end) {
+        bad = true;
+        return "";
+      }
+      p++;
+      return (const char*) s;
+    }
+
+    void skip( uint64_t size )
+    {
+      if ((uint64_t) (end - p) < size) {
+        bad = true;
+        p = end;
+      }
+      else
+        p += size;
+    }
+
+    const uint8_t* p;
+    const uint8_t* end;
+    bool           bigEndian;
+    bool           bad;
+  };
+
+  /*
+   *  Return the string at the offset in a string section.
+   */
+  static const char* sectionString(
+    const uint8_t* strings,
+    size_t         size,
+    uint64_t       offset
+  )
+  {
+    if (!strings || (offset >= size) ||
+        (memchr( strings + offset, '\0', size - offset ) == NULL))
+      return "";
+    return (const char*) (strings + offset);
+  }
+
+  /*
+   *  Read a DWARF 5 entry format attribute value.  Strings are
+   *  returned in text and constants in value.
+   */
+  static bool readForm(
+    dwarfReader&   reader,
+    uint64_t       form,
+    int            offsetSize,
+    const uint8_t* lineStrings,
+    size_t         lineStringsSize,
+    const uint8_t* strings,
+    size_t         stringsSize,
+    std::string&   text,
+    uint64_t&      value
+  )
+  {
+    text = "";
+    value = 0;
+
+    switch (form) {
+      case DW_FORM_string:
+        text = reader.readString();
+        break;
+      case DW_FORM_line_strp:
+        text = sectionString(
+          lineStrings, lineStringsSize, reader.readUnsigned( offsetSize )
+        );
+        break;
+      case DW_FORM_strp:
+        text = sectionString(
+          strings, stringsSize, reader.readUnsigned( offsetSize )
+        );
+        break;
+      case DW_FORM_data1:  value = reader.readUnsigned( 1 ); break;
+      case DW_FORM_data2:  value = reader.readUnsigned( 2 ); break;
+      case DW_FORM_data4:  value = reader.readUnsigned( 4 ); break;
+      case DW_FORM_data8:  value = reader.readUnsigned( 8 ); break;
+      case DW_FORM_data16: reader.skip( 16 );                break;
+      case DW_FORM_udata:  value = reader.readULEB128();     break;
+      case DW_FORM_sdata:  value = reader.readSLEB128();     break;
+      case DW_FORM_block:  reader.skip( reader.readULEB128() );     break;
+      case DW_FORM_block1: reader.skip( reader.readUnsigned( 1 ) ); break;
+      case DW_FORM_block2: reader.skip( reader.readUnsigned( 2 ) ); break;
+      case DW_FORM_block4: reader.skip( reader.readUnsigned( 4 ) ); break;
+      default:
+        return false;
+    }
+
+    return !reader.bad;
+  }
+
+  /*
+   *  Return the base name of a path.
+   */
+  static std::string baseName(
+    const std::string& path
+  )
+  {
+    size_t slash = path.find_last_of( "/\\" );
+
+    if (slash == std::string::npos)
+      return path;
+    return path.substr( slash + 1 );
+  }
+
+  AddressToLineMapper::AddressToLineMapper()
+  {
+  }
+
+  AddressToLineMapper::~AddressToLineMapper()
+  {
+  }
+
+  uint32_t AddressToLineMapper::addFile(
+    const std::string& name
+  )
+  {
+    std::string                               base = baseName( name );
+    std::map<std::string, uint32_t>::iterator itr;
+
+    itr = fileIndex.find( base );
+    if (itr != fileIndex.end())
+      return itr->second;
+
+    files.push_back( base );
+    fileIndex[ base ] = files.size() - 1;
+    return files.size() - 1;
+  }
+
+  bool AddressToLineMapper::load(
+    const std::string& fileName
+  )
+  {
+    std::vector<uint8_t> line;
+    std::vector<uint8_t> lineStrings;
+    std::vector<uint8_t> strings;
+    bool                 bigEndian;
+
+    files.clear();
+    fileIndex.clear();
+    rows.clear();
+
+    try {
+      rld::files::object   exe( fileName );
+      rld::files::sections secs;
+
+      exe.open();
+      exe.begin();
+
+      if (!exe.valid()) {
+        exe.close();
+        return false;
+      }
+
+      bigEndian = exe.elf().data_type() == ELFDATA2MSB;
+
+      exe.get_sections( secs, ".debug_line" );
+      exe.get_sections( secs, ".debug_line_str" );
+      exe.get_sections( secs, ".debug_str" );
+
+      for (rld::files::sections::const_iterator sitr = secs.begin();
+           sitr != secs.end();
+           sitr++) {
+        std::vector<uint8_t>* data;
+
+        if (sitr->name == ".debug_line")
+          data = &line;
+        else if (sitr->name == ".debug_line_str")
+          data = &lineStrings;
+        else
+          data = &strings;
+
+        data->resize( sitr->size );
+        if (!data->empty() &&
+            !exe.seek_read( sitr->offset, &(*data)[0], sitr->size )) {
+          exe.end();
+          exe.close();
+          return false;
+        }
+      }
+
+      exe.end();
+      exe.close();
+    }
+    catch (rld::error re) {
+      fprintf(
+        stderr,
+        "WARNING: AddressToLineMapper::load - %s: %s\n",
+        re.where.c_str(),
+        re.what.c_str()
+      );
+      return false;
+    }
+
+    if (line.empty())
+      return false;
+
+    if (!decode(
+          &line[0], line.size(),
+          lineStrings.empty() ? NULL : &lineStrings[0], lineStrings.size(),
+          strings.empty() ? NULL : &strings[0], strings.size(),
+          bigEndian
+        )) {
+      files.clear();
+      fileIndex.clear();
+      rows.clear();
+      return false;
+    }
+
+    std::stable_sort( rows.begin(), rows.end(), rowLess );
+
+    return !rows.empty();
+  }
+
+  bool AddressToLineMapper::decode(
+    const uint8_t* data,
+    size_t         size,
+    const uint8_t* lineStrings,
+    size_t         lineStringsSize,
+    const uint8_t* strings,
+    size_t         stringsSize,
+    bool           bigEndian
+  )
+  {
+    dwarfReader section( data, data + size, bigEndian );
+
+    while (section.p < section.end) {
+      uint64_t              unitLength;
+      int                   offsetSize = 4;
+      uint16_t              version;
+      uint64_t              headerLength;
+      uint8_t               minimumInstructionLength;
+      int8_t                lineBase;
+      uint8_t               lineRange;
+      uint8_t               opcodeBase;
+      std::vector<uint8_t>  opcodeLengths;
+      std::vector<std::string> directories;
+      std::vector<uint32_t> unitFiles;
+      int                   fileBase;
+      const uint8_t*        unitEnd;
+      const uint8_t*        programStart;
+
+      unitLength = section.readUnsigned( 4 );
+      if (unitLength == 0xffffffff) {
+        offsetSize = 8;
+        unitLength = section.readUnsigned( 8 );
+      }
+      else if (unitLength >= 0xfffffff0)
+        return false;
+
+      if (section.bad || ((uint64_t) (section.end - section.p) < unitLength))
+        return false;
+
+      unitEnd = section.p + unitLength;
+
+      dwarfReader unit( section.p, unitEnd, bigEndian );
+      section.p = unitEnd;
+
+      version = unit.readUnsigned( 2 );
+      if ((version < 2) || (version > 5))
+        return false;
+
+      if (version >= 5) {
+        unit.readUnsigned( 1 );   // address_size
+        unit.readUnsigned( 1 );   // segment_selector_size
+      }
+
+      headerLength = unit.readUnsigned( offsetSize );
+      if (unit.bad || ((uint64_t) (unit.end - unit.p) < headerLength))
+        return false;
+      programStart = unit.p + headerLength;
+
+      minimumInstructionLength = unit.readUnsigned( 1 );
+      if (version >= 4)
+        unit.readUnsigned( 1 );   // maximum_operations_per_instruction
+      unit.readUnsigned( 1 );     // default_is_stmt
+      lineBase = (int8_t) unit.readUnsigned( 1 );
+      lineRange = unit.readUnsigned( 1 );
+      opcodeBase = unit.readUnsigned( 1 );
+
+      if (unit.bad || (lineRange == 0) || (opcodeBase == 0))
+        return false;
+
+      opcodeLengths.resize( opcodeBase );
+      for (int i = 1; i < opcodeBase; i++)
+        opcodeLengths[ i ] = unit.readUnsigned( 1 );
+
+      if (version < 5) {
+        // The file register is one based and the directory zero is the
+        // compilation directory which is not part of the line table.
+        fileBase = 1;
+        directories.push_back( "" );
+        while (true) {
+          const char* dir = unit.readString();
+          if (unit.bad || (*dir == '\0'))
+            break;
+          directories.push_back( dir );
+        }
+        while (true) {
+          const char* name = unit.readString();
+          if (unit.bad || (*name == '\0'))
+            break;
+          unit.readULEB128();     // directory index
+          unit.readULEB128();     // modification time
+          unit.readULEB128();     // length
+          unitFiles.push_back( addFile( name ) );
+        }
+      }
+      else {
+        // The file register is zero based and the entries are
+        // described by a list of content type and form pairs.
+        std::vector<uint64_t> format;
+        uint64_t              count;
+        uint8_t               formatCount;
+        std::string           text;
+        uint64_t              value;
+
+        fileBase = 0;
+
+        formatCount = unit.readUnsigned( 1 );
+        for (int i = 0; i < formatCount * 2; i++)
+          format.push_back( unit.readULEB128() );
+        count = unit.readULEB128();
+        for (uint64_t d = 0; !unit.bad && (d < count); d++) {
+          std::string dir;
+          for (size_t f = 0; f < format.size(); f += 2) {
+            if (!readForm(
+                  unit, format[ f + 1 ], offsetSize,
+                  lineStrings, lineStringsSize, strings, stringsSize,
+                  text, value
+                ))
+              return false;
+            if (format[ f ] == DW_LNCT_path)
+              dir = text;
+          }
+          directories.push_back( dir );
+        }
+
+        format.clear();
+        formatCount = unit.readUnsigned( 1 );
+        for (int i = 0; i < formatCount * 2; i++)
+          format.push_back( unit.readULEB128() );
+        count = unit.readULEB128();
+        for (uint64_t n = 0; !unit.bad && (n < count); n++) {
+          std::string name;
+          for (size_t f = 0; f < format.size(); f += 2) {
+            if (!readForm(
+                  unit, format[ f + 1 ], offsetSize,
+                  lineStrings, lineStringsSize, strings, stringsSize,
+                  text, value
+                ))
+              return false;
+            if (format[ f ] == DW_LNCT_path)
+              name = text;
+          }
+          unitFiles.push_back( addFile( name ) );
+        }
+      }
+
+      if (unit.bad)
+        return false;
+
+      //
+      // Run the line number program.
+      //
+      unit.p = programStart;
+
+      uint64_t address = 0;
+      uint64_t file = 1;
+      int64_t  line = 1;
+      row_t    row;
+
+      while (unit.p < unit.end) {
+        uint8_t opcode = unit.readUnsigned( 1 );
+        bool    emit = false;
+
+        if (opcode >= opcodeBase) {
+          uint8_t adjusted = opcode - opcodeBase;
+          address += (adjusted / lineRange) * minimumInstructionLength;
+          line += lineBase + (adjusted % lineRange);
+          emit = true;
+        }
+        else if (opcode == 0) {
+          uint64_t       length = unit.readULEB128();
+          const uint8_t* next;
+          uint8_t        extended;
+
+          if (unit.bad || (length == 0) ||
+              ((uint64_t) (unit.end - unit.p) < length))
+            return false;
+
+          next = unit.p + length;
+          extended = unit.readUnsigned( 1 );
+
+          switch (extended) {
+            case DW_LNE_end_sequence:
+              row.address     = address;
+              row.file        = 0;
+              row.line        = 0;
+              row.endSequence = true;
+              rows.push_back( row );
+              address = 0;
+              file = 1;
+              line = 1;
+              break;
+            case DW_LNE_set_address:
+              address = unit.readUnsigned( length - 1 );
+              break;
+            case DW_LNE_define_file:
+              unitFiles.push_back( addFile( unit.readString() ) );
+              break;
+            default:
+              break;
+          }
+
+          unit.p = next;
+        }
+        else {
+          switch (opcode) {
+            case DW_LNS_copy:
+              emit = true;
+              break;
+            case DW_LNS_advance_pc:
+              address += unit.readULEB128() * minimumInstructionLength;
+              break;
+            case DW_LNS_advance_line:
+              line += unit.readSLEB128();
+              break;
+            case DW_LNS_set_file:
+              file = unit.readULEB128();
+              break;
+            case DW_LNS_const_add_pc:
+              address +=
+                ((255 - opcodeBase) / lineRange) * minimumInstructionLength;
+              break;
+            case DW_LNS_fixed_advance_pc:
+              address += unit.readUnsigned( 2 );
+              break;
+            default:
+              for (int i = 0; i < opcodeLengths[ opcode ]; i++)
+                unit.readULEB128();
+              break;
+          }
+        }
+
+        if (unit.bad)
+          return false;
+
+        if (emit) {
+          row.address     = address;
+          row.line        = line;
+          row.endSequence = false;
+          if ((file >= (uint64_t) fileBase) &&
+              ((file - fileBase) < unitFiles.size()))
+            row.file = unitFiles[ file - fileBase ];
+          else
+            row.file = addFile( "??" );
+          rows.push_back( row );
+        }
+      }
+    }
+
+    return true;
+  }
+
+  bool AddressToLineMapper::rowLess(
+    const row_t& lhs,
+    const row_t& rhs
+  )
+  {
+    if (lhs.address != rhs.address)
+      return lhs.address < rhs.address;
+    return lhs.endSequence && !rhs.endSequence;
+  }
+
+  bool AddressToLineMapper::getSourceLine(
+    uint32_t     address,
+    std::string& sourceLine
+  ) const
+  {
+    std::vector<row_t>::const_iterator itr;
+    row_t                              key;
+    char                               number[ 16 ];
+
+    sourceLine = "??:0";
+
+    key.address     = address;
+    key.file        = 0;
+    key.line        = 0;
+    key.endSequence = false;
+
+    // Find the last row at or below the address. If it ends a sequence
+    // the address is in a gap between sequences.
+    itr = std::upper_bound( rows.begin(), rows.end(), key, rowLess );
+    if (itr == rows.begin())
+      return false;
+    itr--;
+    if (itr->endSequence)
+      return false;
+
+    snprintf( number, sizeof(number), "%u", itr->line );
+    sourceLine = files[ itr->file ] + ":" + number;
+    return true;
+  }
+
+}
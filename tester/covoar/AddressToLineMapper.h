@@ -0,0 +1,159 @@
+/*! @file AddressToLineMapper.h
+ *  @brief AddressToLineMapper Specification
+ *
+ *  This file contains the specification of the AddressToLineMapper class.
+ */
+
+#ifndef __ADDRESS_TO_LINE_MAPPER_H__
+#define __ADDRESS_TO_LINE_MAPPER_H__
+
+#include <stdint.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace Coverage {
+
+  /*! @class AddressToLineMapper
+   *
+   *  This class decodes the DWARF line number programs held in the
+   *  .debug_line section of an executable and builds an index from
+   *  address to source file and line.  It replaces running addr2line
+   *  for each set of uncovered ranges.  The index is built once per
+   *  executable and every lookup is a binary search.
+   */
+  class AddressToLineMapper {
+
+  public:
+
+    /*!
+     *  This method constructs an AddressToLineMapper instance.
+     */
+    AddressToLineMapper();
+
+    /*!
+     *  This method destructs an AddressToLineMapper instance.
+     */
+    virtual ~AddressToLineMapper();
+
+    /*!
+     *  This method reads the line number information from the
+     *  specified ELF file and builds the address index.
+     *
+     *  @param[in] fileName specifies the executable or library to read
+     *
+     *  @return Returns TRUE if the line information was loaded and FALSE
+     *   if the file has no usable line information.
+     */
+    bool load(
+      const std::string& fileName
+    );
+
+    /*!
+     *  This method returns the source line for the specified address
+     *  in the same form covoar uses from addr2line, that is the base
+     *  name of the source file and the line number separated by a
+     *  colon.  Addresses not covered by the line table return "??:0".
+     *
+     *  @param[in] address specifies the address to look up
+     *  @param[out] sourceLine is set to the source line
+     *
+     *  @return Returns TRUE if the address was found and FALSE otherwise.
+     */
+    bool getSourceLine(
+      uint32_t     address,
+      std::string& sourceLine
+    ) const;
+
+  private:
+
+    /*!
+     *  This type defines a row of the line number matrix.
+     */
+    typedef struct {
+      /*!
+       *  This member contains the address of the row.
+       */
+      uint32_t address;
+
+      /*!
+       *  This member contains the index of the row's file name.
+       */
+      uint32_t file;
+
+      /*!
+       *  This member contains the row's line number.
+       */
+      uint32_t line;
+
+      /*!
+       *  This member indicates the row ends a sequence of addresses.
+       */
+      bool endSequence;
+    } row_t;
+
+    /*!
+     *  This method decodes the line number programs in the section
+     *  data and adds the rows to the index.
+     *
+     *  @param[in] data points to the .debug_line section data
+     *  @param[in] size is the size of the .debug_line section
+     *  @param[in] lineStrings points to the .debug_line_str section data
+     *  @param[in] lineStringsSize is the size of the .debug_line_str data
+     *  @param[in] strings points to the .debug_str section data
+     *  @param[in] stringsSize is the size of the .debug_str data
+     *  @param[in] bigEndian is TRUE if the data is big endian
+     *
+     *  @return Returns TRUE if all programs were decoded.
+     */
+    bool decode(
+      const uint8_t* data,
+      size_t         size,
+      const uint8_t* lineStrings,
+      size_t         lineStringsSize,
+      const uint8_t* strings,
+      size_t         stringsSize,
+      bool           bigEndian
+    );
+
+    /*!
+     *  This method returns the index of the specified file name in
+     *  the file name table adding it if it is not present.
+     *
+     *  @param[in] name specifies the file's name
+     *
+     *  @return Returns the file name's index.
+     */
+    uint32_t addFile(
+      const std::string& name
+    );
+
+    /*!
+     *  This method orders rows by address.  A row ending a sequence
+     *  sorts before a row starting another sequence at the same address
+     *  so the end does not hide the start of the next sequence.
+     */
+    static bool rowLess(
+      const row_t& lhs,
+      const row_t& rhs
+    );
+
+    /*!
+     *  This member contains the base names of the source files.
+     */
+    std::vector<std::string> files;
+
+    /*!
+     *  This member maps a source file base name to its index in files.
+     */
+    std::map<std::string, uint32_t> fileIndex;
+
+    /*!
+     *  This member contains the rows of all line number programs
+     *  sorted by address.
+     */
+    std::vector<row_t> rows;
+  };
+
+}
+#endif
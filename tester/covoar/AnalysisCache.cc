@@ -0,0 +1,443 @@
+/*! @file AnalysisCache.cc
+ *  @brief AnalysisCache Implementation
+ *
+ *  This file contains the implementation of the functions supporting
+ *  the on-disk cache of the symbols and instructions of executables.
+ */
+
+#include "covoar-config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#include <atomic>
+
+#include <rld.h>
+
+#include "AnalysisCache.h"
+#include "app_common.h"
+#include "DesiredSymbols.h"
+#include "ExecutableInfo.h"
+#include "TargetBase.h"
+
+#if HAVE_OPEN64
+#define OPEN fopen64
+#else
+#define OPEN fopen
+#endif
+
+namespace Coverage {
+
+  /*
+   *  The version changes whenever the layout of an entry or the way
+   *  the symbols are found changes so old entries are not used.
+   */
+  static const char     cacheMagic[8] =
+    { 'C', 'O', 'V', 'C', 'A', 'C', 'H', 'E' };
+  static const uint32_t cacheVersion = 1;
+
+  /*
+   *  The version of the analysis done by the ObjdumpProcessor parser
+   *  and the instruction decoders.  It is part of the settings so it
+   *  changes whenever they find or classify instructions differently.
+   */
+  static const uint32_t analysisVersion = 3;
+
+  /*
+   *  The flags saved for each line.
+   */
+  #define LINE_IS_INSTRUCTION 0x01
+  #define LINE_IS_NOP         0x02
+  #define LINE_IS_BRANCH      0x04
+
+  /*
+   *  Each temporary file has a unique name so several threads or
+   *  processes can save entries to the same directory.
+   */
+  static std::atomic<uint32_t> temporaryCount( 0 );
+
+  static uint64_t hashBytes(
+    uint64_t          hash,
+    const void* const data,
+    size_t            size
+  )
+  {
+    return rld::hash_bytes( data, size, hash );
+  }
+
+  static uint64_t hashString(
+    uint64_t           hash,
+    const std::string& s
+  )
+  {
+    uint32_t length = s.size();
+
+    hash = hashBytes( hash, &length, sizeof(length) );
+    return hashBytes( hash, s.data(), s.size() );
+  }
+
+  /*
+   *  Hash the identity of a tool: its path, size and modification
+   *  time.  A tool that is not found is hashed by name only.
+   */
+  static uint64_t hashTool(
+    uint64_t           hash,
+    const std::string& command
+  )
+  {
+    std::string      path = command;
+    struct stat      sb;
+    rld::path::paths sp;
+
+    if (command.find_first_of( "/\\" ) == std::string::npos) {
+      rld::path::get_system_path( sp );
+      rld::path::find_file( path, command, sp );
+    }
+
+    hash = hashString( hash, command );
+    if (!path.empty() && (stat( path.c_str(), &sb ) == 0)) {
+      uint64_t value;
+
+      hash = hashString( hash, path );
+      value = sb.st_size;
+      hash = hashBytes( hash, &value, sizeof(value) );
+      value = sb.st_mtime;
+      hash = hashBytes( hash, &value, sizeof(value) );
+    }
+    return hash;
+  }
+
+  static bool writeBytes(
+    FILE*             file,
+    const void* const data,
+    size_t            size
+  )
+  {
+    return fwrite( data, 1, size, file ) == size;
+  }
+
+  static bool writeUint32(
+    FILE*    file,
+    uint32_t value
+  )
+  {
+    return writeBytes( file, &value, sizeof(value) );
+  }
+
+  static bool writeString(
+    FILE*              file,
+    const std::string& s
+  )
+  {
+    return writeUint32( file, s.size() ) &&
+           writeBytes( file, s.data(), s.size() );
+  }
+
+  static bool readBytes(
+    FILE*       file,
+    void* const data,
+    size_t      size
+  )
+  {
+    return fread( data, 1, size, file ) == size;
+  }
+
+  static bool readUint32(
+    FILE*     file,
+    uint32_t& value
+  )
+  {
+    return readBytes( file, &value, sizeof(value) );
+  }
+
+  static bool readString(
+    FILE*        file,
+    std::string& s
+  )
+  {
+    uint32_t length;
+
+    if (!readUint32( file, length ))
+      return false;
+
+    // No name or line comes close to this so anything larger is a
+    // damaged entry.
+    if (length > 0x100000)
+      return false;
+
+    s.resize( length );
+    return (length == 0) || readBytes( file, &s[0], length );
+  }
+
+  AnalysisCache::AnalysisCache(
+    const char* const theDirectory
+  )
+  {
+    if (theDirectory)
+      directory = theDirectory;
+    haveKey = false;
+  }
+
+  AnalysisCache::~AnalysisCache()
+  {
+  }
+
+  bool AnalysisCache::computeKey(
+    ExecutableInfo* const executableInformation
+  )
+  {
+    std::string                           fileName;
+    FILE*                                 file;
+    uint8_t                               buffer[ 64 * 1024 ];
+    size_t                                count;
+    uint32_t                              value;
+    DesiredSymbols::symbolSet_t::iterator sitr;
+
+    if (haveKey)
+      return true;
+
+    if (executableInformation->hasDynamicLibrary())
+      fileName = executableInformation->getLibraryName();
+    else
+      fileName = executableInformation->getFileName();
+
+    file = OPEN( fileName.c_str(), "rb" );
+    if (!file)
+      return false;
+
+    key.contentHash = rld::hash_basis;
+    key.contentSize = 0;
+    while ((count = fread( buffer, 1, sizeof(buffer), file )) > 0) {
+      key.contentHash = hashBytes( key.contentHash, buffer, count );
+      key.contentSize += count;
+    }
+    if (ferror( file )) {
+      fclose( file );
+      return false;
+    }
+    fclose( file );
+
+    key.settingsHash = rld::hash_basis;
+    value = analysisVersion;
+    key.settingsHash = hashBytes( key.settingsHash, &value, sizeof(value) );
+    key.settingsHash = hashString( key.settingsHash, TargetInfo->getTarget() );
+    value = (!UseObjdump && TargetInfo->hasInstructionDecoder()) ? 1 : 0;
+    key.settingsHash = hashBytes( key.settingsHash, &value, sizeof(value) );
+
+    // The disassembly from objdump depends on the binutils it is from.
+    if (value == 0)
+      key.settingsHash = hashTool( key.settingsHash, TargetInfo->getObjdump() );
+    value = executableInformation->getLoadAddress();
+    key.settingsHash = hashBytes( key.settingsHash, &value, sizeof(value) );
+    for (sitr = SymbolsToAnalyze->set.begin();
+         sitr != SymbolsToAnalyze->set.end();
+         sitr++)
+      key.settingsHash = hashString( key.settingsHash, sitr->first );
+
+    haveKey = true;
+    return true;
+  }
+
+  std::string AnalysisCache::entryName( void ) const
+  {
+    char name[ 64 ];
+
+    snprintf(
+      name,
+      sizeof(name),
+      "%016llx%016llx.cache",
+      (unsigned long long) key.contentHash,
+      (unsigned long long) key.settingsHash
+    );
+    return directory + "/" + name;
+  }
+
+  bool AnalysisCache::read(
+    ExecutableInfo* const               executableInformation,
+    ObjdumpProcessor::objdumpSymbols_t& symbols
+  )
+  {
+    std::string                     fileName;
+    FILE*                           file;
+    char                            magic[ sizeof(cacheMagic) ];
+    uint32_t                        version;
+    cacheKey_t                      entryKey;
+    uint32_t                        symbolCount;
+    uint32_t                        lineCount;
+    uint32_t                        nopSize;
+    uint8_t                         flags;
+    uint32_t                        i;
+    uint32_t                        j;
+    bool                            status = true;
+    ObjdumpProcessor::objdumpLine_t lineInfo;
+
+    if (!computeKey( executableInformation ))
+      return false;
+
+    fileName = entryName();
+    file = OPEN( fileName.c_str(), "rb" );
+    if (!file)
+      return false;
+
+    if (!readBytes( file, magic, sizeof(magic) ) ||
+        (memcmp( magic, cacheMagic, sizeof(magic) ) != 0) ||
+        !readUint32( file, version ) ||
+        (version != cacheVersion) ||
+        !readBytes( file, &entryKey, sizeof(entryKey) ) ||
+        (entryKey.contentHash != key.contentHash) ||
+        (entryKey.contentSize != key.contentSize) ||
+        (entryKey.settingsHash != key.settingsHash) ||
+        !readUint32( file, symbolCount ))
+      status = false;
+
+    for (i = 0; status && (i < symbolCount); i++) {
+      ObjdumpProcessor::objdumpSymbol_t symbol;
+
+      symbols.push_back( symbol );
+      ObjdumpProcessor::objdumpSymbol_t& s = symbols.back();
+
+      if (!readString( file, s.symbolName ) ||
+          !readUint32( file, s.lowAddress ) ||
+          !readUint32( file, s.highAddress ) ||
+          !readUint32( file, lineCount )) {
+        status = false;
+        break;
+      }
+
+      for (j = 0; j < lineCount; j++) {
+        if (!readString( file, lineInfo.line ) ||
+            !readUint32( file, lineInfo.address ) ||
+            !readBytes( file, &flags, sizeof(flags) ) ||
+            !readUint32( file, nopSize )) {
+          status = false;
+          break;
+        }
+        lineInfo.isInstruction = (flags & LINE_IS_INSTRUCTION) != 0;
+        lineInfo.isNop         = (flags & LINE_IS_NOP) != 0;
+        lineInfo.isBranch      = (flags & LINE_IS_BRANCH) != 0;
+        lineInfo.nopSize       = nopSize;
+        s.instructions.push_back( lineInfo );
+      }
+    }
+
+    // Nothing may follow the last symbol.
+    if (status && (fgetc( file ) != EOF))
+      status = false;
+
+    fclose( file );
+
+    if (!status) {
+      if (Verbose)
+        fprintf(
+          stderr,
+          "WARNING: AnalysisCache::read - ignoring damaged entry %s\n",
+          fileName.c_str()
+        );
+      symbols.clear();
+      return false;
+    }
+
+    if (Verbose)
+      fprintf(
+        stderr,
+        "Read %s from the analysis cache\n",
+        executableInformation->getFileName().c_str()
+      );
+
+    return true;
+  }
+
+  bool AnalysisCache::write(
+    ExecutableInfo* const                     executableInformation,
+    const ObjdumpProcessor::objdumpSymbols_t& symbols
+  )
+  {
+    std::string                                        fileName;
+    std::string                                        temporaryName;
+    char                                               suffix[ 64 ];
+    FILE*                                              file;
+    uint8_t                                            flags;
+    bool                                               status;
+    ObjdumpProcessor::objdumpSymbols_t::const_iterator sitr;
+    ObjdumpProcessor::objdumpLines_t::const_iterator   litr;
+
+    if (!computeKey( executableInformation ))
+      return false;
+
+    fileName = entryName();
+    snprintf(
+      suffix,
+      sizeof(suffix),
+      ".%ld.%u.tmp",
+      (long) getpid(),
+      (unsigned int) temporaryCount++
+    );
+    temporaryName = fileName + suffix;
+
+    file = OPEN( temporaryName.c_str(), "wb" );
+    if (!file) {
+      fprintf(
+        stderr,
+        "WARNING: AnalysisCache::write - unable to open %s\n",
+        temporaryName.c_str()
+      );
+      return false;
+    }
+
+    status = writeBytes( file, cacheMagic, sizeof(cacheMagic) ) &&
+             writeUint32( file, cacheVersion ) &&
+             writeBytes( file, &key, sizeof(key) ) &&
+             writeUint32( file, symbols.size() );
+
+    for (sitr = symbols.begin(); status && (sitr != symbols.end()); sitr++) {
+      status = writeString( file, sitr->symbolName ) &&
+               writeUint32( file, sitr->lowAddress ) &&
+               writeUint32( file, sitr->highAddress ) &&
+               writeUint32( file, sitr->instructions.size() );
+
+      for (litr = sitr->instructions.begin();
+           status && (litr != sitr->instructions.end());
+           litr++) {
+        flags = 0;
+        if (litr->isInstruction)
+          flags |= LINE_IS_INSTRUCTION;
+        if (litr->isNop)
+          flags |= LINE_IS_NOP;
+        if (litr->isBranch)
+          flags |= LINE_IS_BRANCH;
+
+        status = writeString( file, litr->line ) &&
+                 writeUint32( file, litr->address ) &&
+                 writeBytes( file, &flags, sizeof(flags) ) &&
+                 writeUint32( file, litr->nopSize );
+      }
+    }
+
+    if (fclose( file ) != 0)
+      status = false;
+
+    // Renaming replaces any entry another run saved in the meantime
+    // with an identical one.
+#if WIN32
+    if (status)
+      unlink( fileName.c_str() );
+#endif
+    if (status && (rename( temporaryName.c_str(), fileName.c_str() ) != 0))
+      status = false;
+
+    if (!status) {
+      fprintf(
+        stderr,
+        "WARNING: AnalysisCache::write - unable to save %s\n",
+        fileName.c_str()
+      );
+      unlink( temporaryName.c_str() );
+    }
+
+    return status;
+  }
+
+}
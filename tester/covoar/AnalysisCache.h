@@ -0,0 +1,134 @@
+/*! @file AnalysisCache.h
+ *  @brief AnalysisCache Specification
+ *
+ *  This file contains the specification of the AnalysisCache class.
+ */
+
+#ifndef __ANALYSIS_CACHE_H__
+#define __ANALYSIS_CACHE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+#include "ObjdumpProcessor.h"
+
+namespace Coverage {
+
+  class ExecutableInfo;
+
+  /*! @class AnalysisCache
+   *
+   *  This class saves the symbols and instructions found when an
+   *  executable is loaded to a file in a cache directory and reads
+   *  them back on later runs.  An entry is keyed by a hash of the
+   *  contents of the executable, or its dynamic library, together with
+   *  the settings that change what is found: the version of the
+   *  analysis, the target, the way the code was disassembled and the
+   *  objdump used, the load address and the desired symbols.
+   *  An entry that does not match exactly is treated as missing so a
+   *  rebuilt executable is always analyzed again.
+   */
+  class AnalysisCache {
+
+  public:
+
+    /*!
+     *  This method constructs an AnalysisCache instance.
+     *
+     *  @param[in] directory specifies the directory holding the entries
+     */
+    AnalysisCache(
+      const char* const directory
+    );
+
+    /*!
+     *  This method destructs an AnalysisCache instance.
+     */
+    virtual ~AnalysisCache();
+
+    /*!
+     *  This method reads the symbols of the specified executable from
+     *  the cache.
+     *
+     *  @param[in] executableInformation is the executable being loaded
+     *  @param[out] symbols receives the cached symbols
+     *
+     *  @return Returns TRUE if the cache held a matching entry and
+     *   FALSE otherwise.
+     */
+    bool read(
+      ExecutableInfo* const               executableInformation,
+      ObjdumpProcessor::objdumpSymbols_t& symbols
+    );
+
+    /*!
+     *  This method saves the symbols of the specified executable to the
+     *  cache.  The entry is written to a temporary file and renamed so
+     *  a concurrent reader never sees a partial entry.
+     *
+     *  @param[in] executableInformation is the executable loaded
+     *  @param[in] symbols contains the symbols to save
+     *
+     *  @return Returns TRUE if the entry was saved and FALSE otherwise.
+     */
+    bool write(
+      ExecutableInfo* const                     executableInformation,
+      const ObjdumpProcessor::objdumpSymbols_t& symbols
+    );
+
+  private:
+
+    /*!
+     *  This type defines the key of a cache entry.
+     */
+    typedef struct {
+      /*!
+       *  This member contains the hash of the file contents.
+       */
+      uint64_t contentHash;
+      /*!
+       *  This member contains the size of the file.
+       */
+      uint64_t contentSize;
+      /*!
+       *  This member contains the hash of the analysis settings.
+       */
+      uint64_t settingsHash;
+    } cacheKey_t;
+
+    /*!
+     *  This method computes the key of the specified executable.
+     *
+     *  @param[in] executableInformation is the executable being loaded
+     *
+     *  @return Returns TRUE if the key was computed and FALSE if the
+     *   file could not be read.
+     */
+    bool computeKey(
+      ExecutableInfo* const executableInformation
+    );
+
+    /*!
+     *  This method returns the name of the entry for the current key.
+     */
+    std::string entryName( void ) const;
+
+    /*!
+     *  This member contains the directory holding the entries.
+     */
+    std::string directory;
+
+    /*!
+     *  This member contains the key of the executable.
+     */
+    cacheKey_t key;
+
+    /*!
+     *  This member indicates whether key holds a valid key.
+     */
+    bool haveKey;
+  };
+
+}
+#endif
@@ -10,6 +10,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "CoverageMapBase.h"
 
@@ -20,7 +21,6 @@ namespace Coverage {
     uint32_t high
   )
   {
-    uint32_t       a;
     AddressRange_t range;
 
     range.lowAddress  = low;
@@ -29,26 +29,16 @@ namespace Coverage {
 
     Size = high - low + 1;
 
-    Info = new perAddressInfo_t[ Size ];
-
-    for (a=0; a<Size; a++) {
-
-      perAddressInfo_t *i = &Info[ a ];
-
-      i->isStartOfInstruction = false;
-      i->wasExecuted          = 0;
-      i->isBranch             = false;
-      i->isNop                = false;
-      i->wasTaken             = 0;
-      i->wasNotTaken          = 0;
-    }
+    IsStartOfInstruction.resize( Size, false );
+    WasExecuted.resize( Size, false );
+    IsBranch.resize( Size, false );
+    IsNop.resize( Size, false );
   }
 
   CoverageMapBase::~CoverageMapBase()
   {
-    if (Info)
-      delete Info;
   }
+
  
   void  CoverageMapBase::Add( uint32_t low, uint32_t high )
   {
@@ -79,8 +69,9 @@ namespace Coverage {
 
   void CoverageMapBase::dump( void ) const {
 
-    uint32_t          a;
-    perAddressInfo_t* entry;
+    uint32_t            a;
+    uint32_t            address;
+    const branchInfo_t* branch;
 
     fprintf( stderr, "Coverage Map Contents:\n" );
 
@@ -90,25 +81,75 @@ namespace Coverage {
 
     for (a = 0; a < Size; a++) {
 
-      entry = &Info[ a ];
+      address = a + RangeList.front().lowAddress;
+      branch = findBranch( a );
 
       fprintf(
         stderr,
         "0x%x - isStartOfInstruction = %s, wasExecuted = %s\n",
-        a + RangeList.front().lowAddress,
-        entry->isStartOfInstruction ? "TRUE" : "FALSE",
-        entry->wasExecuted ? "TRUE" : "FALSE"
+        address,
+        IsStartOfInstruction[ a ] ? "TRUE" : "FALSE",
+        WasExecuted[ a ] ? "TRUE" : "FALSE"
       );
       fprintf(
         stderr,
         "           isBranch = %s, wasTaken = %s, wasNotTaken = %s\n",
-        entry->isBranch ? "TRUE" : "FALSE",
-        entry->wasTaken ? "TRUE" : "FALSE",
-        entry->wasNotTaken ? "TRUE" : "FALSE"
+        IsBranch[ a ] ? "TRUE" : "FALSE",
+        (branch && branch->wasTaken) ? "TRUE" : "FALSE",
+        (branch && branch->wasNotTaken) ? "TRUE" : "FALSE"
       );
     }
   }
 
+  const CoverageMapBase::instructionInfo_t* CoverageMapBase::findInstruction(
+    uint32_t offset
+  ) const
+  {
+    std::vector< instructionInfo_t >::const_iterator itr;
+
+    if ((offset >= Size) || !IsStartOfInstruction[ offset ])
+      return NULL;
+
+    // Instruction starts are normally added in ascending order so the
+    // counters are a sorted vector searched with a binary search.
+    itr = std::lower_bound(
+      Instructions.begin(), Instructions.end(), offset, instructionLess
+    );
+    if ((itr == Instructions.end()) || (itr->offset != offset))
+      return NULL;
+
+    return &(*itr);
+  }
+
+  const CoverageMapBase::branchInfo_t* CoverageMapBase::findBranch(
+    uint32_t offset
+  ) const
+  {
+    branches_t::const_iterator itr;
+
+    itr = Branches.find( offset );
+    if (itr == Branches.end())
+      return NULL;
+
+    return &itr->second;
+  }
+
+  bool CoverageMapBase::instructionLess(
+    const instructionInfo_t& lhs,
+    uint32_t                 offset
+  )
+  {
+    return lhs.offset < offset;
+  }
+
+  void CoverageMapBase::saturatingAdd( uint32_t& counter, uint32_t addition )
+  {
+    if (addition > UINT32_MAX - counter)
+      counter = UINT32_MAX;
+    else
+      counter += addition;
+  }
+
   bool CoverageMapBase::getBeginningOfInstruction(
     uint32_t  address,
     uint32_t* beginning
@@ -123,14 +164,18 @@ namespace Coverage {
     if ( status != true )
       return status;
 
+    status = false;
     start = address;
 
     while (start >= range.lowAddress ) {
-      if (Info[ start - range.lowAddress ].isStartOfInstruction) {
+      if (((start - range.lowAddress) < Size) &&
+          IsStartOfInstruction[ start - range.lowAddress ]) {
         *beginning = start;
         status = true;
         break;
       }
+      else if (start == 0)
+        break;
       else
         start--;
     }
@@ -171,12 +216,37 @@ namespace Coverage {
     uint32_t    address
   )
   {
-    uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
+    uint32_t                                   offset;
+    instructionInfo_t                          info;
+    std::vector< instructionInfo_t >::iterator itr;
+    counters_t::iterator                       counter;
+
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
+      return;
+
+    if (IsStartOfInstruction[ offset ])
       return;
 
-    Info[ offset ].isStartOfInstruction = true;
+    IsStartOfInstruction[ offset ] = true;
+
+    // Keep the hits the address had before it was marked.
+    info.offset      = offset;
+    info.wasExecuted = WasExecuted[ offset ] ? 1 : 0;
+
+    counter = Unmarked.find( offset );
+    if (counter != Unmarked.end()) {
+      info.wasExecuted = counter->second;
+      Unmarked.erase( counter );
+    }
+
+    if (Instructions.empty() || (Instructions.back().offset < offset))
+      Instructions.push_back( info );
+    else {
+      itr = std::lower_bound(
+        Instructions.begin(), Instructions.end(), offset, instructionLess
+      );
+      Instructions.insert( itr, info );
+    }
   }
 
   bool CoverageMapBase::isStartOfInstruction( uint32_t address ) const
@@ -186,53 +256,127 @@ namespace Coverage {
     if (determineOffset( address, &offset ) != true)
       return false;
 
-    return Info[ offset ].isStartOfInstruction;
+    return isStartOfInstructionAtOffset( offset );
+  }
+
+  bool CoverageMapBase::isStartOfInstructionAtOffset( uint32_t offset ) const
+  {
+    if (offset >= Size)
+      return false;
+
+    return IsStartOfInstruction[ offset ];
   }
 
   void CoverageMapBase::setWasExecuted( uint32_t address )
+  {
+    sumWasExecuted( address, 1 );
+  }
+
+  void CoverageMapBase::markWasExecuted( uint32_t address )
   {
     uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
+
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return;
 
-    Info[ offset ].wasExecuted += 1;
+    WasExecuted[ offset ] = true;
   }
 
   void CoverageMapBase::sumWasExecuted( uint32_t address, uint32_t addition)
   {
     uint32_t offset;
- 
+
     if (determineOffset( address, &offset ) != true)
       return;
 
-    Info[ offset ].wasExecuted += addition;
+    sumWasExecutedAtOffset( offset, addition );
+  }
+
+  void CoverageMapBase::sumWasExecutedAtOffset(
+    uint32_t offset,
+    uint32_t addition
+  )
+  {
+    std::vector< instructionInfo_t >::iterator itr;
+
+    if ((offset >= Size) || (addition == 0))
+      return;
+
+    WasExecuted[ offset ] = true;
+
+    // Only the start of an instruction has a counter.  Before any start
+    // is marked the counter is kept aside until its address is marked.
+    if (!IsStartOfInstruction[ offset ]) {
+      if (!Instructions.empty())
+        return;
+      saturatingAdd(
+        Unmarked.insert( std::make_pair( offset, 0 ) ).first->second,
+        addition
+      );
+      return;
+    }
+
+    itr = std::lower_bound(
+      Instructions.begin(), Instructions.end(), offset, instructionLess
+    );
+    if ((itr != Instructions.end()) && (itr->offset == offset))
+      saturatingAdd( itr->wasExecuted, addition );
+  }
+
+  void CoverageMapBase::sumWasExecutedInRange(
+    uint32_t offset,
+    uint32_t size,
+    uint32_t addition
+  )
+  {
+    std::vector< instructionInfo_t >::iterator itr;
+    uint32_t                                   end;
+
+    if ((offset >= Size) || (size == 0) || (addition == 0))
+      return;
+
+    end = (size > Size - offset) ? Size : offset + size;
+
+    std::fill(
+      WasExecuted.begin() + offset, WasExecuted.begin() + end, true
+    );
+
+    // Update the counters of the instructions starting in the range.
+    itr = std::lower_bound(
+      Instructions.begin(), Instructions.end(), offset, instructionLess
+    );
+    for (; (itr != Instructions.end()) && (itr->offset < end); itr++)
+      saturatingAdd( itr->wasExecuted, addition );
   }
 
   bool CoverageMapBase::wasExecuted( uint32_t address ) const
   {
     uint32_t offset;
-    bool     result;
  
-    result = true;
-
-    if (determineOffset( address, &offset ) != true)
-      result = false;
-
-    if (Info[ offset ].wasExecuted <= 0)
-      result = false;
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
+      return false;
 
-    return result;
+    return WasExecuted[ offset ];
   }
 
   uint32_t CoverageMapBase::getWasExecuted( uint32_t address ) const
   {
-    uint32_t offset;
+    uint32_t                   offset;
+    const instructionInfo_t*   info;
+    counters_t::const_iterator counter;
 
-    if (determineOffset( address, &offset ) != true)
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return 0;
 
-    return Info[ offset ].wasExecuted;	
+    info = findInstruction( offset );
+    if (info)
+      return info->wasExecuted;
+
+    counter = Unmarked.find( offset );
+    if (counter != Unmarked.end())
+      return counter->second;
+
+    return WasExecuted[ offset ] ? 1 : 0;
   }
 
   void CoverageMapBase::setIsBranch(
@@ -241,20 +385,20 @@ namespace Coverage {
   {
     uint32_t offset;
  
-    if (determineOffset( address, &offset ) != true)
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return;
 
-    Info[ offset ].isBranch = true;
+    IsBranch[ offset ] = true;
   }
 
   bool CoverageMapBase::isNop( uint32_t address ) const
   {
     uint32_t offset;
  
-    if (determineOffset( address, &offset ) != true)
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return false;
 
-    return Info[ offset ].isNop;
+    return IsNop[ offset ];
   }
 
   void CoverageMapBase::setIsNop(
@@ -263,82 +407,49 @@ namespace Coverage {
   {
     uint32_t offset;
  
-    if (determineOffset( address, &offset ) != true)
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return;
 
-    Info[ offset ].isNop = true;
+    IsNop[ offset ] = true;
   }
 
   bool CoverageMapBase::isBranch( uint32_t address ) const
   {
     uint32_t offset;
  
-    if (determineOffset( address, &offset ) != true)
+    if ((determineOffset( address, &offset ) != true) || (offset >= Size))
       return false;
 
-    return Info[ offset ].isBranch;
+    return IsBranch[ offset ];
   }
 
   void CoverageMapBase::setWasTaken(
     uint32_t    address
   )
   {
-    uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
-      return;
-
-    Info[ offset ].wasTaken += 1;
+    sumWasTaken( address, 1 );
   }
 
   void CoverageMapBase::setWasNotTaken(
     uint32_t    address
   )
   {
-    uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
-      return;
-
-    Info[ offset ].wasNotTaken += 1;
+    sumWasNotTaken( address, 1 );
   }
 
   bool CoverageMapBase::wasAlwaysTaken( uint32_t address ) const
   {
-    uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
-      return false;
-
-    return (Info[ offset ].wasTaken &&
-            !Info[ offset ].wasNotTaken);
+    return (getWasTaken( address ) && !getWasNotTaken( address ));
   }
 
   bool CoverageMapBase::wasNeverTaken( uint32_t address ) const
   {
-    uint32_t offset;
- 
-    if (determineOffset( address, &offset ) != true)
-      return false;
-
-    return (!Info[ offset ].wasTaken &&
-            Info[ offset ].wasNotTaken);
+    return (!getWasTaken( address ) && getWasNotTaken( address ));
   }
 
   bool CoverageMapBase::wasNotTaken( uint32_t address ) const
   {
-	    uint32_t offset;
-	    bool     result;
-
-	    result = true;
-
-	    if (determineOffset( address, &offset ) != true)
-	      result = false;
-
-	    if (Info[ offset ].wasNotTaken <= 0)
-	      result = false;
-
-	    return result;
+    return getWasNotTaken( address ) > 0;
   }
 
   void CoverageMapBase::sumWasNotTaken( uint32_t address, uint32_t addition)
@@ -348,52 +459,77 @@ namespace Coverage {
     if (determineOffset( address, &offset ) != true)
       return;
 
-    Info[ offset ].wasNotTaken += addition;
+    sumWasNotTakenAtOffset( offset, addition );
+  }
+
+  void CoverageMapBase::sumWasNotTakenAtOffset(
+    uint32_t offset,
+    uint32_t addition
+  )
+  {
+    branchInfo_t empty = { 0, 0 };
+
+    if ((offset >= Size) || (addition == 0))
+      return;
+
+    saturatingAdd(
+      Branches.insert( std::make_pair( offset, empty ) ).first->second.wasNotTaken,
+      addition
+    );
   }
 
   uint32_t CoverageMapBase::getWasNotTaken( uint32_t address ) const
   {
-    uint32_t offset;
+    uint32_t            offset;
+    const branchInfo_t* branch;
 
     if (determineOffset( address, &offset ) != true)
       return 0;
 
-    return Info[ offset ].wasNotTaken;
+    branch = findBranch( offset );
+    return branch ? branch->wasNotTaken : 0;
   }
 
   bool CoverageMapBase::wasTaken( uint32_t address ) const
+  {
+    return getWasTaken( address ) > 0;
+  }
+
+  void CoverageMapBase::sumWasTaken( uint32_t address, uint32_t addition)
   {
     uint32_t offset;
-    bool     result;
 
-    result = true;
- 
     if (determineOffset( address, &offset ) != true)
-      result = false;
-
-    if (Info[ offset ].wasTaken <= 0)
-      result = false;
+      return;
 
-    return result;
+    sumWasTakenAtOffset( offset, addition );
   }
 
-  void CoverageMapBase::sumWasTaken( uint32_t address, uint32_t addition)
+  void CoverageMapBase::sumWasTakenAtOffset(
+    uint32_t offset,
+    uint32_t addition
+  )
   {
-    uint32_t offset;
+    branchInfo_t empty = { 0, 0 };
 
-    if (determineOffset( address, &offset ) != true)
+    if ((offset >= Size) || (addition == 0))
       return;
 
-    Info[ offset ].wasTaken += addition;
+    saturatingAdd(
+      Branches.insert( std::make_pair( offset, empty ) ).first->second.wasTaken,
+      addition
+    );
   }
 
   uint32_t CoverageMapBase::getWasTaken( uint32_t address ) const
   {
-    uint32_t offset;
+    uint32_t            offset;
+    const branchInfo_t* branch;
 
     if (determineOffset( address, &offset ) != true)
       return 0;
 
-    return Info[ offset ].wasTaken;
+    branch = findBranch( offset );
+    return branch ? branch->wasTaken : 0;
   }
 }
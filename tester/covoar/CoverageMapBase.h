@@ -10,6 +10,8 @@
 #include <stdint.h>
 #include <string>
 #include <list>
+#include <map>
+#include <vector>
 
 namespace Coverage {
 
@@ -152,7 +154,9 @@ namespace Coverage {
 
     /*!
      *  This method sets the boolean which indicates if this
-     *  is the starting address for an instruction.
+     *  is the starting address for an instruction.  The execution
+     *  and branch counters already kept for the address are not
+     *  changed.
      *
      *  @param[in] address specifies the address of the start of an instruction
      */
@@ -171,6 +175,17 @@ namespace Coverage {
      */
     bool isStartOfInstruction( uint32_t address ) const;
 
+    /*!
+     *  This method returns a boolean which indicates if the specified
+     *  offset into the coverage map is the start of an instruction.
+     *
+     *  @param[in] offset specifies the offset to check
+     *
+     *  @return Returns TRUE if the specified offset is the start
+     *   of an instruction and FALSE otherwise.
+     */
+    bool isStartOfInstructionAtOffset( uint32_t offset ) const;
+
     /*!
      *  This method increments the counter which indicates how many times
      *  the instruction at the specified address was executed.
@@ -190,6 +205,15 @@ namespace Coverage {
      */
     bool wasExecuted( uint32_t address ) const;
 
+    /*!
+     *  This method marks the specified address as executed without
+     *  changing any execution counter.  It is used when merging the
+     *  bytes inside an instruction.
+     *
+     *  @param[in] address specifies the address which was executed
+     */
+    void markWasExecuted( uint32_t address );
+
     /*!
      *  This method increases the counter which indicates how many times
      *  the instruction at the specified address was executed. It is used
@@ -201,6 +225,35 @@ namespace Coverage {
      */
     virtual void sumWasExecuted( uint32_t address, uint32_t addition );
 
+    /*!
+     *  This method increases the counter which indicates how many times
+     *  the instruction at the specified offset into the coverage map
+     *  was executed.  It is used when the offset is already known and
+     *  avoids searching the address ranges.
+     *
+     *  @param[in] offset specifies the offset which was executed
+     *  @param[in] addition specifies the execution count that should be
+     *             added
+     */
+    void sumWasExecutedAtOffset( uint32_t offset, uint32_t addition );
+
+    /*!
+     *  This method increases the execution counters of every instruction
+     *  in the specified range of offsets into the coverage map and marks
+     *  each address in the range as executed.  The addresses in the range
+     *  that are not instruction starts only have their executed bit set.
+     *
+     *  @param[in] offset specifies the first offset which was executed
+     *  @param[in] size specifies the number of bytes executed
+     *  @param[in] addition specifies the execution count that should be
+     *             added
+     */
+    void sumWasExecutedInRange(
+      uint32_t offset,
+      uint32_t size,
+      uint32_t addition
+    );
+
     /*!
      *  This method returns an unsigned integer which indicates how often
      *  the instruction at the specified address was executed.
@@ -268,6 +321,15 @@ namespace Coverage {
      */
     virtual void sumWasTaken( uint32_t address, uint32_t addition );
 
+    /*!
+     *  This method increases the counter which indicates how many times
+     *  the branch at the specified offset into the coverage map was taken.
+     *
+     *  @param[in] offset specifies the offset of the branch instruction
+     *  @param[in] addition specifies the count that should be added
+     */
+    void sumWasTakenAtOffset( uint32_t offset, uint32_t addition );
+
     /*!
      *  This method returns an unsigned integer which indicates how often
      *  the branch at the specified address was taken.
@@ -297,6 +359,16 @@ namespace Coverage {
      */
     virtual void sumWasNotTaken( uint32_t address, uint32_t addition );
 
+    /*!
+     *  This method increases the counter which indicates how many times
+     *  the branch at the specified offset into the coverage map was
+     *  not taken.
+     *
+     *  @param[in] offset specifies the offset of the branch instruction
+     *  @param[in] addition specifies the count that should be added
+     */
+    void sumWasNotTakenAtOffset( uint32_t offset, uint32_t addition );
+
     /*!
      *  This method returns an unsigned integer which indicates how often
      *  the branch at the specified address was not taken.
@@ -355,38 +427,89 @@ namespace Coverage {
   protected:
 
     /*!
-     *  This structure defines the information that is gathered and
-     *  tracked per address.
+     *  This structure defines the execution counter that is kept
+     *  for each instruction.
      */
     typedef struct {
       /*!
-       *  This member indicates that the address is the start of
-       *  an instruction.
+       *  This member contains the offset of the start of the instruction.
        */
-      bool isStartOfInstruction;
+      uint32_t offset;
       /*!
-       *  This member indicates how many times the address was executed.
+       *  This member indicates how many times the instruction was executed.
        */
       uint32_t wasExecuted;
+    } instructionInfo_t;
+
+    /*!
+     *  This structure defines the counters that are kept for each
+     *  branch instruction that was taken or not taken.
+     */
+    typedef struct {
       /*!
-       *  This member indicates that the address is a branch instruction.
-       */
-      bool isBranch;
-      /*!
-       *  This member indicates that the address is a NOP instruction.
-       */
-      bool isNop;
-      /*!
-       *  When isBranch is TRUE, this member indicates that the branch
-       *  instruction at the address was taken.
+       *  This member indicates how many times the branch instruction
+       *  was taken.
        */
       uint32_t wasTaken;
       /*!
-       *  When isBranch is TRUE, this member indicates that the branch
-       *  instruction at the address was NOT taken.
+       *  This member indicates how many times the branch instruction
+       *  was NOT taken.
        */
       uint32_t wasNotTaken;
-    } perAddressInfo_t;
+    } branchInfo_t;
+
+    /*!
+     *  This type defines the branch counters indexed by offset.
+     */
+    typedef std::map< uint32_t, branchInfo_t > branches_t;
+
+    /*!
+     *  This type holds execution counters keyed by offset.
+     */
+    typedef std::map< uint32_t, uint32_t > counters_t;
+
+    /*!
+     *  This method returns the execution counter of the instruction
+     *  starting at the specified offset.
+     *
+     *  @param[in] offset specifies the offset of the instruction
+     *
+     *  @return Returns a pointer to the counter or NULL if no
+     *   instruction starts at the offset.
+     */
+    const instructionInfo_t* findInstruction( uint32_t offset ) const;
+
+    /*!
+     *  This method returns the branch counters kept at the specified
+     *  offset.
+     *
+     *  @param[in] offset specifies the offset of the branch instruction
+     *
+     *  @return Returns a pointer to the counters or NULL if the branch
+     *   was neither taken nor not taken.
+     */
+    const branchInfo_t* findBranch( uint32_t offset ) const;
+
+    /*!
+     *  This method orders instruction counters by offset.
+     *
+     *  @param[in] lhs specifies the instruction counter to compare
+     *  @param[in] offset specifies the offset to compare against
+     *
+     *  @return Returns TRUE if the counter is below the offset.
+     */
+    static bool instructionLess(
+      const instructionInfo_t& lhs,
+      uint32_t                 offset
+    );
+
+    /*!
+     *  This method adds to a counter without wrapping around.
+     *
+     *  @param[in] counter specifies the counter to increase
+     *  @param[in] addition specifies the amount to add
+     */
+    static void saturatingAdd( uint32_t& counter, uint32_t addition );
 
     /*!
      * 
@@ -401,10 +524,51 @@ namespace Coverage {
     uint32_t Size;
 
     /*!
-     *  This is a dynamically allocated array of data that is
-     *  kept for each address.
+     *  This is a bit per address which indicates that the address is
+     *  the start of an instruction.
+     */
+    std::vector< bool > IsStartOfInstruction;
+
+    /*!
+     *  This is a bit per address which indicates that the address was
+     *  executed.
+     */
+    std::vector< bool > WasExecuted;
+
+    /*!
+     *  This is a bit per address which indicates that the address is
+     *  a branch instruction.
+     */
+    std::vector< bool > IsBranch;
+
+    /*!
+     *  This is a bit per address which indicates that the address is
+     *  a NOP instruction.
+     */
+    std::vector< bool > IsNop;
+
+    /*!
+     *  This is the execution counter of each instruction start sorted
+     *  by offset.  Counters are only kept for instruction starts since
+     *  the other bytes of an instruction only need the executed bit.
+     */
+    std::vector< instructionInfo_t > Instructions;
+
+    /*!
+     *  This contains the execution counters of single addresses that
+     *  were executed before any instruction start of the map was
+     *  marked.  The counter moves to the instruction when the address
+     *  is marked.  Once the instructions are known the other addresses
+     *  are the inside of an instruction and only have the executed bit.
+     */
+    counters_t Unmarked;
+
+    /*!
+     *  This contains the taken and not taken counters of the branch
+     *  instructions that have been recorded.  Branches are a small
+     *  fraction of the code so the counters are kept sparsely.
      */
-    perAddressInfo_t* Info;
+    branches_t Branches;
   };
 
 }
@@ -7,9 +7,17 @@
 
 #include "covoar-config.h"
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#include <vector>
 
 #include "app_common.h"
 #include "CoverageReaderQEMU.h"
@@ -26,6 +34,28 @@
 
 namespace Coverage {
 
+  /*
+   *  Byte swap the fields of a trace written on a host of the other
+   *  endianness.
+   */
+  static uint16_t swap16( uint16_t value )
+  {
+    return (value >> 8) | (value << 8);
+  }
+
+  static uint32_t swap32( uint32_t value )
+  {
+    return ((uint32_t) swap16( value ) << 16) | swap16( value >> 16 );
+  }
+
+  static uint64_t swap64( uint64_t value )
+  {
+    return ((uint64_t) swap32( value ) << 32) | swap32( value >> 32 );
+  }
+
+  static uint64_t swapPC( uint32_t pc ) { return swap32( pc ); }
+  static uint64_t swapPC( uint64_t pc ) { return swap64( pc ); }
+
   CoverageReaderQEMU::CoverageReaderQEMU()
   {
     BranchInfoAvailable = true;
@@ -35,28 +65,129 @@ namespace Coverage {
   {
   }
 
+  /*
+   *  Record one trace entry in the coverage map containing it.
+   */
+  static void processEntry(
+    uint64_t              pc,
+    uint16_t              size,
+    uint8_t               op,
+    uint8_t               taken,
+    uint8_t               notTaken,
+    ExecutableInfo* const executableInformation
+  )
+  {
+    const ExecutableInfo::coverageMapRange_t* range;
+    CoverageMapBase*                          aCoverageMap;
+    uint32_t                                  offset;
+    uint32_t                                  last;
+
+    if ((pc > 0xffffffff) || (size == 0))
+      return;
+
+    // Obtain the coverage map range containing the block and the
+    // offset of the block into the coverage map.
+    range = executableInformation->findCoverageMapRange( pc );
+
+    // Ensure that coverage map exists.
+    if (!range)
+      return;
+
+    aCoverageMap = range->coverageMap;
+    offset = pc - range->lowAddress;
+    last = range->highAddress - range->lowAddress;
+    if ((uint32_t) (size - 1) < (last - offset))
+      last = offset + size - 1;
+
+    // Mark the block as fully executed.
+    if (op & TRACE_OP_BLOCK)
+      aCoverageMap->sumWasExecutedInRange( offset, last - offset + 1, 1 );
+
+    // Determine if additional branch information is available.
+    if ( (op & (taken | notTaken)) != 0 ) {
+      if (last != offset + size - 1) {
+        fprintf(
+          stderr,
+          "*** Trace block is inconsistent with coverage map\n"
+          "*** Trace block (0x%08x - 0x%08x) for %d bytes\n"
+          "*** Coverage map XXX \n",
+          (uint32_t) pc,
+          (uint32_t) (pc + size - 1),
+          size
+        );
+      } else {
+        while ((last > 0) &&
+               !aCoverageMap->isStartOfInstructionAtOffset( last ))
+          last--;
+        if (op & taken) {
+          aCoverageMap->sumWasTakenAtOffset( last, 1 );
+        } else if (op & notTaken) {
+          aCoverageMap->sumWasNotTakenAtOffset( last, 1 );
+        }
+      }
+    }
+  }
+
+  /*
+   *  Walk the trace entries in place.  The entries are copied out one
+   *  at a time since the trace data need not be aligned.
+   */
+  template <typename entry_t>
+  static void processEntries(
+    const uint8_t*        data,
+    size_t                size,
+    bool                  swap,
+    uint8_t               taken,
+    uint8_t               notTaken,
+    ExecutableInfo* const executableInformation
+  )
+  {
+    const uint8_t* end = data + (size - (size % sizeof(entry_t)));
+    entry_t        entry;
+
+    for (; data < end; data += sizeof(entry_t)) {
+      memcpy( &entry, data, sizeof(entry_t) );
+      if (swap)
+        processEntry(
+          swapPC( entry.pc ), swap16( entry.size ), entry.op,
+          taken, notTaken, executableInformation
+        );
+      else
+        processEntry(
+          entry.pc, entry.size, entry.op,
+          taken, notTaken, executableInformation
+        );
+    }
+  }
+
   void CoverageReaderQEMU::processFile(
     const char* const     file,
     ExecutableInfo* const executableInformation
   )
   {
-    struct trace_header header;
-    uintptr_t           i;
-    int                 status;
-    FILE*               traceFile;
-    uint8_t             taken;
-    uint8_t             notTaken;
-    uint8_t             branchInfo;
+    std::vector<uint8_t> buffer;
+    const uint8_t*       data = NULL;
+    struct trace_header  header;
+    bool                 hostBigEndian;
+    size_t               size = 0;
+    struct stat          statbuf;
+    int                  traceFile;
+    uint16_t             one = 1;
+    uint8_t              taken;
+    uint8_t              notTaken;
+#if HAVE_MMAP
+    void*                mapped = MAP_FAILED;
+#endif
 
     taken    = TargetInfo->qemuTakenBit();
     notTaken = TargetInfo->qemuNotTakenBit();
-    branchInfo = taken | notTaken;
 
     //
-    // Open the coverage file and read the header.
+    // Open the coverage file and map it.  If it cannot be mapped read
+    // all of it.
     //
-    traceFile = OPEN( file, "r" );
-    if (!traceFile) {
+    traceFile = open( file, O_RDONLY );
+    if ((traceFile < 0) || (fstat( traceFile, &statbuf ) != 0)) {
       fprintf(
         stderr,
         "ERROR: CoverageReaderQEMU::processFile - Unable to open %s\n",
@@ -65,8 +196,46 @@ namespace Coverage {
       exit( -1 );
     }
 
-    status = fread( &header, sizeof(trace_header), 1, traceFile );
-    if (status != 1) {
+#if HAVE_MMAP
+    if (S_ISREG( statbuf.st_mode ) && (statbuf.st_size > 0)) {
+      mapped = mmap(
+        NULL, statbuf.st_size, PROT_READ, MAP_PRIVATE, traceFile, 0
+      );
+      if (mapped != MAP_FAILED) {
+        data = (const uint8_t*) mapped;
+        size = statbuf.st_size;
+      }
+    }
+#endif
+    close( traceFile );
+
+    if (!data) {
+      FILE*  stream;
+      size_t length;
+
+      stream = OPEN( file, "r" );
+      if (!stream) {
+        fprintf(
+          stderr,
+          "ERROR: CoverageReaderQEMU::processFile - Unable to open %s\n",
+          file
+        );
+        exit( -1 );
+      }
+      buffer.resize( 64 * 1024 );
+      while (true) {
+        length = fread( &buffer[ size ], 1, buffer.size() - size, stream );
+        if (length == 0)
+          break;
+        size += length;
+        if (size == buffer.size())
+          buffer.resize( buffer.size() * 2 );
+      }
+      fclose( stream );
+      data = &buffer[0];
+    }
+
+    if (size < sizeof(trace_header)) {
       fprintf(
         stderr,
         "ERROR: CoverageReaderQEMU::processFile - "
@@ -76,6 +245,8 @@ namespace Coverage {
       exit( -1 );
     }
 
+    memcpy( &header, data, sizeof(trace_header) );
+
     #if 0
       fprintf(
         stderr,
@@ -95,75 +266,54 @@ namespace Coverage {
     #endif
 
     //
-    // Read ENTRIES number of trace entries.
+    // The trace entries use the byte order of the host QEMU ran on and
+    // the size of the target's PC.
     //
-#define ENTRIES 1024
-    while (1) {
-      CoverageMapBase     *aCoverageMap = NULL;
-      struct trace_entry  entries[ENTRIES];
-      struct trace_entry  *entry;
-      int                 num_entries;
-
-
-      // Read and process each line of the coverage file.
-      num_entries = fread(
-        entries,
-        sizeof(struct trace_entry),
-        ENTRIES,
-        traceFile
-      );
-      if (num_entries == 0)
-        break;
-
-      // Get the coverage map for each entry.  Note that the map is
-      // the same for each entry in the coverage map
-      for (int count=0; count<num_entries; count++) {
-
-        entry = &entries[count];
+    hostBigEndian = *((uint8_t*) &one) == 0;
 
-        // Mark block as fully executed.
-        // Obtain the coverage map containing the specified address.
-        aCoverageMap = executableInformation->getCoverageMap( entry->pc );
-
-        // Ensure that coverage map exists.
-        if (!aCoverageMap)
-          continue;
-
-        // Set was executed for each TRACE_OP_BLOCK
-        if (entry->op & TRACE_OP_BLOCK) {
-         for (i=0; i<entry->size; i++) {
-            aCoverageMap->setWasExecuted( entry->pc + i );
-          }
-        }
+    // Older trace-converters wrote 32 as the size and always said
+    // little endian. Their entries are 4 byte PCs in the host's byte
+    // order, which is how they were read.
+    if (header.sizeof_target_pc == 32) {
+      header.sizeof_target_pc = 4;
+      header.big_endian = hostBigEndian;
+    }
 
-        // Determine if additional branch information is available.
-        if ( (entry->op & branchInfo) != 0 ) {
-          uint32_t  offset_e, offset_a;
-          uint32_t  a = entry->pc + entry->size - 1;
-          if ((aCoverageMap->determineOffset( a, &offset_a ) != true)   ||
-             (aCoverageMap->determineOffset( entry->pc, &offset_e ) != true))
-          {
-            fprintf(
-              stderr,
-              "*** Trace block is inconsistent with coverage map\n"
-              "*** Trace block (0x%08x - 0x%08x) for %d bytes\n"
-              "*** Coverage map XXX \n",
-              entry->pc,
-              a,
-              entry->size
-            );
-          } else {
-            while (!aCoverageMap->isStartOfInstruction(a))
-              a--;
-            if (entry->op & taken) {
-              aCoverageMap->setWasTaken( a );
-            } else if (entry->op & notTaken) {
-              aCoverageMap->setWasNotTaken( a );
-            }
-          }
-        }
-      }
+    switch (header.sizeof_target_pc) {
+      case 4:
+        processEntries<trace_entry32>(
+          data + sizeof(trace_header),
+          size - sizeof(trace_header),
+          (header.big_endian != 0) != hostBigEndian,
+          taken,
+          notTaken,
+          executableInformation
+        );
+        break;
+      case 8:
+        processEntries<trace_entry64>(
+          data + sizeof(trace_header),
+          size - sizeof(trace_header),
+          (header.big_endian != 0) != hostBigEndian,
+          taken,
+          notTaken,
+          executableInformation
+        );
+        break;
+      default:
+        fprintf(
+          stderr,
+          "ERROR: CoverageReaderQEMU::processFile - "
+          "Unsupported target PC size %d in %s\n",
+          header.sizeof_target_pc,
+          file
+        );
+        exit( -1 );
     }
-    fclose( traceFile );
+
+#if HAVE_MMAP
+    if (mapped != MAP_FAILED)
+      munmap( mapped, size );
+#endif
   }
 }
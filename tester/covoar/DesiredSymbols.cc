@@ -12,6 +12,9 @@
 #include <string.h>
 #include <unistd.h>
 
+#include <rld.h>
+#include <rld-process.h>
+
 #include "DesiredSymbols.h"
 #include "app_common.h"
 #include "CoverageMap.h"
@@ -417,18 +420,43 @@ namespace Coverage {
     char*                              cStatus;
     char                               command[512];
     std::string                        fileName;
+    AddressToLineMapper*               mapper;
     CoverageRanges::ranges_t::iterator ritr;
     char                               rpath[PATH_MAX];
     FILE*                              tmpfile;
 
+    // Resolve the ranges in memory if the line information of the
+    // executable can be decoded.
+    mapper = theExecutable->getAddressToLineMapper();
+    if (mapper) {
+      for (ritr =  theRanges->set.begin();
+           ritr != theRanges->set.end();
+           ritr++ ) {
+        mapper->getSourceLine(
+          ritr->lowAddress - theExecutable->getLoadAddress(),
+          ritr->lowSourceLine
+        );
+        mapper->getSourceLine(
+          ritr->highAddress - theExecutable->getLoadAddress(),
+          ritr->highSourceLine
+        );
+      }
+      return;
+    }
+
+    // Otherwise use addr2line.  The temporary files have unique names
+    // so instances of covoar can share a working directory.
+    rld::process::tempfile addresses( ".ranges" );
+    rld::process::tempfile sourceLines( ".lines" );
+
     // Open a temporary file for the uncovered ranges.
-    tmpfile = fopen( "ranges1.tmp", "w" );
+    tmpfile = fopen( addresses.name().c_str(), "w" );
     if ( !tmpfile ) {
       fprintf(
         stderr,
         "ERROR: DesiredSymbols::determineSourceLines - "
         "unable to open %s\n",
-        "ranges1.tmp"
+        addresses.name().c_str()
       );
       exit(-1);
     }
@@ -453,13 +481,14 @@ namespace Coverage {
     else
       fileName = theExecutable->getFileName();
 
-    sprintf(
+    snprintf(
       command,
+      sizeof( command ),
       "%s -Ce %s <%s | dos2unix >%s",
       TargetInfo->getAddr2line(),
       fileName.c_str(),
-      "ranges1.tmp",
-      "ranges2.tmp"
+      addresses.name().c_str(),
+      sourceLines.name().c_str()
     );
 
     if (system( command )) {
@@ -473,13 +502,13 @@ namespace Coverage {
     }
 
     // Open the addr2line output file.
-    tmpfile = fopen( "ranges2.tmp", "r" );
+    tmpfile = fopen( sourceLines.name().c_str(), "r" );
     if ( !tmpfile ) {
       fprintf(
         stderr,
         "ERROR: DesiredSymbols::determineSourceLines - "
         "unable to open %s\n",
-        "ranges2.tmp"
+        sourceLines.name().c_str()
       );
       exit(-1);
     }
@@ -528,8 +557,6 @@ namespace Coverage {
     }
 
     fclose( tmpfile );
-    unlink( "ranges1.tmp" );
-    unlink( "ranges2.tmp" );
   }
 
   SymbolInformation* DesiredSymbols::find(
@@ -675,13 +702,16 @@ namespace Coverage {
 
       sAddress = dAddress + sBaseAddress;
 
-      // Merge start of instruction indication.
-      if (sourceCoverageMap->isStartOfInstruction( sAddress ))
+      // Merge start of instruction indication and the execution data.
+      // Only an instruction start has a counter, the bytes inside an
+      // instruction only have their executed bit merged.
+      if (sourceCoverageMap->isStartOfInstruction( sAddress )) {
         destinationCoverageMap->setIsStartOfInstruction( dAddress );
-
-      // Merge the execution data.
-      executionCount = sourceCoverageMap->getWasExecuted( sAddress );
-      destinationCoverageMap->sumWasExecuted( dAddress, executionCount );
+        executionCount = sourceCoverageMap->getWasExecuted( sAddress );
+        destinationCoverageMap->sumWasExecuted( dAddress, executionCount );
+      }
+      else if (sourceCoverageMap->wasExecuted( sAddress ))
+        destinationCoverageMap->markWasExecuted( dAddress );
 
       // Merge the branch data.
       executionCount = sourceCoverageMap->getWasTaken( sAddress );
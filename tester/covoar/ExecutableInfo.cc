@@ -6,6 +6,7 @@
  */
 
 #include <stdio.h>
+#include <algorithm>
 
 #include "ExecutableInfo.h"
 #include "app_common.h"
@@ -26,12 +27,17 @@ namespace Coverage {
     if (theLibraryName)
       libraryName = theLibraryName;
     theSymbolTable = new SymbolTable();
+    theLineMapper = NULL;
+    lineMapperLoaded = false;
+    coverageMapIndexBuilt = false;
   }
 
   ExecutableInfo::~ExecutableInfo()
   {
     if (theSymbolTable)
       delete theSymbolTable;
+    if (theLineMapper)
+      delete theLineMapper;
   }
 
   void ExecutableInfo::dumpCoverageMaps( void ) {
@@ -53,9 +59,15 @@ namespace Coverage {
 
   CoverageMapBase* ExecutableInfo::getCoverageMap ( uint32_t address )
   {
-    CoverageMapBase*         aCoverageMap = NULL;
-    coverageMaps_t::iterator it;
-    std::string              itsSymbol;
+    CoverageMapBase*          aCoverageMap = NULL;
+    coverageMaps_t::iterator  it;
+    std::string               itsSymbol;
+    const coverageMapRange_t* range;
+
+    if (coverageMapIndexBuilt) {
+      range = findCoverageMapRange( address );
+      return range ? range->coverageMap : NULL;
+    }
 
     // Obtain the coverage map containing the specified address.
     itsSymbol = theSymbolTable->getSymbol( address );
@@ -67,6 +79,68 @@ namespace Coverage {
     return aCoverageMap;
   }
 
+  AddressToLineMapper* ExecutableInfo::getAddressToLineMapper( void )
+  {
+    if (!lineMapperLoaded) {
+      lineMapperLoaded = true;
+      theLineMapper = new AddressToLineMapper();
+      if (!theLineMapper->load(
+            hasDynamicLibrary() ? libraryName : executableName
+          )) {
+        delete theLineMapper;
+        theLineMapper = NULL;
+      }
+    }
+
+    return theLineMapper;
+  }
+
+  /*
+   *  Order coverage map ranges by low address.
+   */
+  static bool coverageMapRangeLess(
+    const ExecutableInfo::coverageMapRange_t& lhs,
+    const ExecutableInfo::coverageMapRange_t& rhs
+  )
+  {
+    return lhs.lowAddress < rhs.lowAddress;
+  }
+
+  const ExecutableInfo::coverageMapRange_t* ExecutableInfo::findCoverageMapRange(
+    uint32_t address
+  ) const
+  {
+    std::vector<coverageMapRange_t>::const_iterator itr;
+    coverageMapRange_t                              key;
+
+    // Find the last range starting at or below the address.
+    key.lowAddress = address;
+    itr = std::upper_bound(
+      coverageMapIndex.begin(),
+      coverageMapIndex.end(),
+      key,
+      coverageMapRangeLess
+    );
+    if (itr == coverageMapIndex.begin())
+      return NULL;
+    itr--;
+
+    if (address > itr->highAddress)
+      return NULL;
+
+    return &(*itr);
+  }
+
+  void ExecutableInfo::buildCoverageMapIndex( void )
+  {
+    std::stable_sort(
+      coverageMapIndex.begin(),
+      coverageMapIndex.end(),
+      coverageMapRangeLess
+    );
+    coverageMapIndexBuilt = true;
+  }
+
   std::string ExecutableInfo::getFileName ( void ) const
   {
     return executableName;
@@ -96,6 +170,7 @@ namespace Coverage {
   {
     CoverageMapBase                          *theMap;
     ExecutableInfo::coverageMaps_t::iterator  itr;
+    coverageMapRange_t                        range;
 
     itr = coverageMaps.find( symbolName );
     if ( itr == coverageMaps.end() ) {
@@ -105,6 +180,13 @@ namespace Coverage {
       theMap = itr->second;
       theMap->Add( lowAddress, highAddress );
     }
+
+    range.lowAddress  = lowAddress;
+    range.highAddress = highAddress;
+    range.coverageMap = theMap;
+    coverageMapIndex.push_back( range );
+    coverageMapIndexBuilt = false;
+
     return theMap;
   }
 
@@ -10,7 +10,9 @@
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <vector>
 
+#include "AddressToLineMapper.h"
 #include "CoverageMapBase.h"
 #include "SymbolTable.h"
 
@@ -25,6 +27,26 @@ namespace Coverage {
 
   public:
 
+    /*!
+     *  This structure identifies an address range of a coverage map.
+     */
+    typedef struct {
+      /*!
+       *  This is the low address of the range.
+       */
+      uint32_t lowAddress;
+
+      /*!
+       *  This is the high address of the range.
+       */
+      uint32_t highAddress;
+
+      /*!
+       *  This is the coverage map the range belongs to.
+       */
+      CoverageMapBase* coverageMap;
+    } coverageMapRange_t;
+
     /*!
      *  This method constructs an ExecutableInfo instance.
      *
@@ -62,6 +84,36 @@ namespace Coverage {
      */
     CoverageMapBase* getCoverageMap( uint32_t address );
 
+    /*!
+     *  This method returns the address range of the coverage map
+     *  that contains the specified address.  The offset of the address
+     *  into the coverage map is the address minus the range's low
+     *  address.  The coverage map index must have been built.
+     *
+     *  @param[in] address specifies the desired address
+     *
+     *  @return Returns a pointer to the range or NULL if no coverage
+     *   map contains the address.
+     */
+    const coverageMapRange_t* findCoverageMapRange( uint32_t address ) const;
+
+    /*!
+     *  This method builds the index from address to coverage map.  It
+     *  is called once all coverage maps of the executable have been
+     *  created.
+     */
+    void buildCoverageMapIndex( void );
+
+    /*!
+     *  This method returns a pointer to the index from address to
+     *  source line for the executable or its dynamic library.  The
+     *  index is built the first time it is requested.
+     *
+     *  @return Returns a pointer to the index or NULL if the file has
+     *   no usable line number information.
+     */
+    AddressToLineMapper* getAddressToLineMapper( void );
+
     /*!
      *  This method returns the file name of the executable.
      *
@@ -135,6 +187,18 @@ namespace Coverage {
     typedef std::map<std::string, CoverageMapBase *> coverageMaps_t;
     coverageMaps_t coverageMaps;
 
+    /*!
+     *  This member variable contains the address range of each coverage
+     *  map sorted by low address.
+     */
+    std::vector<coverageMapRange_t> coverageMapIndex;
+
+    /*!
+     *  This member variable indicates that coverageMapIndex is sorted
+     *  and may be searched.
+     */
+    bool coverageMapIndexBuilt;
+
     /*!
      *  This member variable contains the name of the executable.
      */
@@ -158,6 +222,18 @@ namespace Coverage {
      */
     SymbolTable* theSymbolTable;
 
+    /*!
+     *  This member variable contains a pointer to the index from
+     *  address to source line of the executable or library.
+     */
+    AddressToLineMapper* theLineMapper;
+
+    /*!
+     *  This member variable indicates an attempt has been made to
+     *  build the index from address to source line.
+     */
+    bool lineMapperLoaded;
+
   };
 }
 #endif
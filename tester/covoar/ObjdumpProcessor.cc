@@ -12,9 +12,16 @@
 #include <stdlib.h>
 #include <string.h>
 #include <algorithm>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
+
+#include <rld.h>
 
 #include "app_common.h"
+#include "AnalysisCache.h"
 #include "ObjdumpProcessor.h"
 #include "CoverageMap.h"
 #include "ExecutableInfo.h"
@@ -23,19 +30,79 @@
 
 namespace Coverage {
 
+  /*
+   *  These serialize the parts of loading an executable that are not
+   *  safe to run on more than one thread.
+   */
+  static std::mutex elfMutex;
+  static std::mutex objdumpMutex;
+
+  /*
+   *  A library's dump file is shared by its executables so each dump
+   *  file has a lock held while it is generated. The map is protected
+   *  by objdumpMutex.
+   */
+  static std::map<std::string, std::shared_ptr<std::mutex> > dumpMutexes;
+
+  /*
+   *  Add the instructions and unified coverage map of a symbol to the
+   *  set of desired symbols.  The first executable to provide the
+   *  instructions of a symbol is the one used in the reports.
+   */
+  static void publishSymbol(
+    ExecutableInfo* const             executableInfo,
+    const std::string&                symbolName,
+    uint32_t                          lowAddress,
+    uint32_t                          size,
+    ObjdumpProcessor::objdumpLines_t& instructions
+  ) {
+    SymbolInformation* symbolInfo = NULL;
+
+    // If there are NOT already saved instructions, save them.
+    symbolInfo = SymbolsToAnalyze->find( symbolName );
+    if (symbolInfo->instructions.empty()) {
+      symbolInfo->sourceFile = executableInfo;
+      symbolInfo->baseAddress = lowAddress;
+      symbolInfo->instructions.swap( instructions );
+    }
+
+    // Create a unified coverage map for the symbol.
+    SymbolsToAnalyze->createCoverageMap( symbolName, size );
+  }
+
+  /*
+   *  Add a symbol found while loading an executable to the list of
+   *  symbols to finalize.
+   */
+  static void addSymbol(
+    ObjdumpProcessor::objdumpSymbols_t& symbols,
+    const std::string&                  symbolName,
+    uint32_t                            lowAddress,
+    uint32_t                            highAddress,
+    ObjdumpProcessor::objdumpLines_t&   instructions
+  ) {
+    ObjdumpProcessor::objdumpSymbol_t symbol;
+
+    symbols.push_back( symbol );
+    symbols.back().symbolName = symbolName;
+    symbols.back().lowAddress = lowAddress;
+    symbols.back().highAddress = highAddress;
+    symbols.back().instructions.swap( instructions );
+  }
+
   void finalizeSymbol(
-    ExecutableInfo* const            executableInfo,
-    std::string&                     symbolName,
-    uint32_t                         lowAddress,
-    uint32_t                         highAddress,
-    ObjdumpProcessor::objdumpLines_t instructions
+    ExecutableInfo* const                     executableInfo,
+    std::string&                              symbolName,
+    uint32_t                                  lowAddress,
+    uint32_t                                  highAddress,
+    ObjdumpProcessor::objdumpLines_t&         instructions,
+    ObjdumpProcessor::pendingSymbols_t* const pending
   ) {
 
     CoverageMapBase*                                   aCoverageMap = NULL;
     uint32_t                                           endAddress = highAddress;
     ObjdumpProcessor::objdumpLines_t::iterator         itr, fnop, lnop;
     ObjdumpProcessor::objdumpLines_t::reverse_iterator ritr;
-    SymbolInformation*                                 symbolInfo = NULL;
     SymbolTable*                                       theSymbolTable;
 
     //
@@ -81,14 +148,6 @@ namespace Coverage {
         instructions.erase( fnop, ++lnop );
     }
 
-    // If there are NOT already saved instructions, save them.
-    symbolInfo = SymbolsToAnalyze->find( symbolName );
-    if (symbolInfo->instructions.empty()) {
-      symbolInfo->sourceFile = executableInfo;
-      symbolInfo->baseAddress = lowAddress;
-      symbolInfo->instructions = instructions;
-    }
-
     // Add the symbol to this executable's symbol table.
     theSymbolTable = executableInfo->getSymbolTable();
     theSymbolTable->addSymbol(
@@ -110,10 +169,24 @@ namespace Coverage {
         aCoverageMap->setIsStartOfInstruction( itr->address );
       }
 
-      // Create a unified coverage map for the symbol.
-      SymbolsToAnalyze->createCoverageMap(
-        symbolName, endAddress - lowAddress + 1
-      );
+      // Either update the desired symbols now or leave it to publish().
+      if (pending) {
+        ObjdumpProcessor::pendingSymbol_t symbol;
+
+        pending->push_back( symbol );
+        pending->back().symbolName = symbolName;
+        pending->back().lowAddress = lowAddress;
+        pending->back().size = endAddress - lowAddress + 1;
+        pending->back().instructions.swap( instructions );
+      }
+      else
+        publishSymbol(
+          executableInfo,
+          symbolName,
+          lowAddress,
+          endAddress - lowAddress + 1,
+          instructions
+        );
     }
   }
 
@@ -232,12 +305,23 @@ namespace Coverage {
 
   FILE* ObjdumpProcessor::getFile( std::string fileName ) 
   {
-    char               dumpFile[128];
-    FILE*              objdumpFile;
-    char               buffer[ 512 ];
-    int                status;
+    char                        dumpFile[128];
+    FILE*                       objdumpFile;
+    char                        buffer[ 512 ];
+    int                         status;
+    std::shared_ptr<std::mutex> dumpMutex;
 
     sprintf( dumpFile, "%s.dmp", fileName.c_str() );
+
+    {
+      std::lock_guard<std::mutex> lock( objdumpMutex );
+      std::shared_ptr<std::mutex>& m = dumpMutexes[ dumpFile ];
+      if (!m)
+        m.reset( new std::mutex );
+      dumpMutex = m;
+    }
+
+    std::lock_guard<std::mutex> dumpLock( *dumpMutex );
       
     // Generate the objdump.
     if (FileIsNewer( fileName.c_str(), dumpFile )) {
@@ -336,10 +420,270 @@ namespace Coverage {
   }
 
   void ObjdumpProcessor::load(
-    ExecutableInfo* const executableInformation
+    ExecutableInfo* const   executableInformation,
+    pendingSymbols_t* const pending
+  )
+  {
+    AnalysisCache               cache( AnalysisCacheDirectory );
+    bool                        cached = false;
+    bool                        loaded = false;
+    objdumpSymbols_t            symbols;
+    objdumpSymbols_t::iterator  itr;
+
+    if (AnalysisCacheDirectory)
+      cached = cache.read( executableInformation, symbols );
+
+    if (!cached) {
+      if (!UseObjdump && TargetInfo->hasInstructionDecoder()) {
+        loaded = loadFromElf( executableInformation, symbols );
+        if (!loaded)
+          fprintf(
+            stderr,
+            "WARNING: ObjdumpProcessor::load - unable to decode %s, "
+            "falling back to objdump\n",
+            executableInformation->getFileName().c_str()
+          );
+      }
+
+      if (!loaded)
+        loadFromObjdump( executableInformation, symbols );
+
+      if (AnalysisCacheDirectory)
+        cache.write( executableInformation, symbols );
+    }
+
+    for (itr = symbols.begin(); itr != symbols.end(); itr++) {
+      finalizeSymbol(
+        executableInformation,
+        itr->symbolName,
+        itr->lowAddress,
+        itr->highAddress,
+        itr->instructions,
+        pending
+      );
+    }
+
+    // All coverage maps of the executable exist so index them.
+    executableInformation->buildCoverageMapIndex();
+  }
+
+  void ObjdumpProcessor::publish(
+    ExecutableInfo* const executableInformation,
+    pendingSymbols_t&     pending
+  )
+  {
+    pendingSymbols_t::iterator itr;
+
+    for (itr = pending.begin(); itr != pending.end(); itr++) {
+      publishSymbol(
+        executableInformation,
+        itr->symbolName,
+        itr->lowAddress,
+        itr->size,
+        itr->instructions
+      );
+    }
+    pending.clear();
+  }
+
+  bool ObjdumpProcessor::loadFromElf(
+    ExecutableInfo* const executableInformation,
+    objdumpSymbols_t&     symbols
+  )
+  {
+    typedef std::map<uint32_t, std::string> textSymbols_t;
+
+    bool                              bigEndian;
+    std::vector<uint8_t>              code;
+    std::string                       fileName;
+    Target::TargetBase::instruction_t instruction;
+    char                              line[ MAX_LINE_LENGTH ];
+    uint32_t                          loadAddress;
+    textSymbols_t::iterator           sitr;
+    uint32_t                          textAddress;
+    textSymbols_t                     textSymbols;
+
+    if (!executableInformation->hasDynamicLibrary())
+      fileName = executableInformation->getFileName();
+    else
+      fileName = executableInformation->getLibraryName();
+
+    loadAddress = executableInformation->getLoadAddress();
+
+    //
+    // Read the .text section and the symbols that label it. Nothing is
+    // held open once the code and names have been copied out.
+    //
+    try {
+      // The rld and libelf state shared by all files is not protected.
+      std::lock_guard<std::mutex> lock( elfMutex );
+      rld::files::object     exe( fileName );
+      rld::files::sections   secs;
+      rld::symbols::pointers syms;
+
+      exe.open();
+      exe.begin();
+
+      if (!exe.valid()) {
+        exe.close();
+        return false;
+      }
+
+      exe.get_sections( secs, ".text" );
+      if (secs.size() != 1) {
+        exe.end();
+        exe.close();
+        return false;
+      }
+
+      const rld::files::section& text = secs.front();
+
+      textAddress = text.address;
+      bigEndian = exe.elf().data_type() == ELFDATA2MSB;
+
+      code.resize( text.size );
+      if (!code.empty() && !exe.seek_read( text.offset, &code[0], text.size )) {
+        exe.end();
+        exe.close();
+        return false;
+      }
+
+      // Where more than one symbol labels an address prefer a desired
+      // symbol. Section, file and mapping symbols are not labels.
+      exe.elf().get_symbols( syms, false, true, true, true );
+      for (rld::symbols::pointers::iterator pitr = syms.begin();
+           pitr != syms.end();
+           pitr++) {
+        const rld::symbols::symbol& sym = *(*pitr);
+
+        if ((sym.section_index() != text.index) ||
+            (sym.type() == STT_SECTION) ||
+            (sym.type() == STT_FILE) ||
+            sym.name().empty() ||
+            (sym.name()[0] == '$'))
+          continue;
+
+        const std::string& name =
+          sym.is_cplusplus() ? sym.demangled() : sym.name();
+
+        sitr = textSymbols.find( sym.value() );
+        if (sitr == textSymbols.end())
+          textSymbols[ sym.value() ] = name;
+        else if (!SymbolsToAnalyze->isDesired( sitr->second ) &&
+                 SymbolsToAnalyze->isDesired( name ))
+          sitr->second = name;
+      }
+
+      exe.end();
+      exe.close();
+    }
+    catch (rld::error re) {
+      fprintf(
+        stderr,
+        "WARNING: ObjdumpProcessor::loadFromElf - %s: %s\n",
+        re.where.c_str(),
+        re.what.c_str()
+      );
+      return false;
+    }
+
+    //
+    // Decode each desired symbol. A symbol extends to the next label or
+    // the end of the section, the same as an objdump listing.
+    //
+    for (sitr = textSymbols.begin(); sitr != textSymbols.end(); sitr++) {
+      objdumpLine_t           lineInfo;
+      objdumpLines_t          theInstructions;
+      textSymbols_t::iterator next;
+      uint32_t                start;
+      uint32_t                end;
+      uint32_t                offset;
+
+      if (!SymbolsToAnalyze->isDesired( sitr->second ))
+        continue;
+
+      if ((sitr->first < textAddress) ||
+          (sitr->first >= textAddress + code.size()))
+        continue;
+
+      next = sitr;
+      next++;
+
+      start = sitr->first - textAddress;
+      if (next != textSymbols.end() &&
+          next->first < textAddress + code.size())
+        end = next->first - textAddress;
+      else
+        end = code.size();
+
+      if (end <= start)
+        continue;
+
+      snprintf(
+        line, sizeof(line), "%08x <%s>:", sitr->first, sitr->second.c_str()
+      );
+      lineInfo.line          = line;
+      lineInfo.address       = 0xffffffff;
+      lineInfo.isInstruction = false;
+      lineInfo.isNop         = false;
+      lineInfo.nopSize       = 0;
+      lineInfo.isBranch      = false;
+      theInstructions.push_back( lineInfo );
+
+      offset = start;
+      while (offset < end) {
+        int length;
+        int i;
+
+        if (!TargetInfo->decodeInstruction(
+               &code[ offset ], end - offset, bigEndian, instruction
+             ) || (instruction.size <= 0))
+          break;
+
+        length = snprintf(
+          line, sizeof(line), "%8x:\t", textAddress + offset
+        );
+        for (i = 0; i < instruction.size; i++)
+          length += snprintf(
+            line + length, sizeof(line) - length, "%02x ", code[ offset + i ]
+          );
+        snprintf(
+          line + length,
+          sizeof(line) - length,
+          "\t%s",
+          instruction.mnemonic ? instruction.mnemonic : ""
+        );
+
+        lineInfo.line          = line;
+        lineInfo.address       = loadAddress + textAddress + offset;
+        lineInfo.isInstruction = true;
+        lineInfo.isNop         = instruction.isNop;
+        lineInfo.nopSize       = instruction.isNop ? instruction.size : 0;
+        lineInfo.isBranch      = instruction.isBranch;
+        theInstructions.push_back( lineInfo );
+
+        offset += instruction.size;
+      }
+
+      addSymbol(
+        symbols,
+        sitr->second,
+        loadAddress + sitr->first,
+        loadAddress + textAddress + end - 1,
+        theInstructions
+      );
+    }
+
+    return true;
+  }
+
+  void ObjdumpProcessor::loadFromObjdump(
+    ExecutableInfo* const executableInformation,
+    objdumpSymbols_t&     symbols
   )
   {
     char*              cStatus;
+    char               buffer[ MAX_LINE_LENGTH ];
     std::string        currentSymbol = "";
     uint32_t           endAddress;
     uint32_t           instructionOffset;
@@ -364,13 +708,13 @@ namespace Coverage {
     while ( 1 ) {
 
       // Get the line.
-      cStatus = fgets( inputBuffer, MAX_LINE_LENGTH, objdumpFile );
+      cStatus = fgets( buffer, MAX_LINE_LENGTH, objdumpFile );
       if (cStatus == NULL) {
 
         // If we are currently processing a symbol, finalize it.
         if (processSymbol) {
-          finalizeSymbol(
-            executableInformation,
+          addSymbol(
+            symbols,
             currentSymbol,
             startAddress,
             executableInformation->getLoadAddress() + offset,
@@ -389,9 +733,9 @@ namespace Coverage {
         break;
       }
 
-      inputBuffer[ strlen(inputBuffer) - 1] = '\0';
+      buffer[ strlen(buffer) - 1] = '\0';
 
-      lineInfo.line          = inputBuffer;
+      lineInfo.line          = buffer;
       lineInfo.address       = 0xffffffff;
       lineInfo.isInstruction = false;
       lineInfo.isNop         = false;
@@ -401,7 +745,7 @@ namespace Coverage {
       // Look for the start of a symbol's objdump and extract
       // offset and symbol (i.e. offset <symbolname>:).
       items = sscanf(
-        inputBuffer,
+        buffer,
         "%x <%[^>]>%c",
         &offset, symbol, &terminator1
       );
@@ -413,8 +757,8 @@ namespace Coverage {
 
         // If we are currently processing a symbol, finalize it.
         if (processSymbol) {
-          finalizeSymbol(
-            executableInformation,
+          addSymbol(
+            symbols,
             currentSymbol,
             startAddress,
             endAddress,
@@ -441,7 +785,7 @@ namespace Coverage {
 
         // See if it is the dump of an instruction.
         items = sscanf(
-          inputBuffer,
+          buffer,
           "%x%c\t%*[^\t]%c",
           &instructionOffset, &terminator1, &terminator2
         );
@@ -453,13 +797,15 @@ namespace Coverage {
           lineInfo.address =
            executableInformation->getLoadAddress() + instructionOffset;
           lineInfo.isInstruction = true;
-          lineInfo.isNop         = isNop( inputBuffer, lineInfo.nopSize );
-          lineInfo.isBranch      = isBranchLine( inputBuffer );
+          lineInfo.isNop         = isNop( buffer, lineInfo.nopSize );
+          lineInfo.isBranch      = isBranchLine( buffer );
         }
 
         // Always save the line.
         theInstructions.push_back( lineInfo );
       }
     }
+
+    fclose( objdumpFile );
   }
 }
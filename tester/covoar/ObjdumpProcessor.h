@@ -81,6 +81,65 @@ namespace Coverage {
      */ 
     typedef std::list<uint32_t> objdumpFile_t;
 
+    /*!
+     *  This type defines a symbol found while loading an executable
+     *  along with the instructions decoded for it.
+     */
+    typedef struct {
+      /*!
+       *  This member contains the name of the symbol.
+       */
+      std::string symbolName;
+      /*!
+       *  This member contains the low address of the symbol.
+       */
+      uint32_t lowAddress;
+      /*!
+       *  This member contains the high address of the symbol.
+       */
+      uint32_t highAddress;
+      /*!
+       *  This member contains the instructions of the symbol.
+       */
+      objdumpLines_t instructions;
+    } objdumpSymbol_t;
+
+    /*!
+     *  This object defines the symbols found while loading an executable.
+     */
+    typedef std::list<objdumpSymbol_t> objdumpSymbols_t;
+
+    /*!
+     *  This type defines a symbol of an executable whose instructions
+     *  and unified coverage map have not been added to the set of
+     *  desired symbols yet.  It lets executables be loaded in parallel
+     *  while the desired symbols are updated in a fixed order.
+     */
+    typedef struct {
+      /*!
+       *  This member contains the name of the symbol.
+       */
+      std::string symbolName;
+      /*!
+       *  This member contains the low address of the symbol.
+       */
+      uint32_t lowAddress;
+      /*!
+       *  This member contains the size of the symbol in bytes.
+       */
+      uint32_t size;
+      /*!
+       *  This member contains the instructions of the symbol.
+       */
+      objdumpLines_t instructions;
+    } pendingSymbol_t;
+
+    /*!
+     *  This object defines the symbols of an executable waiting to be
+     *  added to the set of desired symbols.
+     */
+    typedef std::list<pendingSymbol_t> pendingSymbols_t;
+
     /*!
      *  This method constructs an ObjdumpProcessor instance.
      */
@@ -111,10 +170,50 @@ namespace Coverage {
 
     /*!
      *  This method generates and processes an object dump for
-     *  the specified executable.
+     *  the specified executable.  If the target has a built in
+     *  instruction decoder the code is read directly from the
+     *  executable, otherwise objdump is run.  If an analysis cache
+     *  is in use, the symbols are read from the cache when it holds
+     *  an entry for the executable and saved to it otherwise.
+     *
+     *  @param[in] executableInformation is the executable to process
+     *  @param[out] pending if not NULL receives the symbols to add to
+     *   the set of desired symbols with publish() rather than adding
+     *   them while loading.  This allows executables to be loaded on
+     *   several threads.
      */
     void load(
-      ExecutableInfo* const executableInformation
+      ExecutableInfo* const   executableInformation,
+      pendingSymbols_t* const pending = NULL
+    );
+
+    /*!
+     *  This method adds the symbols deferred by load() to the set of
+     *  desired symbols.  Calling it in the same order the executables
+     *  would have been loaded gives the same result as a serial load.
+     *
+     *  @param[in] executableInformation is the executable loaded
+     *  @param[in] pending contains the symbols deferred by load()
+     */
+    void publish(
+      ExecutableInfo* const executableInformation,
+      pendingSymbols_t&     pending
+    );
+
+    /*!
+     *  This method processes the specified executable by reading the
+     *  .text section and symbols directly from the ELF file and using
+     *  the target's instruction decoder rather than objdump.
+     *
+     *  @param[in] executableInformation is the executable to process
+     *  @param[out] symbols receives the symbols found
+     *
+     *  @return Returns TRUE if the executable was processed and FALSE
+     *   if the caller needs to fall back to objdump.
+     */
+    bool loadFromElf(
+      ExecutableInfo* const executableInformation,
+      objdumpSymbols_t&     symbols
     );
 
     /*!
@@ -140,6 +239,18 @@ namespace Coverage {
 
   private:
 
+    /*!
+     *  This method processes the specified executable using the text
+     *  output of objdump.
+     *
+     *  @param[in] executableInformation is the executable to process
+     *  @param[out] symbols receives the symbols found
+     */
+    void loadFromObjdump(
+      ExecutableInfo* const executableInformation,
+      objdumpSymbols_t&     symbols
+    );
+
     /*!
      *  This variable consists of a list of all instruction addresses
      *  extracted from the obj dump file.
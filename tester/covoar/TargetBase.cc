@@ -123,6 +123,34 @@ namespace Target {
     return isBranch( instruction );
   }
 
+  bool TargetBase::hasInstructionDecoder( void ) const
+  {
+    return false;
+  }
+
+  bool TargetBase::decodeInstruction(
+    const uint8_t* const code,
+    uint32_t             available,
+    bool                 bigEndian,
+    instruction_t&       instruction
+  ) const
+  {
+    return false;
+  }
+
+  uint32_t TargetBase::fetchWord(
+    const uint8_t* const code,
+    bool                 bigEndian
+  )
+  {
+    if (bigEndian)
+      return ((uint32_t) code[0] << 24) | ((uint32_t) code[1] << 16) |
+             ((uint32_t) code[2] << 8)  |  (uint32_t) code[3];
+
+    return ((uint32_t) code[3] << 24) | ((uint32_t) code[2] << 16) |
+           ((uint32_t) code[1] << 8)  |  (uint32_t) code[0];
+  }
+
   uint8_t TargetBase::qemuTakenBit(void)
   {
     return TRACE_OP_BR0;
@@ -23,6 +23,36 @@ namespace Target {
 
   public:
 
+    /*!
+     *  This type defines the information the built in disassembler
+     *  extracts from a single instruction.
+     */
+    typedef struct {
+      /*!
+       *  This member variable contains the size of the instruction in bytes.
+       */
+      int size;
+
+      /*!
+       *  This member variable contains an indication of whether the
+       *  instruction is a nop.
+       */
+      bool isNop;
+
+      /*!
+       *  This member variable contains an indication of whether the
+       *  instruction is a branch instruction.
+       */
+      bool isBranch;
+
+      /*!
+       *  This member variable contains the instruction's mnemonic if it
+       *  is known to the decoder, otherwise it is NULL.
+       */
+      const char* mnemonic;
+
+    } instruction_t;
+
     /*!
      *  This method constructs an TargetBase instance.
      *
@@ -102,6 +132,33 @@ namespace Target {
       const char* const instruction
     );
 
+    /*!
+     *  This method indicates whether the target can decode instructions
+     *  directly from the executable's code without running objdump.
+     *
+     *  @return Returns TRUE if decodeInstruction is supported.
+     */
+    virtual bool hasInstructionDecoder( void ) const;
+
+    /*!
+     *  This method decodes the instruction at the start of the
+     *  specified code.  It provides the instruction boundaries, nop
+     *  and branch classification for the built in disassembler.
+     *
+     *  @param[in] code points to the first byte of the instruction
+     *  @param[in] available is the number of bytes readable at @a code
+     *  @param[in] bigEndian is TRUE if the code is big endian
+     *  @param[out] instruction is set to the decoded instruction
+     *
+     *  @return Returns TRUE if the instruction was decoded, FALSE otherwise.
+     */
+    virtual bool decodeInstruction(
+      const uint8_t* const code,
+      uint32_t             available,
+      bool                 bigEndian,
+      instruction_t&       instruction
+    ) const;
+
     /*!
      *  This method returns the bit set by Qemu in the trace record
      *  when a branch is taken.
@@ -116,6 +173,20 @@ namespace Target {
 
   protected:
 
+    /*!
+     *  This method returns the 32-bit word at the specified code
+     *  address in the specified byte order.
+     *
+     *  @param[in] code points to the first byte of the word
+     *  @param[in] bigEndian is TRUE if the word is big endian
+     *
+     *  @return Returns the word in host byte order.
+     */
+    static uint32_t fetchWord(
+      const uint8_t* const code,
+      bool                 bigEndian
+    );
+
     /*!
      * This member variable contains the target name string.
      */
@@ -42,6 +42,52 @@ namespace Target {
     return false;
   }
 
+  bool Target_lm32::hasInstructionDecoder( void ) const
+  {
+    return true;
+  }
+
+  bool Target_lm32::decodeInstruction(
+    const uint8_t* const code,
+    uint32_t             available,
+    bool                 bigEndian,
+    instruction_t&       instruction
+  ) const
+  {
+    uint32_t word;
+
+    if (available < 4)
+      return false;
+
+    word = fetchWord( code, bigEndian );
+
+    instruction.size     = 4;
+    instruction.isNop    = false;
+    instruction.isBranch = false;
+    instruction.mnemonic = NULL;
+
+    // addi r0, r0, 0
+    if (word == 0x34000000) {
+      instruction.isNop    = true;
+      instruction.mnemonic = "nop";
+      return true;
+    }
+
+    switch (word >> 26) {
+      case 0x11: instruction.mnemonic = "be";   break;
+      case 0x12: instruction.mnemonic = "bg";   break;
+      case 0x13: instruction.mnemonic = "bge";  break;
+      case 0x14: instruction.mnemonic = "bgeu"; break;
+      case 0x15: instruction.mnemonic = "bgu";  break;
+      case 0x17: instruction.mnemonic = "bne";  break;
+      default:                                  break;
+    }
+
+    instruction.isBranch = (instruction.mnemonic != NULL);
+
+    return true;
+  }
+
   TargetBase *Target_lm32_Constructor(
     std::string          targetName
   )
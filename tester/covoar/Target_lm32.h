@@ -47,6 +47,17 @@ namespace Target {
       int&              size
     );
 
+    /* Inherit documentation from base class. */
+    bool hasInstructionDecoder( void ) const;
+
+    /* Inherit documentation from base class. */
+    bool decodeInstruction(
+      const uint8_t* const code,
+      uint32_t             available,
+      bool                 bigEndian,
+      instruction_t&       instruction
+    ) const;
+
   private:
 
   };
@@ -75,6 +75,56 @@ namespace Target {
     exit( -1 );    
   }
 
+  bool Target_powerpc::hasInstructionDecoder( void ) const
+  {
+    return true;
+  }
+
+  bool Target_powerpc::decodeInstruction(
+    const uint8_t* const code,
+    uint32_t             available,
+    bool                 bigEndian,
+    instruction_t&       instruction
+  ) const
+  {
+    static const char* const true_cond[]  = { "blt", "bgt", "beq", "bso" };
+    static const char* const false_cond[] = { "bge", "ble", "bne", "bns" };
+    uint32_t word;
+    uint32_t bo;
+
+    if (available < 4)
+      return false;
+
+    word = fetchWord( code, bigEndian );
+
+    instruction.size     = 4;
+    instruction.isNop    = false;
+    instruction.isBranch = false;
+    instruction.mnemonic = NULL;
+
+    // ori r0,r0,0
+    if (word == 0x60000000) {
+      instruction.isNop    = true;
+      instruction.mnemonic = "nop";
+    }
+
+    // Opcode 16 is bc.  Only the forms that test a CR bit without
+    // decrementing CTR and without linking are the conditional branches
+    // objdump prints as beq, bne, etc.
+    else if ((word >> 26) == 16) {
+      bo = (word >> 21) & 0x1f;
+      if (((bo & 0x14) == 0x04) && ((word & 1) == 0)) {
+        instruction.isBranch = true;
+        if (bo & 0x08)
+          instruction.mnemonic = true_cond[ (word >> 16) & 3 ];
+        else
+          instruction.mnemonic = false_cond[ (word >> 16) & 3 ];
+      }
+    }
+
+    return true;
+  }
+
   TargetBase *Target_powerpc_Constructor(
     std::string          targetName
   )
@@ -82,6 +82,80 @@ namespace Target {
   }
 
 
+  bool Target_sparc::hasInstructionDecoder( void ) const
+  {
+    return true;
+  }
+
+  bool Target_sparc::decodeInstruction(
+    const uint8_t* const code,
+    uint32_t             available,
+    bool                 bigEndian,
+    instruction_t&       instruction
+  ) const
+  {
+    static const char* const bicc[] = {
+      "bn",   "be",   "ble",  "bl",   "bleu", "bcs",  "bneg", "bvs",
+      "ba",   "bne",  "bg",   "bge",  "bgu",  "bcc",  "bpos", "bvc"
+    };
+    static const char* const bicc_a[] = {
+      "bn,a",   "be,a",   "ble,a",  "bl,a",   "bleu,a", "bcs,a",
+      "bneg,a", "bvs,a",  "ba,a",   "bne,a",  "bg,a",   "bge,a",
+      "bgu,a",  "bcc,a",  "bpos,a", "bvc,a"
+    };
+    // The op3 codes of the arithmetic (op = 2) and memory (op = 3)
+    // formats that are reserved in SPARC V8, V9 and LEON, one bit per
+    // op3 value.  objdump cannot decode these whatever the architecture.
+    static const uint64_t reservedArithmetic =
+      (1ULL << 0x19) | (1ULL << 0x1d) | (1ULL << 0x3f);
+    static const uint64_t reservedMemory =
+      (1ULL << 0x0c) | (1ULL << 0x1c) | (0xdfULL << 0x28) |
+      (0x0fULL << 0x38) | (1ULL << 0x3f);
+    uint32_t word;
+    uint32_t op;
+
+    if (available < 4)
+      return false;
+
+    word = fetchWord( code, bigEndian );
+
+    instruction.size     = 4;
+    instruction.isNop    = false;
+    instruction.isBranch = false;
+    instruction.mnemonic = NULL;
+
+    // sethi 0, %g0
+    if (word == 0x01000000) {
+      instruction.isNop    = true;
+      instruction.mnemonic = "nop";
+    }
+
+    // Format 2 (op = 0) with op2 = 2 is the Bicc integer branch and
+    // op2 = 1 the V9 BPcc branch with the same condition field.
+    else if (((word >> 30) == 0) &&
+             ((((word >> 22) & 7) == 2) || (((word >> 22) & 7) == 1))) {
+      instruction.isBranch = true;
+      if (word & (1 << 29))
+        instruction.mnemonic = bicc_a[ (word >> 25) & 0xf ];
+      else
+        instruction.mnemonic = bicc[ (word >> 25) & 0xf ];
+    }
+
+    // objdump prints words that are not an instruction as "unknown" and
+    // isNopLine counts them as nops, so do the same.  Only the words no
+    // architecture decodes are counted, every format 2 word decodes.
+    else {
+      op = word >> 30;
+      if (((op == 2) && ((reservedArithmetic >> ((word >> 19) & 0x3f)) & 1)) ||
+          ((op == 3) && ((reservedMemory >> ((word >> 19) & 0x3f)) & 1))) {
+        instruction.isNop    = true;
+        instruction.mnemonic = "unknown";
+      }
+    }
+
+    return true;
+  }
+
   TargetBase *Target_sparc_Constructor(
     std::string          targetName
   )
@@ -83,6 +83,7 @@ namespace Trace {
     FILE*               traceFile;
     uint8_t             taken;
     uint8_t             notTaken;
+    uint16_t            one = 1;
 
     taken    = TargetInfo->qemuTakenBit();
     notTaken = TargetInfo->qemuNotTakenBit();
@@ -110,8 +111,9 @@ namespace Trace {
     sprintf( header.magic, "%s", QEMU_TRACE_MAGIC );
     header.version = QEMU_TRACE_VERSION;
     header.kind    = QEMU_TRACE_KIND_RAW;  // XXX ??
-    header.sizeof_target_pc = 32;
-    header.big_endian = false;
+    // The entries are written in the host's byte order.
+    header.sizeof_target_pc = sizeof(target_ulong);
+    header.big_endian = *((uint8_t*) &one) == 0;
     header.machine[0] = 0; // XXX ??
     header.machine[1] = 0; // XXX ??
     status = fwrite( &header, sizeof(trace_header), 1, traceFile );
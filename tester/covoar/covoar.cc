@@ -10,7 +10,11 @@
 #include <sys/stat.h>
 #include <unistd.h>
 
+#include <condition_variable>
 #include <list>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "app_common.h"
 #include "CoverageFactory.h"
@@ -46,6 +50,7 @@ const char*                          target = NULL;
 const char*                          format = NULL;
 FILE*				     gcnosFile = NULL;
 Gcov::GcovData* 		     gcovFile;
+int                                  jobs = 1;
 
 /*
  *  Print program usage message
@@ -59,6 +64,8 @@ void usage()
     "Usage: %s [-v] -T TARGET -f FORMAT [-E EXPLANATIONS] -e EXE_EXTENSION -c COVERAGEFILE_EXTENSION EXECUTABLE1 ... EXECUTABLE2\n"
     "\n"
     "  -v                        - verbose at initialization\n"
+    "  -d                        - disassemble with objdump rather than\n"
+    "                              the built in instruction decoder\n"
     "  -T TARGET                 - target name\n"
     "  -f FORMAT                 - coverage file format "
            "(RTEMS, QEMU, TSIM or Skyeye)\n"
@@ -70,7 +77,12 @@ void usage()
     "  -g GCNOS_LIST             - name of file with list of *.gcno files\n"
     "  -p PROJECT_NAME           - name of the project\n"
     "  -C ConfigurationFileName  - name of configuration file\n"
-    "  -O Output_Directory       - name of output directory (default=."
+    "  -O Output_Directory       - name of output directory (default=.\n"
+    "  -j JOBS                   - number of executables to analyze in\n"
+    "                              parallel (default=1, ignored with -1)\n"
+    "  -A CACHE_DIRECTORY        - directory in which to cache the analysis\n"
+    "                              of each executable between runs,\n"
+    "                              created if it does not exist"
     "\n",
     progname,
     progname
@@ -99,6 +111,107 @@ Configuration::Options_t Options[] = {
   { NULL,                   NULL }
 };
 
+/*
+ *  Parallel Analysis Support
+ *
+ *  Each worker takes the next executable, loads it and reads its
+ *  coverage file.  The symbols an executable adds to the desired
+ *  symbols are published in command line order, and the coverage
+ *  maps are merged in that order once all workers are done, so the
+ *  reports are the same as those of a serial run.
+ */
+class ParallelAnalysis {
+
+public:
+
+  ParallelAnalysis(
+    const std::list<Coverage::ExecutableInfo*>& theExecutables,
+    const std::list<std::string>&               theCoverageFiles
+  ) : executables( theExecutables.begin(), theExecutables.end() ),
+      coverageFiles( theCoverageFiles.begin(), theCoverageFiles.end() ),
+      next( 0 ),
+      nextToPublish( 0 )
+  {
+  }
+
+  void run( int workers )
+  {
+    std::vector<std::thread> threads;
+    size_t                   i;
+
+    if ((size_t) workers > executables.size())
+      workers = executables.size();
+
+    for (i = 0; i < (size_t) workers; i++)
+      threads.push_back( std::thread( &ParallelAnalysis::worker, this ) );
+
+    for (i = 0; i < threads.size(); i++)
+      threads[ i ].join();
+
+    // Merge each symbols coverage map into a unified coverage map.
+    for (i = 0; i < executables.size(); i++)
+      executables[ i ]->mergeCoverage();
+  }
+
+private:
+
+  void worker( void )
+  {
+    while (true) {
+      Coverage::ObjdumpProcessor::pendingSymbols_t pending;
+      Coverage::ExecutableInfo*                    executable;
+      size_t                                       i;
+
+      {
+        std::lock_guard<std::mutex> guard( lock );
+        if (next >= executables.size())
+          return;
+        i = next++;
+      }
+
+      executable = executables[ i ];
+
+      if (Verbose)
+        fprintf(
+          stderr,
+          "Extracting information from %s\n",
+          executable->getFileName().c_str()
+        );
+
+      // Load the objdump for the symbols in this executable.
+      objdumpProcessor->load( executable, &pending );
+
+      if (Verbose)
+        fprintf(
+          stderr,
+          "Processing coverage file %s for executable %s\n",
+          coverageFiles[ i ].c_str(),
+          executable->getFileName().c_str()
+        );
+
+      // Process its coverage file.
+      coverageReader->processFile( coverageFiles[ i ].c_str(), executable );
+
+      // Wait for the earlier executables then publish the symbols.
+      {
+        std::unique_lock<std::mutex> guard( lock );
+        while (nextToPublish != i)
+          published.wait( guard );
+        objdumpProcessor->publish( executable, pending );
+        nextToPublish++;
+      }
+      published.notify_all();
+    }
+  }
+
+  std::vector<Coverage::ExecutableInfo*> executables;
+  std::vector<std::string>               coverageFiles;
+  std::mutex                             lock;
+  std::condition_variable                published;
+  size_t                                 next;
+  size_t                                 nextToPublish;
+};
+
 bool isTrue(const char *value)
 {
   if ( !value )                  return false;
@@ -166,7 +279,7 @@ int main(
   //
   progname = argv[0];
 
-  while ((opt = getopt(argc, argv, "C:1:L:e:c:g:E:f:s:T:O:p:v")) != -1) {
+  while ((opt = getopt(argc, argv, "C:1:L:e:c:g:E:f:s:T:O:p:j:A:vd")) != -1) {
     switch (opt) {
       case 'C': CoverageConfiguration->processFile( optarg ); break;
       case '1': singleExecutable      = optarg; break;
@@ -180,7 +293,17 @@ int main(
       case 'T': target                = optarg; break;
       case 'O': outputDirectory       = optarg; break;
       case 'v': Verbose               = true;   break;
+      case 'd': UseObjdump            = true;   break;
       case 'p': projectName           = optarg; break;
+      case 'A': AnalysisCacheDirectory = optarg; break;
+      case 'j':
+        jobs = atoi( optarg );
+        if (jobs < 1) {
+          fprintf( stderr, "ERROR: invalid number of jobs: %s\n", optarg );
+          usage();
+          exit( -1 );
+        }
+        break;
       default: /* '?' */
         usage();
         exit( -1 );
@@ -343,6 +466,31 @@ int main(
     exit(-1);
   }
 
+  // Create the analysis cache directory if it does not exist.
+  if (AnalysisCacheDirectory) {
+    struct stat statbuf;
+
+    if ((mkdir( AnalysisCacheDirectory, 0755 ) != 0) && (errno != EEXIST)) {
+      fprintf(
+        stderr,
+        "ERROR: Unable to create the analysis cache directory %s: %s\n",
+        AnalysisCacheDirectory,
+        strerror( errno )
+      );
+      exit(-1);
+    }
+
+    if ((stat( AnalysisCacheDirectory, &statbuf ) != 0) ||
+        !S_ISDIR( statbuf.st_mode )) {
+      fprintf(
+        stderr,
+        "ERROR: The analysis cache %s is not a directory\n",
+        AnalysisCacheDirectory
+      );
+      exit(-1);
+    }
+  }
+
   //
   // Create data to support analysis.
   //
@@ -375,57 +523,78 @@ int main(
   // Create the objdump processor.
   objdumpProcessor = new Coverage::ObjdumpProcessor();
 
-  // Prepare each executable for analysis.
-  for (eitr = executablesToAnalyze.begin();
-       eitr != executablesToAnalyze.end();
-       eitr++) {
-
-    if (Verbose)
-      fprintf(
-        stderr,
-        "Extracting information from %s\n",
-        ((*eitr)->getFileName()).c_str()
-      );
+  if ((jobs > 1) && !singleExecutable) {
 
-    // If a dynamic library was specified, determine the load address.
-    if (dynamicLibrary)
-      (*eitr)->setLoadAddress(
-        objdumpProcessor->determineLoadAddress( *eitr )
-      );
+    // The load addresses are read with the shared input buffer so
+    // determine them before starting the workers.
+    if (dynamicLibrary) {
+      for (eitr = executablesToAnalyze.begin();
+           eitr != executablesToAnalyze.end();
+           eitr++) {
+        (*eitr)->setLoadAddress(
+          objdumpProcessor->determineLoadAddress( *eitr )
+        );
+      }
+    }
 
-    // Load the objdump for the symbols in this executable.
-    objdumpProcessor->load( *eitr );
+    // Prepare and analyze the executables on a pool of workers.
+    ParallelAnalysis analysis( executablesToAnalyze, coverageFileNames );
+    analysis.run( jobs );
   }
+  else {
 
-  //
-  // Analyze the coverage data.
-  //
+    // Prepare each executable for analysis.
+    for (eitr = executablesToAnalyze.begin();
+         eitr != executablesToAnalyze.end();
+         eitr++) {
 
-  // Process each executable/coverage file pair.
-  eitr = executablesToAnalyze.begin();
-  for (citr = coverageFileNames.begin();
-       citr != coverageFileNames.end();
-       citr++) {
+      if (Verbose)
+        fprintf(
+          stderr,
+          "Extracting information from %s\n",
+          ((*eitr)->getFileName()).c_str()
+        );
 
-    if (Verbose)
-      fprintf(
-        stderr,
-        "Processing coverage file %s for executable %s\n",
-        (*citr).c_str(),
-        ((*eitr)->getFileName()).c_str()
-      );
+      // If a dynamic library was specified, determine the load address.
+      if (dynamicLibrary)
+        (*eitr)->setLoadAddress(
+          objdumpProcessor->determineLoadAddress( *eitr )
+        );
 
-    // Process its coverage file.
-    coverageReader->processFile( (*citr).c_str(), *eitr );
+      // Load the objdump for the symbols in this executable.
+      objdumpProcessor->load( *eitr );
+    }
 
-    // Merge each symbols coverage map into a unified coverage map.
-    (*eitr)->mergeCoverage();
+    //
+    // Analyze the coverage data.
+    //
 
-    // DEBUG Print ExecutableInfo content
-    //(*eitr)->dumpExecutableInfo();
+    // Process each executable/coverage file pair.
+    eitr = executablesToAnalyze.begin();
+    for (citr = coverageFileNames.begin();
+         citr != coverageFileNames.end();
+         citr++) {
+
+      if (Verbose)
+        fprintf(
+          stderr,
+          "Processing coverage file %s for executable %s\n",
+          (*citr).c_str(),
+          ((*eitr)->getFileName()).c_str()
+        );
 
-    if (!singleExecutable)
-      eitr++;
+      // Process its coverage file.
+      coverageReader->processFile( (*citr).c_str(), *eitr );
+
+      // Merge each symbols coverage map into a unified coverage map.
+      (*eitr)->mergeCoverage();
+
+      // DEBUG Print ExecutableInfo content
+      //(*eitr)->dumpExecutableInfo();
+
+      if (!singleExecutable)
+        eitr++;
+    }
   }
 
   // Do necessary preprocessing of uncovered ranges and branches